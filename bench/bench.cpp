@@ -0,0 +1,437 @@
+/// file: bench.cpp
+///
+/// Measures the throughput of the acl operations against the nested `std::unordered_map` baseline.
+/// The baseline models the entries of the original acl, the string access levels and the heap-held resources.
+/// The `is_allowed_aud` line is the acl check with the audit log attached, the `acl_int` engine is the acl
+/// of the integral subject ids. The `count_allowed` line is the full table scan, per grant.
+/// Usage: access_list_bench [-n <entries,...>] [-s <resources per subject>] [-o <operations>]
+///                          [-r <read ratio of the mixed workload>] [-d <uniform|zipf|all>]
+///                          [-t <threads of the bulk add>]
+/// Prints one line per (engine, distribution, entries, operation) with ns/op, allocations/op and peak RSS.
+/// Every (engine, distribution, entries) run is forked into its own process, so the peak RSS is its own.
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "acl.hpp"
+
+// Counts the heap allocations of the measured operations.
+#include "counting_allocator.hpp"
+
+namespace {
+
+using subject_type = libs::subjects::subject<std::string>;
+
+/**
+ * @brief The options of the run.
+ */
+struct options {
+	std::vector<size_t> entries{1000, 100000, 1000000};
+	size_t per_subject{16};
+	size_t operations{1000000};
+	unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+	double read_ratio{0.9};
+	std::vector<std::string> distributions{"uniform", "zipf"};
+};
+
+/**
+ * @brief The access level of the original acl, the string specifier checked against the set of valid ones.
+ */
+class legacy_access_level {
+	private:
+		std::unordered_set<std::string> valid_access_specifiers{"allowed", "forbiden"};
+		mutable std::string m_access;
+	public:
+		explicit legacy_access_level(const std::string& access = "forbiden") {
+			if(valid_access_specifiers.find(access) == valid_access_specifiers.end()) {
+				throw std::invalid_argument("Error: Invalid access specifier");
+			}
+			m_access = access;
+		}
+		std::string get_access_level() const {
+			return m_access;
+		}
+};
+
+/**
+ * @brief The resource of the original acl, its data always kept on the heap.
+ */
+class legacy_resource {
+	private:
+		std::unique_ptr<int> m_resource;
+		size_t m_uuid{};
+	public:
+		explicit legacy_resource(const int data): m_resource(std::make_unique<int>(data)) {}
+		void set_uuid(const size_t uuid) {
+			m_uuid = uuid;
+		}
+};
+
+/**
+ * @brief The storage of the original acl, i.e. a map of subjects to maps of uuids to grants.
+ */
+class baseline {
+	private:
+		using grants = std::unordered_map<size_t, std::pair<std::unique_ptr<legacy_resource>, legacy_access_level>>;
+		std::unordered_map<std::string, grants> m_subjects;
+		size_t m_uuid{1};
+	public:
+		size_t add(const subject_type& sub, std::unique_ptr<legacy_resource> res, libs::enums::rights access) {
+			res->set_uuid(m_uuid);
+			m_subjects[sub.get_id()].emplace(m_uuid, std::make_pair(std::move(res),
+					legacy_access_level(access != libs::enums::rights::none ? "allowed" : "forbiden")));
+			return m_uuid++;
+		}
+		bool is_allowed(const subject_type& sub, const size_t uuid) {
+			auto it = m_subjects.find(sub.get_id());
+			if(it == m_subjects.end()) {
+				return false;
+			}
+			auto g = it->second.find(uuid);
+			return g != it->second.end() && g->second.second.get_access_level() == "allowed";
+		}
+		void allow_access(const subject_type& sub, const size_t uuid) {
+			auto it = m_subjects.find(sub.get_id());
+			if(it != m_subjects.end()) {
+				auto g = it->second.find(uuid);
+				if(g != it->second.end()) {
+					g->second.second = legacy_access_level("allowed");
+				}
+			}
+		}
+		void forbid_access(const subject_type& sub, const size_t uuid) {
+			auto it = m_subjects.find(sub.get_id());
+			if(it != m_subjects.end()) {
+				auto g = it->second.find(uuid);
+				if(g != it->second.end()) {
+					g->second.second = legacy_access_level("forbiden");
+				}
+			}
+		}
+		std::unique_ptr<legacy_resource> try_pop(const subject_type& sub, const size_t uuid) {
+			auto it = m_subjects.find(sub.get_id());
+			if(it != m_subjects.end()) {
+				auto g = it->second.find(uuid);
+				if(g != it->second.end()) {
+					return std::move(g->second.first);
+				}
+			}
+			return nullptr;
+		}
+		void remove(const subject_type& sub, const size_t uuid) {
+			auto it = m_subjects.find(sub.get_id());
+			if(it != m_subjects.end()) {
+				it->second.erase(uuid);
+			}
+		}
+};
+
+/**
+ * @brief Draws the subject indices, uniformly or by Zipf's law with the exponent 0.99.
+ */
+class subject_picker {
+	private:
+		std::vector<double> m_cdf;
+		std::uniform_real_distribution<double> m_unit{0.0, 1.0};
+		std::uniform_int_distribution<size_t> m_uniform;
+	public:
+		subject_picker(const size_t subjects, const bool zipf): m_uniform(0, subjects - 1) {
+			if(zipf) {
+				m_cdf.resize(subjects);
+				double sum = 0;
+				for(size_t i = 0; i < subjects; ++i) {
+					sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+					m_cdf[i] = sum;
+				}
+				for(double& c : m_cdf) {
+					c /= sum;
+				}
+			}
+		}
+		size_t operator()(std::mt19937_64& rng) {
+			if(m_cdf.empty()) {
+				return m_uniform(rng);
+			}
+			const size_t i = std::lower_bound(m_cdf.begin(), m_cdf.end(), m_unit(rng)) - m_cdf.begin();
+			return i < m_cdf.size() ? i : m_cdf.size() - 1;
+		}
+};
+
+/**
+ * Gets the peak resident set size of the process
+ * @returns `long` the size in kilobytes
+ */
+long peak_rss_kb() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/**
+ * Runs the operation `count` times and prints its line
+ * \param engine the name of the measured storage
+ * \param dist the name of the subject distribution
+ * \param entries the number of the entries
+ * \param name the name of the operation
+ * \param count the number of the operations
+ * \param op the operation taking the operation index
+ * @returns `void`
+ */
+template <typename F>
+void measure(const char* engine, const std::string& dist, const size_t entries, const char* name, const size_t count, F op) {
+	const size_t allocations = g_allocations.load(std::memory_order_relaxed);
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < count; ++i) {
+		op(i);
+	}
+	const auto stop = std::chrono::steady_clock::now();
+	const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+	const double allocs = static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocations);
+	std::printf("%-9s %-8s %10zu %-14s %10.1f %10.2f %12ld\n", engine, dist.c_str(), entries, name,
+			count ? ns / count : 0.0, count ? allocs / count : 0.0, peak_rss_kb());
+}
+
+/**
+ * @brief Defines the subject id and the resource types of the storage, the baseline keeps the string ids.
+ */
+template <typename ACL>
+struct engine_traits {
+	using id_type = std::string;
+	using resource = legacy_resource;
+};
+
+template <typename S, typename R>
+struct engine_traits<libs::acl::acl<S, R>> {
+	using id_type = S;
+	using resource = libs::resources::resource<R>;
+};
+
+std::string make_id(const size_t i, std::string*) {
+	return "subject_" + std::to_string(i);
+}
+
+template <typename T>
+T make_id(const size_t i, T*) {
+	return static_cast<T>(i);
+}
+
+// Keeps the results of the checks alive so the compiler does not drop them.
+volatile size_t g_sink;
+
+/**
+ * Runs the workloads against the storage
+ * \param engine the name of the storage
+ * \param opts the options of the run
+ * \param dist the name of the subject distribution
+ * \param entries the number of the entries
+ * @returns `void`
+ */
+template <typename ACL>
+void run(const char* engine, const options& opts, const std::string& dist, const size_t entries) {
+	const size_t per_subject = std::max<size_t>(1, opts.per_subject);
+	const size_t subjects = std::max<size_t>(1, entries / per_subject);
+	std::mt19937_64 rng(42);
+	subject_picker pick(subjects, dist == "zipf");
+	using id_type = typename engine_traits<ACL>::id_type;
+	using subject = libs::subjects::subject<id_type>;
+	using resource = typename engine_traits<ACL>::resource;
+	std::vector<subject> subs;
+	subs.reserve(subjects);
+	for(size_t i = 0; i < subjects; ++i) {
+		subs.emplace_back(make_id(i, static_cast<id_type*>(nullptr)));
+	}
+	// The owner of every entry is drawn from the distribution, the hot subjects own more resources.
+	std::vector<std::uint32_t> owners(entries);
+	std::vector<std::vector<size_t>> owned(subjects);
+	for(size_t i = 0; i < entries; ++i) {
+		owners[i] = static_cast<std::uint32_t>(pick(rng));
+	}
+	ACL a;
+	measure(engine, dist, entries, "add", entries, [&](size_t i) {
+		g_sink = a.add(subs[owners[i]], std::make_unique<resource>(static_cast<int>(i)),
+				(i & 1) ? libs::enums::rights::read : libs::enums::rights::none);
+	});
+	if constexpr(!std::is_same<ACL, baseline>::value) {
+		// The same grants bulk-added into a fresh acl, the resources are made outside the timing.
+		std::vector<std::tuple<const subject&, std::unique_ptr<resource>, libs::enums::rights>> grants;
+		grants.reserve(entries);
+		for(size_t i = 0; i < entries; ++i) {
+			grants.emplace_back(subs[owners[i]], std::make_unique<resource>(static_cast<int>(i)),
+					(i & 1) ? libs::enums::rights::read : libs::enums::rights::none);
+		}
+		ACL bulk;
+		measure(engine, dist, entries, "add_all", entries, [&](size_t i) {
+			if(i == 0) {
+				g_sink = bulk.add_all(grants, opts.threads).second;
+			}
+		});
+	}
+	// Both engines hand out the uuids sequentially from 1.
+	for(size_t i = 0; i < entries; ++i) {
+		owned[owners[i]].push_back(i + 1);
+	}
+	// The checks pick the subject from the distribution, then one of its resources.
+	const size_t ops = opts.operations;
+	std::vector<std::pair<std::uint32_t, size_t>> checks(ops);
+	for(std::pair<std::uint32_t, size_t>& c : checks) {
+		size_t s = pick(rng);
+		while(owned[s].empty()) {
+			s = pick(rng);
+		}
+		c = {static_cast<std::uint32_t>(s), owned[s][rng() % owned[s].size()]};
+	}
+	size_t hits = 0;
+	measure(engine, dist, entries, "is_allowed", ops, [&](size_t i) {
+		hits += a.is_allowed(subs[checks[i].first], checks[i].second);
+	});
+	if constexpr(!std::is_same<ACL, baseline>::value) {
+		// The same checks audited, the ring holds them all so none is dropped while measured.
+		const std::string audit_path = "/tmp/access_list_bench_" + std::to_string(getpid()) + ".audit";
+		{
+			libs::audit::writer log(audit_path, ops);
+			a.attach_audit(&log);
+			measure(engine, dist, entries, "is_allowed_aud", ops, [&](size_t i) {
+				hits += a.is_allowed(subs[checks[i].first], checks[i].second);
+			});
+			a.attach_audit(nullptr);
+		}
+		std::remove(audit_path.c_str());
+	}
+	measure(engine, dist, entries, "allow_access", ops, [&](size_t i) {
+		a.allow_access(subs[checks[i].first], checks[i].second);
+	});
+	measure(engine, dist, entries, "forbid_access", ops, [&](size_t i) {
+		a.forbid_access(subs[checks[i].first], checks[i].second);
+	});
+	std::vector<bool> reads(ops);
+	std::bernoulli_distribution read(opts.read_ratio);
+	for(size_t i = 0; i < ops; ++i) {
+		reads[i] = read(rng);
+	}
+	measure(engine, dist, entries, "mixed", ops, [&](size_t i) {
+		if(reads[i]) {
+			hits += a.is_allowed(subs[checks[i].first], checks[i].second);
+		} else if(i & 1) {
+			a.allow_access(subs[checks[i].first], checks[i].second);
+		} else {
+			a.forbid_access(subs[checks[i].first], checks[i].second);
+		}
+	});
+	if constexpr(!std::is_same<ACL, baseline>::value) {
+		// The whole table scanned by the threads, per grant.
+		measure(engine, dist, entries, "count_allowed", entries, [&](size_t i) {
+			if(i == 0) {
+				g_sink = a.count_allowed(libs::enums::rights::read, opts.threads);
+			}
+		});
+	}
+	// Every entry is popped and removed once, in a random order.
+	std::vector<size_t> order(entries);
+	for(size_t i = 0; i < entries; ++i) {
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), rng);
+	measure(engine, dist, entries, "try_pop", entries, [&](size_t i) {
+		hits += a.try_pop(subs[owners[order[i]]], order[i] + 1) != nullptr;
+	});
+	measure(engine, dist, entries, "remove", entries, [&](size_t i) {
+		a.remove(subs[owners[order[i]]], order[i] + 1);
+	});
+	g_sink = hits;
+}
+
+std::vector<size_t> parse_sizes(const std::string& arg) {
+	std::vector<size_t> sizes;
+	size_t pos = 0;
+	while(pos <= arg.size()) {
+		const size_t comma = std::min(arg.find(',', pos), arg.size());
+		sizes.push_back(std::strtoull(arg.substr(pos, comma - pos).c_str(), nullptr, 10));
+		pos = comma + 1;
+	}
+	return sizes;
+}
+
+/**
+ * Runs the workloads in a child process
+ * @returns `bool` whether the child succeeded
+ */
+template <typename ACL>
+bool run_isolated(const char* engine, const options& opts, const std::string& dist, const size_t entries) {
+	std::fflush(stdout);
+	const pid_t pid = fork();
+	if(pid == 0) {
+		run<ACL>(engine, opts, dist, entries);
+		std::fflush(stdout);
+		_exit(0);
+	}
+	int status = 0;
+	return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void usage(const char* name) {
+	std::fprintf(stderr, "Usage: %s [-n <entries,...>] [-s <resources per subject>] [-o <operations>]"
+			" [-r <read ratio>] [-d <uniform|zipf|all>] [-t <threads>]\n", name);
+	std::exit(1);
+}
+}
+
+int main(int argc, char** argv) {
+	options opts;
+	for(int i = 1; i < argc; ++i) {
+		if(i + 1 >= argc) {
+			usage(argv[0]);
+		}
+		const std::string flag = argv[i];
+		const char* value = argv[++i];
+		if(flag == "-n") {
+			opts.entries = parse_sizes(value);
+		} else if(flag == "-s") {
+			opts.per_subject = std::strtoull(value, nullptr, 10);
+		} else if(flag == "-o") {
+			opts.operations = std::strtoull(value, nullptr, 10);
+		} else if(flag == "-r") {
+			opts.read_ratio = std::strtod(value, nullptr);
+		} else if(flag == "-t") {
+			opts.threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+		} else if(flag == "-d") {
+			if(std::string(value) != "all") {
+				opts.distributions = {value};
+			}
+		} else {
+			usage(argv[0]);
+		}
+	}
+	std::printf("%-9s %-8s %10s %-14s %10s %10s %12s\n", "engine", "dist", "entries", "operation", "ns/op", "allocs/op", "peak_rss_kb");
+	for(const size_t entries : opts.entries) {
+		for(const std::string& dist : opts.distributions) {
+			if(!run_isolated<libs::acl::acl<std::string, int>>("acl", opts, dist, entries) ||
+					!run_isolated<libs::acl::acl<std::uint32_t, int>>("acl_int", opts, dist, entries) ||
+					!run_isolated<baseline>("baseline", opts, dist, entries)) {
+				std::fprintf(stderr, "Error: The run of %zu entries failed\n", entries);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
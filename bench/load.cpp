@@ -0,0 +1,205 @@
+/// file: load.cpp
+///
+/// Measures the latency and the throughput of the daemon as seen by its local clients.
+/// Usage: access_list_load [-s <socket path>] [-n <entries>] [-p <resources per subject>] [-c <connections>]
+///                         [-d <pipeline depths,...>] [-o <requests per connection>] [-r <read ratio>]
+/// Without -s the daemon is served in-process on a temporary socket. The entries are added through the
+/// daemon first, then every connection runs its requests in bursts of the pipeline depth, the latency
+/// of a request is the time from the burst being sent to its response being received.
+/// Prints one line per depth with the requests/s and the p50, p99 and p99.9 latencies.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "acl.hpp"
+#include "client.hpp"
+#include "server.hpp"
+
+namespace {
+
+using client_type = libs::daemon::client<std::string, std::string>;
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * @brief The options of the run.
+ */
+struct options {
+	std::string socket_path;
+	size_t entries{100000};
+	size_t per_subject{16};
+	size_t connections{4};
+	std::vector<size_t> depths{1, 16, 64};
+	size_t requests{100000};
+	double read_ratio{1.0};
+};
+
+/**
+ * Adds the entries through the daemon
+ * \param path the path of the socket
+ * \param opts the options of the run
+ * @returns `std::vector<std::pair<std::string, size_t>>` the (subject, uuid) pairs of the entries
+ */
+std::vector<std::pair<std::string, size_t>> populate(const std::string& path, const options& opts) {
+	client_type c(path);
+	const size_t subjects = std::max<size_t>(1, opts.entries / std::max<size_t>(1, opts.per_subject));
+	std::vector<std::pair<std::string, size_t>> entries(opts.entries);
+	const std::string resource = "resource";
+	const size_t window = 4096;
+	for(size_t begin = 0; begin < opts.entries; begin += window) {
+		const size_t end = std::min(opts.entries, begin + window);
+		for(size_t i = begin; i < end; ++i) {
+			entries[i].first = "subject_" + std::to_string(i % subjects);
+			c.send(libs::daemon::op::add, entries[i].first, 0, (i & 1) ? libs::enums::rights::read : libs::enums::rights::none, &resource);
+		}
+		c.flush();
+		for(size_t i = begin; i < end; ++i) {
+			const libs::daemon::response resp = c.receive();
+			if(resp.code != libs::status::code::ok) {
+				std::fprintf(stderr, "%s\n", libs::status::message(resp.code));
+				std::exit(1);
+			}
+			entries[i].second = static_cast<size_t>(resp.uuid);
+		}
+	}
+	return entries;
+}
+
+/**
+ * Runs the requests of one connection in bursts
+ * \param path the path of the socket
+ * \param opts the options of the run
+ * \param depth the number of the requests in flight
+ * \param entries the (subject, uuid) pairs to pick from
+ * \param seed the seed of the picks
+ * \param latencies receives the latency of every request in nanoseconds
+ * @returns `void`
+ */
+void connection(const std::string& path, const options& opts, const size_t depth, const std::vector<std::pair<std::string, size_t>>& entries,
+		const unsigned seed, std::vector<std::uint32_t>& latencies) {
+	client_type c(path);
+	std::mt19937_64 rng(seed);
+	std::bernoulli_distribution read(opts.read_ratio);
+	latencies.reserve(opts.requests);
+	for(size_t done = 0; done < opts.requests; ) {
+		const size_t burst = std::min(depth, opts.requests - done);
+		for(size_t i = 0; i < burst; ++i) {
+			const std::pair<std::string, size_t>& e = entries[rng() % entries.size()];
+			const libs::daemon::op o = read(rng) ? libs::daemon::op::is_allowed :
+				((done + i) & 1) ? libs::daemon::op::allow : libs::daemon::op::forbid;
+			c.send(o, e.first, e.second, libs::enums::rights::read);
+		}
+		const clock_type::time_point start = clock_type::now();
+		c.flush();
+		for(size_t i = 0; i < burst; ++i) {
+			c.receive();
+			latencies.push_back(static_cast<std::uint32_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count()));
+		}
+		done += burst;
+	}
+}
+
+double percentile(const std::vector<std::uint32_t>& sorted, const double p) {
+	return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))] / 1000.0;
+}
+
+std::vector<size_t> parse_sizes(const std::string& arg) {
+	std::vector<size_t> sizes;
+	size_t pos = 0;
+	while(pos <= arg.size()) {
+		const size_t comma = std::min(arg.find(',', pos), arg.size());
+		sizes.push_back(std::strtoull(arg.substr(pos, comma - pos).c_str(), nullptr, 10));
+		pos = comma + 1;
+	}
+	return sizes;
+}
+
+void usage(const char* name) {
+	std::fprintf(stderr, "Usage: %s [-s <socket path>] [-n <entries>] [-p <resources per subject>] [-c <connections>]"
+			" [-d <depths,...>] [-o <requests per connection>] [-r <read ratio>]\n", name);
+	std::exit(1);
+}
+}
+
+int main(int argc, char** argv) {
+	options opts;
+	for(int i = 1; i < argc; ++i) {
+		if(i + 1 >= argc) {
+			usage(argv[0]);
+		}
+		const std::string flag = argv[i];
+		const char* value = argv[++i];
+		if(flag == "-s") {
+			opts.socket_path = value;
+		} else if(flag == "-n") {
+			opts.entries = std::strtoull(value, nullptr, 10);
+		} else if(flag == "-p") {
+			opts.per_subject = std::strtoull(value, nullptr, 10);
+		} else if(flag == "-c") {
+			opts.connections = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+		} else if(flag == "-d") {
+			opts.depths = parse_sizes(value);
+		} else if(flag == "-o") {
+			opts.requests = std::strtoull(value, nullptr, 10);
+		} else if(flag == "-r") {
+			opts.read_ratio = std::strtod(value, nullptr);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if(opts.entries == 0) {
+		usage(argv[0]);
+	}
+	// Serves the acl in-process unless a running daemon is given.
+	std::unique_ptr<libs::acl::acl<std::string, std::string>> local;
+	std::unique_ptr<libs::daemon::server<std::string, std::string>> server;
+	std::thread serving;
+	std::string path = opts.socket_path;
+	if(path.empty()) {
+		path = "/tmp/access_list_load_" + std::to_string(::getpid()) + ".sock";
+		local = std::make_unique<libs::acl::acl<std::string, std::string>>();
+		server = std::make_unique<libs::daemon::server<std::string, std::string>>(*local, path);
+		serving = std::thread([&server] {
+			server->run();
+		});
+	}
+	const std::vector<std::pair<std::string, size_t>> entries = populate(path, opts);
+	std::printf("%-11s %6s %10s %12s %10s %10s %10s\n", "connections", "depth", "requests", "requests/s", "p50_us", "p99_us", "p999_us");
+	for(const size_t depth : opts.depths) {
+		std::vector<std::vector<std::uint32_t>> latencies(opts.connections);
+		std::vector<std::thread> threads;
+		const clock_type::time_point start = clock_type::now();
+		for(size_t t = 0; t < opts.connections; ++t) {
+			threads.emplace_back(connection, std::cref(path), std::cref(opts), std::max<size_t>(1, depth), std::cref(entries),
+					static_cast<unsigned>(t + 1), std::ref(latencies[t]));
+		}
+		for(std::thread& th : threads) {
+			th.join();
+		}
+		const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+		std::vector<std::uint32_t> all;
+		for(const std::vector<std::uint32_t>& l : latencies) {
+			all.insert(all.end(), l.begin(), l.end());
+		}
+		std::sort(all.begin(), all.end());
+		std::printf("%-11zu %6zu %10zu %12.0f %10.1f %10.1f %10.1f\n", opts.connections, depth, all.size(),
+				seconds > 0 ? all.size() / seconds : 0.0, percentile(all, 0.5), percentile(all, 0.99), percentile(all, 0.999));
+	}
+	if(server) {
+		server->stop();
+		serving.join();
+		std::printf("The in-process daemon answered %zu requests by %zu batched checks\n", server->requests(), server->batches());
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+/// file: daemon.cpp
+///
+/// Serves one acl of string subjects and string resources to the local processes, see `server.hpp`.
+/// Usage: access_list_daemon -s <socket path> [-f <snapshot>] [-j <journal>] [-m <shared memory name>] [-n]
+/// The snapshot is loaded at the start if it exists and saved back on SIGINT or SIGTERM. The journal is
+/// replayed on top of it and the mutations are appended to it, synced unless -n is given. Once the snapshot
+/// is saved, at the start after a replay and at the exit, the journal is started anew. With -m the acl
+/// is published into the shared memory as well, the local processes check it in place by `shared::reader`.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include "acl.hpp"
+#include "journal.hpp"
+#include "server.hpp"
+#include "shared_acl.hpp"
+
+namespace {
+
+using acl_type = libs::acl::acl<std::string, std::string>;
+using server_type = libs::daemon::server<std::string, std::string>;
+
+server_type* g_server = nullptr;
+
+void on_signal(int) {
+	if(g_server) {
+		g_server->stop();
+	}
+}
+
+void usage(const char* name) {
+	std::fprintf(stderr, "Usage: %s -s <socket path> [-f <snapshot>] [-j <journal>] [-m <shared memory name>] [-n]\n", name);
+	std::exit(1);
+}
+}
+
+int main(int argc, char** argv) {
+	std::string socket_path;
+	std::string snapshot_path;
+	std::string journal_path;
+	std::string shared_name;
+	bool sync = true;
+	for(int i = 1; i < argc; ++i) {
+		const std::string flag = argv[i];
+		if(flag == "-n") {
+			sync = false;
+			continue;
+		}
+		if(i + 1 >= argc) {
+			usage(argv[0]);
+		}
+		const char* value = argv[++i];
+		if(flag == "-s") {
+			socket_path = value;
+		} else if(flag == "-f") {
+			snapshot_path = value;
+		} else if(flag == "-j") {
+			journal_path = value;
+		} else if(flag == "-m") {
+			shared_name = value;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if(socket_path.empty()) {
+		usage(argv[0]);
+	}
+	try {
+		acl_type a;
+		if(!snapshot_path.empty() && ::access(snapshot_path.c_str(), F_OK) == 0) {
+			a.load(snapshot_path);
+		}
+		std::unique_ptr<libs::journal::writer> journal;
+		if(!journal_path.empty()) {
+			const size_t replayed = ::access(journal_path.c_str(), F_OK) == 0 ? a.replay(journal_path) : 0;
+			journal = std::make_unique<libs::journal::writer>(journal_path, sync);
+			if(replayed != 0 && !snapshot_path.empty()) {
+				// The replayed records are folded into the snapshot, so the next start does not replay them again.
+				a.save(snapshot_path);
+				journal->reset();
+			}
+			a.attach_journal(journal.get());
+		}
+		std::unique_ptr<libs::shared::writer> shared;
+		if(!shared_name.empty()) {
+			shared = std::make_unique<libs::shared::writer>(shared_name);
+			a.attach_shared(shared.get());
+		}
+		server_type s(a, socket_path, journal.get());
+		g_server = &s;
+		std::signal(SIGINT, on_signal);
+		std::signal(SIGTERM, on_signal);
+		std::printf("Serving %zu subjects on %s\n", a.size(), socket_path.c_str());
+		std::fflush(stdout);
+		s.run();
+		g_server = nullptr;
+		if(!snapshot_path.empty()) {
+			a.save(snapshot_path);
+			if(journal) {
+				journal->reset();
+			}
+		}
+		std::printf("Served %zu requests by %zu batched checks\n", s.requests(), s.batches());
+	} catch(const libs::exception::custom_exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
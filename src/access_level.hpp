@@ -1,66 +1,165 @@
 #ifndef __ACCESS_LEVEL_HPP__
 #define __ACCESS_LEVEL_HPP__
 
+#include <cstdint>
 #include <string>
-#include <unordered_set>
+#include <string_view>
 
 #include "exception.hpp"
- 
+#include "status.hpp"
+
 /// file: access_level.hpp
 
 namespace libs {
 	namespace enums {
+/**
+ * @brief Enumerates the rights which could be granted on a resource, combinable as a bitmask.
+ */
+enum class rights : std::uint8_t {
+	none  = 0,
+	read  = 1 << 0,
+	write = 1 << 1,
+	exec  = 1 << 2,
+	admin = 1 << 3,
+	all   = read | write | exec | admin
+};
+
+constexpr rights operator|(rights lhs, rights rhs) noexcept {
+	return static_cast<rights>(static_cast<std::uint8_t>(lhs) | static_cast<std::uint8_t>(rhs));
+}
+
+constexpr rights operator&(rights lhs, rights rhs) noexcept {
+	return static_cast<rights>(static_cast<std::uint8_t>(lhs) & static_cast<std::uint8_t>(rhs));
+}
+
+constexpr rights operator~(rights r) noexcept {
+	return static_cast<rights>(~static_cast<std::uint8_t>(r) & static_cast<std::uint8_t>(rights::all));
+}
+
 /**
  * @brief Encapsulates the access level specific information of the resource.
+ *
+ * The state is a single byte of `rights` bits, so copying, granting and checking never allocate.
  */
 class access_level {
 	private:
-		std::unordered_set<std::string> valid_access_specifiers{"allowed", "forbiden"};
-		mutable std::string m_access;
-		bool is_valid_access_specifier(const std::string& access_specifier) {
-			return valid_access_specifiers.find(access_specifier) != valid_access_specifiers.end();
+		rights m_rights{rights::none};
+		static bool parse_token(std::string_view token, rights& r) noexcept {
+			if(token == "allowed") {
+				r = rights::all;
+			} else if(token == "forbiden") {
+				r = rights::none;
+			} else if(token == "read") {
+				r = rights::read;
+			} else if(token == "write") {
+				r = rights::write;
+			} else if(token == "exec") {
+				r = rights::exec;
+			} else if(token == "admin") {
+				r = rights::admin;
+			} else {
+				return false;
+			}
+			return true;
+		}
+		// Parses the specifier, the invalid token is returned through `bad`.
+		static bool parse_into(std::string_view spec, rights& parsed, std::string_view& bad) noexcept {
+			parsed = rights::none;
+			std::string_view::size_type begin = 0;
+			do {
+				const std::string_view::size_type end = spec.find('|', begin);
+				const std::string_view token = spec.substr(begin, end == std::string_view::npos ? end : end - begin);
+				rights r = rights::none;
+				if(!parse_token(token, r)) {
+					bad = token;
+					return false;
+				}
+				parsed = parsed | r;
+				begin = end == std::string_view::npos ? end : end + 1;
+			} while(begin != std::string_view::npos);
+			return true;
 		}
-	public: 
+	public:
+		/**
+		 * The default constructor, the access level is `forbiden`
+		 */
+		constexpr access_level() noexcept = default;
 		/**
-		 * The constructor with one argument
+		 * The constructor with the set of granted rights
 		 *
-		 * \param access_level a const std::string argument defines the access level
+		 * \param r the granted rights
 		 */
-		access_level(const std::string& access_level) {
-			if (is_valid_access_specifier(access_level)) {
-				m_access = access_level;
-			} else {
-				std::string msg = std::string("Error: Invalid access level specifier: ") + access_level;
-				throw libs::exception::custom_exception(msg.c_str());
-			}
-
-		}
+		constexpr access_level(rights r) noexcept: m_rights(r) {}
 		/**
-		 * The copy constructor
+		 * The parsing constructor kept for the string based specifiers.
+		 * Accepts `allowed`, `forbiden` or rights names joined by `|`, e.g. `read|write`.
 		 *
-		 * \param rhs an object that should be copyed
+		 * \param access_level a const std::string argument defines the access level
 		 */
-		access_level(const access_level& rhs) {
-			m_access = rhs.m_access;
+		access_level(const std::string& access_level) {
+			std::string_view bad;
+			if(!parse_into(access_level, m_rights, bad)) {
+				std::string msg = std::string("Error: Invalid access level specifier: ") + std::string(bad);
+				libs::exception::raise(msg.c_str());
+			}
 		}
 		/**
-		 * The assignment operator
-		 *
-		 * \param rhs an object that should be copy/assigned
+		 * Parses the string based specifier without raising, see the parsing constructor
+		 * \param spec the access level specifier
+		 * @returns `status::result<access_level>` the access level or `status::code::invalid_access_level`
 		 */
-		access_level& operator=(const access_level& rhs) {
-			if(&rhs == this) {
-				return *this;
+		static status::result<access_level> parse(std::string_view spec) noexcept {
+			rights r = rights::none;
+			std::string_view bad;
+			if(!parse_into(spec, r, bad)) {
+				return status::code::invalid_access_level;
 			}
-			m_access = rhs.m_access;
-			return *this;
+			return access_level(r);
 		}
 		/**
 		 * Returns the access level of the resource
-		 * @returns `std::string`
+		 * @returns `std::string` `allowed` if any right is granted, `forbiden` otherwise
 		 */
 		std::string get_access_level() const {
-			return m_access;
+			return is_allowed() ? "allowed" : "forbiden";
+		}
+		/**
+		 * Returns the granted rights
+		 * @returns `rights`
+		 */
+		constexpr rights get_rights() const noexcept {
+			return m_rights;
+		}
+		/**
+		 * Checks whether any right is granted
+		 * @returns `bool`
+		 */
+		constexpr bool is_allowed() const noexcept {
+			return m_rights != rights::none;
+		}
+		/**
+		 * Checks whether the required rights are granted, `rights::none` stands for any right
+		 * \param required the rights to check
+		 * @returns `bool`
+		 */
+		constexpr bool permits(rights required) const noexcept {
+			return required == rights::none ? is_allowed() : (m_rights & required) == required;
+		}
+		/**
+		 * Grants the specified rights
+		 * \param r the rights to grant
+		 * @returns `void`
+		 */
+		constexpr void grant(rights r) noexcept {
+			m_rights = m_rights | r;
+		}
+		/**
+		 * Revokes the specified rights
+		 * \param r the rights to revoke
+		 * @returns `void`
+		 */
+		constexpr void revoke(rights r) noexcept {
+			m_rights = m_rights & ~r;
 		}
 };
 }
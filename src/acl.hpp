@@ -1,15 +1,39 @@
 #ifndef __ACL_HPP__
 #define __ACL_HPP__
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "access_level.hpp"
+#include "audit.hpp"
 #include "exception.hpp"
+#include "frozen_acl.hpp"
+#include "journal.hpp"
+#include "metrics.hpp"
+#include "path_trie.hpp"
 #include "resource.hpp"
+#include "roles.hpp"
+#include "serializer.hpp"
+#include "shared_acl.hpp"
+#include "snapshot.hpp"
+#include "status.hpp"
+#include "storage.hpp"
 #include "subject.hpp"
- 
+#include "subject_table.hpp"
+#include "timer_wheel.hpp"
+
 /// file: acl.hpp
 
 namespace libs {
@@ -22,26 +46,487 @@ template <typename U> struct hasher;
  */
 template <typename S, typename R>
 class acl {
-	struct hasher_sub {
-		std::size_t operator() (subjects::subject<S>& obj) const {
-			return std::hash<S>()(obj.get_id());
+	public:
+		using handle_type = subjects::subject_handle;
+		using view_type = typename subjects::subject_table<S>::view_type;
+		using clock = std::chrono::system_clock;
+		/**
+		 * @brief A grant as visited by the scans, valid until the acl is modified.
+		 */
+		struct grant_view {
+			handle_type subject;
+			size_t uuid{};
+			// The rights in effect at the time of the scan, the lapsed ones are left out.
+			enums::rights rights{enums::rights::none};
+			// The expiry time in nanoseconds since the epoch of the system clock, 0 if the grant does not expire.
+			std::int64_t expires{};
+			// The data of the resource, nullptr if it has been popped.
+			const R* resource{nullptr};
+		};
+	private:
+		// Interns the subjects, the handle value is the index of the subject's record in m_subjects. The ids and
+		// records outlive the removal of their subjects, so the handles stay valid and a re-added subject gets its
+		// own back, they grow with the distinct subjects ever added while the grants are released.
+		subjects::subject_table<S> m_table;
+		std::pmr::vector<storage::subject_slots> m_subjects;
+		storage::grant_store<R> m_store;
+		roles::role_graph m_roles;
+		paths::path_trie m_paths;
+		// Created by the first expiring grant, ticks by a millisecond.
+		std::optional<timers::timer_wheel> m_expiries;
+		size_t m_uuid{1};
+		size_t m_size{};
+		journal::writer* m_journal{nullptr};
+		shared::writer* m_shared{nullptr};
+		audit::writer* m_audit{nullptr};
+		std::uint64_t m_lsn{};
+		std::string m_record;
+		mutable metrics::registry<> m_metrics;
+		static constexpr size_t prefetch_distance = 8;
+		handle_type intern_id(const S& id) {
+			// The record is made room for ahead, so the interned id always gets one.
+			if(m_subjects.size() == m_subjects.capacity()) {
+				m_subjects.reserve(std::max<size_t>(16, 2 * m_subjects.size()));
+			}
+			const size_t buckets = metrics::enabled ? m_table.bucket_count() : 0;
+			handle_type h = m_table.intern(id);
+			if(metrics::enabled && buckets != m_table.bucket_count()) {
+				m_metrics.count(metrics::counter::subject_rehash);
+			}
+			if(h.value == m_subjects.size()) {
+				m_subjects.emplace_back();
+			}
+			return h;
+		}
+		handle_type find_handle(const subjects::subject<S>& sub) const noexcept {
+			const S* id = sub.try_get_id();
+			return id ? m_table.find(subjects::key_traits<S>::view(*id)) : handle_type{};
+		}
+		storage::subject_slots* find_subject(const handle_type h) noexcept {
+			if(h.value >= m_subjects.size() || !m_subjects[h.value].present) {
+				return nullptr;
+			}
+			return &m_subjects[h.value];
+		}
+		storage::slot<R>* find_slot(const handle_type h, const size_t uuid) noexcept {
+			storage::slot<R>* s = m_store.find(uuid);
+			return s && s->subject == h.value ? s : nullptr;
+		}
+		static std::int64_t to_ns(const clock::time_point t) noexcept {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+		}
+		// Gets the rights of the grant in effect at the time, the expired ones are left out even before they are reclaimed.
+		static enums::rights rights_at(const storage::slot<R>& s, const std::int64_t now) noexcept {
+			if(s.expires != 0 && s.expires <= now) {
+				return s.expires_grant ? enums::rights::none : s.access.get_rights() & ~s.expiring;
+			}
+			return s.access.get_rights();
+		}
+		// Checks the rights of the grant, the expired ones are forbidden even before they are reclaimed.
+		static bool permits(const storage::slot<R>& s, const enums::rights required) noexcept {
+			if(s.expires != 0) {
+				return enums::access_level(rights_at(s, to_ns(clock::now()))).permits(required);
+			}
+			return s.access.permits(required);
+		}
+		static grant_view view_of(const storage::slot<R>& s, const std::int64_t now) noexcept {
+			return grant_view{handle_type{s.subject}, s.uuid, rights_at(s, now), s.expires, s.resource.get()};
+		}
+		// Gets the number of the parts a scan of n items is split into, the small scans stay on the calling thread.
+		static unsigned parts_of(const size_t n, const unsigned threads) noexcept {
+			return std::max(1u, std::min(threads, static_cast<unsigned>(std::min<size_t>(n / 4096 + 1, ~0u))));
+		}
+		void schedule_expiry(storage::slot<R>& s, const std::int64_t expires, const enums::rights expiring, const bool grant) {
+			s.expires = expires;
+			s.expiring = expiring;
+			s.expires_grant = grant;
+			// The zero expiry clears it, its stale timer is ignored when it fires.
+			if(expires != 0) {
+				if(!m_expiries) {
+					m_expiries.emplace(1000000, to_ns(clock::now()), get_memory_resource());
+				}
+				m_expiries->schedule(timers::timer{expires, s.uuid, s.generation});
+			}
+		}
+		void set_expiry(storage::slot<R>& s, const std::int64_t expires, const enums::rights expiring, const bool grant) {
+			schedule_expiry(s, expires, expiring, grant);
+			log(journal::op::expire, [&s](std::string& out) {
+				put_expiry(out, s);
+			});
+		}
+		static void put_expiry(std::string& out, const storage::slot<R>& s) {
+			journal::put(out, static_cast<std::uint64_t>(s.uuid));
+			journal::put(out, static_cast<std::uint8_t>(s.expiring));
+			journal::put(out, static_cast<std::uint8_t>(s.expires_grant));
+			journal::put(out, s.expires);
+		}
+		// Checks whether the grant applies to the subject, i.e. the subject owns it or belongs to its owner role.
+		bool applies(const handle_type h, const storage::slot<R>& s) const noexcept {
+			return s.subject == h.value || m_roles.is_member(h.value, s.subject);
+		}
+		status::code check(const handle_type h, const size_t uuid) noexcept {
+			if(!find_subject(h)) {
+				return status::code::unknown_subject;
+			}
+			return find_slot(h, uuid) ? status::code::ok : status::code::unknown_resource;
+		}
+		void mark_present(const handle_type h) noexcept {
+			if(!m_subjects[h.value].present) {
+				m_subjects[h.value].present = true;
+				++m_size;
+			}
+		}
+		void log_add(const storage::slot<R>& s) {
+			log(journal::op::add, [&](std::string& out) {
+				// Only the journal keeps the resources, the shared segment does not.
+				put_grant(out, s, m_journal != nullptr);
+			});
+		}
+		void put_grant(std::string& out, const storage::slot<R>& s, const bool with_resource) const {
+			journal::put(out, static_cast<std::uint64_t>(s.uuid));
+			journal::put(out, static_cast<std::uint8_t>(s.access.get_rights()));
+			put_subject(out, handle_type{s.subject});
+			std::uint8_t stored = 0;
+			if constexpr(serialization::is_serializable<R>) {
+				if(with_resource && s.resource) {
+					stored = 1;
+					journal::put(out, stored);
+					std::string bytes;
+					serialization::serializer<R>::write(bytes, *s.resource.get());
+					journal::put_bytes(out, bytes);
+				}
+			}
+			if(!stored) {
+				journal::put(out, stored);
+			}
+		}
+		static const S& id_of(const subjects::subject<S>& sub) noexcept {
+			return sub.get_id();
+		}
+		static const S& id_of(const S& id) noexcept {
+			return id;
+		}
+		template <typename G>
+		static const S& subject_of(G& grant) noexcept {
+			auto& [sub, res, access] = grant;
+			static_cast<void>(res);
+			static_cast<void>(access);
+			return id_of(sub);
+		}
+		template <typename G>
+		static enums::access_level access_of(G& grant) {
+			auto& [sub, res, access] = grant;
+			static_cast<void>(sub);
+			static_cast<void>(res);
+			return enums::access_level(access);
+		}
+		// Runs the mutation of a `try_*` call, the errors it raises, i.e. the failed allocations and the failed writes of
+		// the journal or the shared segment, are returned as the codes.
+		template <typename F>
+		static status::code guarded(F f) noexcept {
+#if ACL_EXCEPTIONS
+			try {
+				f();
+			} catch(const std::bad_alloc&) {
+				return status::code::out_of_memory;
+			} catch(...) {
+				return status::code::io_error;
+			}
+#else
+			f();
+#endif
+			return status::code::ok;
+		}
+		// Runs f(begin, end, part) over the parts of [0, n), rethrows the first exception of the threads.
+		template <typename F>
+		static void parallel_for(const size_t n, const unsigned threads, F f) {
+			if(threads <= 1 || n < threads) {
+				f(size_t(0), n, 0u);
+				return;
+			}
+			std::vector<std::thread> workers;
+			workers.reserve(threads);
+#if ACL_EXCEPTIONS
+			std::vector<std::exception_ptr> errors(threads);
+			for(unsigned t = 0; t < threads; ++t) {
+				workers.emplace_back([&, t] {
+					try {
+						f(n * t / threads, n * (t + 1) / threads, t);
+					} catch(...) {
+						errors[t] = std::current_exception();
+					}
+				});
+			}
+			for(std::thread& w : workers) {
+				w.join();
+			}
+			for(const std::exception_ptr& e : errors) {
+				if(e) {
+					std::rethrow_exception(e);
+				}
+			}
+#else
+			for(unsigned t = 0; t < threads; ++t) {
+				workers.emplace_back([&, t] {
+					f(n * t / threads, n * (t + 1) / threads, t);
+				});
+			}
+			for(std::thread& w : workers) {
+				w.join();
+			}
+#endif
+		}
+		void log_membership(const journal::op o, const handle_type role, const handle_type member) {
+			log(o, [this, role, member](std::string& out) {
+				put_subject(out, role);
+				put_subject(out, member);
+			});
+		}
+		// Appends the record of the mutation to the attached journal and applies it to the attached shared segment,
+		// if any, fill(out) writes the payload.
+		template <typename F>
+		void log(const journal::op o, F fill) {
+			if(m_journal || m_shared) {
+				m_record.clear();
+				fill(m_record);
+				if(m_journal) {
+					m_lsn = m_journal->append(o, m_record);
+				}
+				if(m_shared) {
+					m_shared->apply(o, m_record);
+				}
+			}
+		}
+		// Records the decision into the attached audit log, if any.
+		void record_audit(const audit::op o, const handle_type h, const size_t uuid, const bool decision) const noexcept {
+			if(m_audit) {
+				m_audit->record_op(o, h.value, uuid, decision);
+			}
+		}
+		// Publishes the whole state into the attached shared segment as a single update.
+		void publish_shared() {
+			shared::writer::update u(m_shared);
+			m_shared->clear();
+			std::string key;
+			for(std::uint32_t h = 0; h < m_subjects.size(); ++h) {
+				if(m_subjects[h].present) {
+					key.clear();
+					serialization::serializer<S>::write(key, m_table.get_id(handle_type{h}));
+					m_shared->add_subject(key);
+				}
+			}
+			m_store.for_each([this](const storage::slot<R>& s) {
+				m_record.clear();
+				put_grant(m_record, s, false);
+				m_shared->apply(journal::op::add, m_record);
+				if(s.expires != 0) {
+					m_record.clear();
+					put_expiry(m_record, s);
+					m_shared->apply(journal::op::expire, m_record);
+				}
+			});
+		}
+		void put_subject(std::string& out, const handle_type h) const {
+			if constexpr(serialization::is_serializable<S>) {
+				const size_t at = out.size();
+				journal::put(out, std::uint32_t{});
+				serialization::serializer<S>::write(out, m_table.get_id(h));
+				const std::uint32_t size = static_cast<std::uint32_t>(out.size() - at - sizeof(std::uint32_t));
+				std::memcpy(&out[at], &size, sizeof(size));
+			}
 		}
-	};
-	struct hasher_res {
-		std::size_t operator() (size_t key) const {
-			return std::hash<size_t>()(key);
+		void log_grant(const journal::op o, const size_t uuid, const enums::rights r) {
+			log(o, [uuid, r](std::string& out) {
+				journal::put(out, static_cast<std::uint64_t>(uuid));
+				journal::put(out, static_cast<std::uint8_t>(r));
+			});
 		}
-	};
-	std::unordered_map<subjects::subject<S>&&, std::unordered_map<size_t, 
-		                                            std::pair<std::unique_ptr<resources::resource<R>>, enums::access_level>, 
-							    hasher_res>, 
-					 hasher_sub> m_map;
-	size_t m_uuid{1};
-	public: 
+		// Applies a replayed journal record.
+		void apply(const journal::op o, journal::payload in) {
+			std::uint64_t uuid = 0;
+			std::uint8_t rights = 0;
+			std::string_view key;
+			S id{};
+			switch(o) {
+				case journal::op::add: {
+					std::uint8_t stored = 0;
+					if(!in.get(uuid) || !in.get(rights) || !in.get_bytes(key) || !in.get(stored) ||
+							uuid == 0 || !serialization::serializer<S>::read(key, id)) {
+						libs::exception::raise("Error: Invalid journal: malformed record");
+					}
+					const handle_type h = intern_id(id);
+					storage::subject_slots& owner = m_subjects[h.value];
+					if(!owner.present) {
+						owner.present = true;
+						++m_size;
+					}
+					if(m_uuid <= uuid) {
+						m_uuid = uuid + 1;
+					}
+					if(m_store.find(uuid)) {
+						return;
+					}
+					storage::slot<R>& s = m_store.acquire(uuid, owner, h.value);
+					s.access = enums::access_level(static_cast<enums::rights>(rights));
+					if constexpr(serialization::is_serializable<R>) {
+						std::string_view bytes;
+						R value{};
+						if(stored) {
+							if(!in.get_bytes(bytes) || !serialization::serializer<R>::read(bytes, value)) {
+								libs::exception::raise("Error: Invalid journal: malformed resource");
+							}
+							s.resource.emplace(std::move(value));
+						}
+					}
+					return;
+				}
+				case journal::op::add_member:
+				case journal::op::remove_member: {
+					S role_id{};
+					std::string_view role_key;
+					if(!in.get_bytes(role_key) || !in.get_bytes(key) ||
+							!serialization::serializer<S>::read(role_key, role_id) || !serialization::serializer<S>::read(key, id)) {
+						libs::exception::raise("Error: Invalid journal: malformed record");
+					}
+					const handle_type role = intern_id(role_id);
+					const handle_type member = intern_id(id);
+					if(o == journal::op::add_member) {
+						// A membership undone later may close a cycle with the state of a later snapshot, it is skipped.
+						if(role != member && !m_roles.is_member(role.value, member.value)) {
+							add_member(role, member);
+						}
+					} else {
+						remove_member(role, member);
+					}
+					return;
+				}
+				case journal::op::remove_subject:
+					if(!in.get_bytes(key) || !serialization::serializer<S>::read(key, id)) {
+						libs::exception::raise("Error: Invalid journal: malformed record");
+					}
+					remove(m_table.find(subjects::key_traits<S>::view(id)));
+					return;
+				default:
+					break;
+			}
+			if(!in.get(uuid) || !in.get(rights)) {
+				libs::exception::raise("Error: Invalid journal: malformed record");
+			}
+			storage::slot<R>* s = m_store.find(uuid);
+			if(!s) {
+				return;
+			}
+			std::uint8_t grant = 0;
+			std::int64_t expires = 0;
+			switch(o) {
+				case journal::op::expire:
+					if(!in.get(grant) || !in.get(expires)) {
+						libs::exception::raise("Error: Invalid journal: malformed record");
+					}
+					set_expiry(*s, expires, static_cast<enums::rights>(rights), grant != 0);
+					break;
+				case journal::op::allow:
+					s->access.grant(static_cast<enums::rights>(rights));
+					s->expiring = s->expiring & ~static_cast<enums::rights>(rights);
+					break;
+				case journal::op::forbid:
+					s->access.revoke(static_cast<enums::rights>(rights));
+					break;
+				case journal::op::remove_grant:
+					m_store.release(*s, m_subjects[s->subject]);
+					break;
+				case journal::op::pop:
+					s->resource.reset();
+					break;
+				default:
+					libs::exception::raise("Error: Invalid journal: unknown record");
+			}
+		}
+		std::vector<std::pair<handle_type, size_t>> resolve(const std::vector<std::pair<view_type, size_t>>& checks) const {
+			std::vector<std::pair<handle_type, size_t>> resolved;
+			resolved.reserve(checks.size());
+			handle_type h;
+			for(size_t i = 0; i < checks.size(); ++i) {
+				if(i == 0 || !(checks[i].first == checks[i - 1].first)) {
+					h = m_table.find(checks[i].first);
+				}
+				resolved.emplace_back(h, checks[i].second);
+			}
+			return resolved;
+		}
+		// Calls f(i, handle, slot) for every check while prefetching the index entries and the slots ahead.
+		template <typename F>
+		void for_each_prefetched(const std::pair<handle_type, size_t>* checks, const size_t count, F f) noexcept {
+			const size_t warmup = count < 2 * prefetch_distance ? count : 2 * prefetch_distance;
+			for(size_t i = 0; i < warmup; ++i) {
+				m_store.prefetch_index(checks[i].second);
+			}
+			for(size_t i = 0; i < count && i < prefetch_distance; ++i) {
+				m_store.prefetch_slot(checks[i].second);
+			}
+			for(size_t i = 0; i < count; ++i) {
+				if(i + 2 * prefetch_distance < count) {
+					m_store.prefetch_index(checks[i + 2 * prefetch_distance].second);
+				}
+				if(i + prefetch_distance < count) {
+					m_store.prefetch_slot(checks[i + prefetch_distance].second);
+				}
+				f(i, checks[i].first, m_store.find(checks[i].second));
+			}
+		}
+	public:
+		/**
+		 * The default constructor, the acl allocates from the default memory resource
+		 */
+		acl(): acl(std::pmr::get_default_resource()) {}
+		/**
+		 * The constructor with the memory resource, e.g. an arena, which backs all the internal tables.
+		 * The resources are allocated by the caller and are not affected.
+		 * \param mr the memory resource, it must outlive the acl
+		 */
+		explicit acl(std::pmr::memory_resource* mr): m_table(mr), m_subjects(mr), m_store(mr), m_roles(mr), m_paths(mr) {}
 		/**
-		 * The defaulted constructor
+		 * Gets the memory resource of the internal tables
+		 * @returns `std::pmr::memory_resource*`
 		 */
-		acl() = default;
+		std::pmr::memory_resource* get_memory_resource() const noexcept {
+			return m_subjects.get_allocator().resource();
+		}
+		/**
+		 * Interns the subject, the handle could be used instead of the subject in the rest of the calls
+		 * \param sub the subject
+		 * @returns `handle_type` the handle of the subject, stable for the lifetime of the acl
+		 */
+		handle_type intern(const subjects::subject<S>& sub) {
+			return intern_id(sub.get_id());
+		}
+		/**
+		 * Looks up the handle of the subject id without copying it
+		 * \param id the id of the subject, e.g. `std::string_view` for `std::string` subjects
+		 * @returns `handle_type` the handle, invalid if the subject has never been added or interned
+		 */
+		handle_type find(const view_type& id) const noexcept {
+			// Finds the handle in O(1) - averrage.
+			return m_table.find(id);
+		}
+		/**
+		 * Gets the id of the interned subject
+		 * \param h a valid handle of the subject
+		 * @returns `const S&`
+		 */
+		const S& get_id(const handle_type h) const {
+			return m_table.get_id(h);
+		}
+		/**
+		 * Finds the subject which owns the resource
+		 * \param uuid the uuid of the resource
+		 * @returns `handle_type` the handle of the owner, invalid if the resource does not exist
+		 */
+		handle_type owner(const size_t uuid) const noexcept {
+			// Finds the owner in O(1) through the uuid index.
+			const storage::slot<R>* s = m_store.find(uuid);
+			return s ? handle_type{s->subject} : handle_type{};
+		}
 		/**
 		 * Adds the resource to the specified subject
 		 * \param sub the subject
@@ -49,79 +534,599 @@ class acl {
 		 * \param access the access level for the resource, by default it is set to be `forbiden`
 		 * @returns `size_t` the uuid of the added resource
 		 */
-		size_t add(subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res, 
-				const std::string& access = std::string("forbiden")) {
+		size_t add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access = enums::access_level()) {
+			return add(intern(sub), std::move(res), access);
+		}
+		/**
+		 * Adds the resource to the specified subject, parses the string access level specifier
+		 * \param sub the subject
+		 * \param res the resource
+		 * \param access the access level specifier, e.g. `allowed`, `forbiden` or `read|write`
+		 * @returns `size_t` the uuid of the added resource
+		 */
+		size_t add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res, const std::string& access) {
+			return add(intern(sub), std::move(res), enums::access_level(access));
+		}
+		/**
+		 * Adds the resource to the interned subject
+		 * \param h the handle of the subject
+		 * \param res the resource
+		 * \param access the access level for the resource, by default it is set to be `forbiden`
+		 * @returns `size_t` the uuid of the added resource
+		 */
+		size_t add(const handle_type h, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access = enums::access_level()) {
+			// Adds the resource in O(1) - amortized.
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::add);
+			if(h.value >= m_subjects.size()) {
+				libs::exception::raise("Error: Invalid subject handle");
+			}
+			storage::subject_slots& owner = m_subjects[h.value];
+			mark_present(h);
 			res.get()->set_uuid(m_uuid);
-			std::pair<size_t, std::pair<std::unique_ptr<resources::resource<R>>, 
-				enums::access_level>> pair = std::make_pair(m_uuid, 
-						std::make_pair(std::move(res), 
-							enums::access_level(access)));
-			m_map[std::move(sub)].insert(std::move(pair));
+			const size_t capacity = metrics::enabled ? m_store.capacity() : 0;
+			storage::slot<R>& s = m_store.acquire(m_uuid, owner, h.value);
+			if(metrics::enabled) {
+				m_metrics.count(metrics::counter::add);
+				if(capacity != m_store.capacity()) {
+					m_metrics.count(metrics::counter::store_growth);
+				}
+			}
+			s.resource = std::move(res->get_payload());
+			s.access = access;
 			size_t uuid = m_uuid;
 			++m_uuid;
+			log_add(s);
+			return uuid;
+		}
+		/**
+		 * Bulk-adds the grants in one pass: the tables are sized once, the grants get a contiguous block of uuids
+		 * in the order of the range and the slots are filled by the threads. The subjects are deduplicated by
+		 * every thread on its own part, only the distinct ones are interned afterwards.
+		 * \param grants the random access range of the (subject, resource, access level) tuples or structs, the subject
+		 * is either `subjects::subject<S>` or `S`, the resources are moved out of the range
+		 * \param threads the number of the threads to build with, 1 builds on the calling thread
+		 * @returns `std::pair<size_t, size_t>` the range [first, last) of the uuids assigned
+		 */
+		template <typename Range>
+		std::pair<size_t, size_t> add_all(Range& grants, unsigned threads = 1) {
+			// Adds the grants in O(n / t) on t threads, plus O(n) to link them.
+			using std::begin;
+			using std::end;
+			auto first = begin(grants);
+			const size_t n = static_cast<size_t>(end(grants) - first);
+			const size_t first_uuid = m_uuid;
+			if(n == 0) {
+				return {first_uuid, first_uuid};
+			}
+			if(threads == 0 || n < threads) {
+				threads = 1;
+			}
+			// The local ids of the subjects first, they are replaced by the handles once interned. The access levels
+			// are parsed by the same pass, so nothing raises once the slots are taken.
+			std::vector<std::uint32_t> handles(n);
+			std::vector<enums::access_level> levels(n);
+			std::vector<subjects::batch_ids<S>> distinct(threads);
+			parallel_for(n, threads, [&](const size_t from, const size_t to, const unsigned part) {
+				// The ids are hashed a few entries ahead, so their buckets are prefetched by the time they are added.
+				constexpr size_t ahead = 8;
+				size_t hashes[ahead];
+				subjects::batch_ids<S>& ids = distinct[part];
+				const auto view = [&first](const size_t i) -> view_type {
+					return subjects::key_traits<S>::view(subject_of(first[i]));
+				};
+				for(size_t i = from; i < to && i < from + ahead; ++i) {
+					hashes[i % ahead] = ids.hash(view(i));
+				}
+				for(size_t i = from; i < to; ++i) {
+					levels[i] = access_of(first[i]);
+					const size_t hash = hashes[i % ahead];
+					if(i + 2 * ahead < to) {
+						storage::prefetch(&subject_of(first[i + 2 * ahead]));
+					}
+					if(i + ahead < to) {
+						hashes[i % ahead] = ids.hash(view(i + ahead));
+						ids.prefetch(hashes[i % ahead]);
+					}
+					handles[i] = ids.add(view(i), hash);
+				}
+			});
+			size_t upper = m_table.size();
+			for(const subjects::batch_ids<S>& ids : distinct) {
+				upper += ids.ids().size();
+			}
+			m_table.reserve(upper);
+			m_subjects.reserve(upper);
+			std::vector<std::vector<std::uint32_t>> interned(threads);
+			for(unsigned part = 0; part < threads; ++part) {
+				for(const view_type& id : distinct[part].ids()) {
+					interned[part].push_back(intern_id(S(id)).value);
+				}
+			}
+			const std::uint32_t base = m_store.extend(first_uuid, n);
+			m_uuid += n;
+			parallel_for(n, threads, [&](const size_t from, const size_t to, const unsigned part) {
+				for(size_t i = from; i < to; ++i) {
+					auto& [sub, res, access] = first[i];
+					static_cast<void>(sub);
+					static_cast<void>(access);
+					handles[i] = interned[part][handles[i]];
+					storage::slot<R>& s = m_store.assign(static_cast<std::uint32_t>(base + i), first_uuid + i, handles[i]);
+					if(res) {
+						res->set_uuid(first_uuid + i);
+						s.resource = std::move(res->get_payload());
+						res.reset();
+					}
+					s.access = levels[i];
+				}
+			});
+			for(size_t i = 0; i < n; ++i) {
+				mark_present(handle_type{handles[i]});
+				m_store.link(static_cast<std::uint32_t>(base + i), m_subjects[handles[i]]);
+			}
+			m_metrics.count(metrics::counter::add, n);
+			if(m_journal || m_shared) {
+				shared::writer::update u(m_shared);
+				for(size_t i = 0; i < n; ++i) {
+					log_add(*m_store.find(first_uuid + i));
+				}
+			}
+			return {first_uuid, first_uuid + n};
+		}
+		/**
+		 * Adds the resource to the specified subject for a limited time, the grant is forbidden once it expires
+		 * and is removed by `reclaim_expired`
+		 * \param sub the subject
+		 * \param res the resource
+		 * \param access the access level for the resource
+		 * \param expires the expiry time of the grant
+		 * @returns `size_t` the uuid of the added resource
+		 */
+		size_t add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access, const clock::time_point expires) {
+			return add(intern(sub), std::move(res), access, expires);
+		}
+		/**
+		 * Adds the resource to the interned subject for a limited time
+		 * \param h the handle of the subject
+		 * \param res the resource
+		 * \param access the access level for the resource
+		 * \param expires the expiry time of the grant
+		 * @returns `size_t` the uuid of the added resource
+		 */
+		size_t add(const handle_type h, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access, const clock::time_point expires) {
+			const size_t uuid = add(h, std::move(res), access);
+			set_expiry(*m_store.find(uuid), to_ns(expires), enums::rights::none, true);
 			return uuid;
 		}
 		/**
 		 * Allows an access to the specified resource within the specified subject
 		 * \param sub the subject
 		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant, by default all of them
 		 * @returns `void`
 		 */
-		void allow_access(subjects::subject<S>& sub, const size_t uuid) {
-			// Changes th access level in O(1) - averrage.
-			auto it = m_map.find(sub);
-			if(it != m_map.end()) {
-				auto itt = it->second.find(uuid);
-				if(itt != it->second.end()) {
-					itt->second.second = enums::access_level("allowed");
-				}
+		void allow_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) {
+			allow_access(find_handle(sub), uuid, r);
+		}
+		/**
+		 * Allows an access to the specified resource within the interned subject
+		 * \param h the handle of the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant, by default all of them
+		 * @returns `void`
+		 */
+		void allow_access(const handle_type h, const size_t uuid, enums::rights r = enums::rights::all) {
+			// Changes th access level in O(1).
+			storage::slot<R>* s = find_slot(h, uuid);
+			record_audit(audit::op::allow, h, uuid, s != nullptr);
+			if(s) {
+				s->access.grant(r);
+				s->expiring = s->expiring & ~r;
+				log_grant(journal::op::allow, uuid, r);
+			}
+		}
+		/**
+		 * Allows an access to the specified resource within the specified subject until the expiry time,
+		 * the granted rights lapse then, the latest expiry of the grant applies to all of its lapsing rights
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant
+		 * \param expires the time the rights lapse at
+		 * @returns `void`
+		 */
+		void allow_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r, const clock::time_point expires) {
+			allow_access(find_handle(sub), uuid, r, expires);
+		}
+		/**
+		 * Allows an access to the specified resource within the interned subject until the expiry time
+		 * \param h the handle of the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant
+		 * \param expires the time the rights lapse at
+		 * @returns `void`
+		 */
+		void allow_access(const handle_type h, const size_t uuid, enums::rights r, const clock::time_point expires) {
+			allow_access(h, uuid, r);
+			if(storage::slot<R>* s = find_slot(h, uuid)) {
+				set_expiry(*s, to_ns(expires), s->expiring | r, s->expires_grant);
 			}
 		}
 		/**
 		 * Forbids the access to the specified resource within the specified subject
 		 * \param sub the subject
 		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to revoke, by default all of them
 		 * @returns `void`
 		 */
-		void forbid_access(subjects::subject<S>& sub, const size_t uuid) {
-			// Changes th access level in O(1) - averrage.
-			auto it = m_map.find(sub);
-			if(it != m_map.end()) {
-				auto itt = it->second.find(uuid);
-				if(itt != it->second.end()) {
-					itt->second.second = enums::access_level("forbiden");
-				}
+		void forbid_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) {
+			forbid_access(find_handle(sub), uuid, r);
+		}
+		/**
+		 * Forbids the access to the specified resource within the interned subject
+		 * \param h the handle of the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to revoke, by default all of them
+		 * @returns `void`
+		 */
+		void forbid_access(const handle_type h, const size_t uuid, enums::rights r = enums::rights::all) {
+			// Changes th access level in O(1).
+			storage::slot<R>* s = find_slot(h, uuid);
+			record_audit(audit::op::forbid, h, uuid, s != nullptr);
+			if(s) {
+				s->access.revoke(r);
+				log_grant(journal::op::forbid, uuid, r);
 			}
 		}
 		/**
 		 * Checks whether or not the resource is allowed within the specified subject
 		 * \param sub the subject
 		 * \param res the resource
+		 * \param required the rights to check, by default any granted right is enough
 		 * @returns `bool` returns true if allowed, false vice versa.
 		 */
-		bool is_allowed(subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res) {
+		bool is_allowed(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				enums::rights required = enums::rights::none) {
+			return is_allowed(sub, *res, required);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject, the resource is not consumed
+		 * \param sub the subject
+		 * \param res the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const subjects::subject<S>& sub, const resources::resource<R>& res,
+				enums::rights required = enums::rights::none) noexcept {
+			return is_allowed(find_handle(sub), res.get_uuid(), required);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject or one of its roles
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const subjects::subject<S>& sub, const size_t uuid,
+				enums::rights required = enums::rights::none) noexcept {
 			// Chacks the access level in O(1) - averrage.
-			auto it = m_map.find(sub);
-			size_t uuid = res.get()->get_uuid();
-			if(it == m_map.end()) {
+			return is_allowed(find_handle(sub), uuid, required);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the interned subject
+		 * The grant of a role applies to all of its direct and nested members.
+		 * \param h the handle of the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const handle_type h, const size_t uuid, enums::rights required = enums::rights::none) noexcept {
+			// Chacks the access level in O(1).
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::is_allowed);
+			storage::slot<R>* s = m_store.find(uuid);
+			const bool allowed = s && applies(h, *s) && permits(*s, required);
+			m_metrics.count(allowed ? metrics::counter::is_allowed_hit : metrics::counter::is_allowed_miss);
+			record_audit(audit::op::is_allowed, h, uuid, allowed);
+			return allowed;
+		}
+		/**
+		 * Checks whether or not the resource is allowed within its owning subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const size_t uuid, enums::rights required = enums::rights::none) const noexcept {
+			// Chacks the access level in O(1) through the uuid index.
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::is_allowed);
+			const storage::slot<R>* s = m_store.find(uuid);
+			const bool allowed = s && permits(*s, required);
+			m_metrics.count(allowed ? metrics::counter::is_allowed_hit : metrics::counter::is_allowed_miss);
+			record_audit(audit::op::is_allowed, s ? handle_type{s->subject} : handle_type{}, uuid, allowed);
+			return allowed;
+		}
+		/**
+		 * Checks a batch of (subject, uuid) pairs, the lookups are prefetched so the cache misses overlap
+		 * \param checks the pairs of the subject handle and the uuid of the resource
+		 * \param count the number of the pairs
+		 * \param results receives `count` results, true if allowed, false vice versa
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `void`
+		 */
+		void is_allowed_batch(const std::pair<handle_type, size_t>* checks, const size_t count, bool* results,
+				enums::rights required = enums::rights::none) noexcept {
+			for_each_prefetched(checks, count, [this, checks, results, required](size_t i, handle_type h, const storage::slot<R>* s) {
+				results[i] = s && applies(h, *s) && permits(*s, required);
+				m_metrics.count(results[i] ? metrics::counter::is_allowed_hit : metrics::counter::is_allowed_miss);
+				record_audit(audit::op::is_allowed, h, checks[i].second, results[i]);
+			});
+		}
+		/**
+		 * Checks a batch of (subject, uuid) pairs
+		 * \param checks the pairs of the subject handle and the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `std::vector<bool>` the results in the order of the checks
+		 */
+		std::vector<bool> is_allowed_batch(const std::vector<std::pair<handle_type, size_t>>& checks,
+				enums::rights required = enums::rights::none) {
+			std::vector<bool> results(checks.size());
+			for_each_prefetched(checks.data(), checks.size(), [this, &checks, &results, required](size_t i, handle_type h, const storage::slot<R>* s) {
+				results[i] = s && applies(h, *s) && permits(*s, required);
+				m_metrics.count(results[i] ? metrics::counter::is_allowed_hit : metrics::counter::is_allowed_miss);
+				record_audit(audit::op::is_allowed, h, checks[i].second, results[i]);
+			});
+			return results;
+		}
+		/**
+		 * Checks a batch of (subject id, uuid) pairs, the subject is resolved once per run of equal ids
+		 * \param checks the pairs of the subject id and the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `std::vector<bool>` the results in the order of the checks
+		 */
+		std::vector<bool> is_allowed_batch(const std::vector<std::pair<view_type, size_t>>& checks,
+				enums::rights required = enums::rights::none) {
+			return is_allowed_batch(resolve(checks), required);
+		}
+		/**
+		 * Checks whether the resources of a batch of (subject, uuid) pairs exist
+		 * \param checks the pairs of the subject handle and the uuid of the resource
+		 * \param count the number of the pairs
+		 * \param results receives `count` results, true if exists, false vice versa
+		 * @returns `void`
+		 */
+		void has_resource_batch(const std::pair<handle_type, size_t>* checks, const size_t count, bool* results) noexcept {
+			for_each_prefetched(checks, count, [this, results](size_t i, handle_type h, const storage::slot<R>* s) {
+				results[i] = s && s->subject == h.value;
+				m_metrics.count(results[i] ? metrics::counter::has_resource_hit : metrics::counter::has_resource_miss);
+			});
+		}
+		/**
+		 * Checks whether the resources of a batch of (subject, uuid) pairs exist
+		 * \param checks the pairs of the subject handle and the uuid of the resource
+		 * @returns `std::vector<bool>` the results in the order of the checks
+		 */
+		std::vector<bool> has_resource_batch(const std::vector<std::pair<handle_type, size_t>>& checks) {
+			std::vector<bool> results(checks.size());
+			for_each_prefetched(checks.data(), checks.size(), [this, &results](size_t i, handle_type h, const storage::slot<R>* s) {
+				results[i] = s && s->subject == h.value;
+				m_metrics.count(results[i] ? metrics::counter::has_resource_hit : metrics::counter::has_resource_miss);
+			});
+			return results;
+		}
+		/**
+		 * Checks whether the resources of a batch of (subject id, uuid) pairs exist
+		 * \param checks the pairs of the subject id and the uuid of the resource
+		 * @returns `std::vector<bool>` the results in the order of the checks
+		 */
+		std::vector<bool> has_resource_batch(const std::vector<std::pair<view_type, size_t>>& checks) {
+			return has_resource_batch(resolve(checks));
+		}
+		/**
+		 * Makes the subject a member of the role, the grants of the role and of the roles it belongs to
+		 * apply to the member as well, the nested roles are allowed.
+		 * \param role the role, i.e. a subject whose grants are shared
+		 * \param member the subject
+		 * @returns `bool` false if the membership already exists
+		 */
+		bool add_member(const subjects::subject<S>& role, const subjects::subject<S>& member) {
+			return add_member(intern(role), intern(member));
+		}
+		/**
+		 * Makes the interned subject a member of the interned role, throws if it would make a cycle of roles
+		 * \param role the handle of the role
+		 * \param member the handle of the subject
+		 * @returns `bool` false if the membership already exists
+		 */
+		bool add_member(const handle_type role, const handle_type member) {
+			// Updates the precomputed memberships in O(m) where m is the number of the subjects below the member.
+			if(role.value >= m_subjects.size() || member.value >= m_subjects.size()) {
+				libs::exception::raise("Error: Invalid subject handle");
+			}
+			if(!m_roles.add_member(role.value, member.value)) {
 				return false;
 			}
-			auto itt = it->second.find(uuid);
-			if(itt == it->second.end()) {
+			mark_present(role);
+			mark_present(member);
+			log_membership(journal::op::add_member, role, member);
+			return true;
+		}
+		/**
+		 * Removes the membership of the subject in the role
+		 * \param role the role
+		 * \param member the subject
+		 * @returns `bool` false if the membership does not exist
+		 */
+		bool remove_member(const subjects::subject<S>& role, const subjects::subject<S>& member) {
+			return remove_member(find_handle(role), find_handle(member));
+		}
+		/**
+		 * Removes the membership of the interned subject in the interned role
+		 * \param role the handle of the role
+		 * \param member the handle of the subject
+		 * @returns `bool` false if the membership does not exist
+		 */
+		bool remove_member(const handle_type role, const handle_type member) {
+			// Updates the precomputed memberships in O(m) where m is the number of the subjects below the member.
+			if(!m_roles.remove_member(role.value, member.value)) {
 				return false;
 			}
-			return itt->second.second.get_access_level() == "allowed" ? true : false;
+			log_membership(journal::op::remove_member, role, member);
+			return true;
+		}
+		/**
+		 * Checks whether the subject belongs to the role, directly or through the nested roles
+		 * \param member the subject
+		 * \param role the role
+		 * @returns `bool`
+		 */
+		bool is_member(const subjects::subject<S>& member, const subjects::subject<S>& role) const noexcept {
+			return is_member(find_handle(member), find_handle(role));
+		}
+		/**
+		 * Checks whether the interned subject belongs to the interned role
+		 * \param member the handle of the subject
+		 * \param role the handle of the role
+		 * @returns `bool`
+		 */
+		bool is_member(const handle_type member, const handle_type role) const noexcept {
+			// Checks the membership in O(1).
+			return m_roles.is_member(member.value, role.value);
+		}
+		/**
+		 * Grants the rights to the subject under the path prefix, e.g. `/data/tenant42` covers all the paths below it.
+		 * The path rules are kept in memory only, they are neither journaled nor saved.
+		 * \param sub the subject or a role
+		 * \param path the path prefix, `/` covers everything
+		 * \param r the rights to grant, by default all of them
+		 * @returns `void`
+		 */
+		void allow_path(const subjects::subject<S>& sub, std::string_view path, enums::rights r = enums::rights::all) {
+			allow_path(intern(sub), path, r);
+		}
+		/**
+		 * Grants the rights to the interned subject under the path prefix
+		 * \param h the handle of the subject
+		 * \param path the path prefix, `/` covers everything
+		 * \param r the rights to grant, by default all of them
+		 * @returns `void`
+		 */
+		void allow_path(const handle_type h, std::string_view path, enums::rights r = enums::rights::all) {
+			if(h.value >= m_subjects.size()) {
+				libs::exception::raise("Error: Invalid subject handle");
+			}
+			mark_present(h);
+			m_paths.add(path, h.value, r, false);
+		}
+		/**
+		 * Denies the rights to the subject under the path prefix, the denial overrides the grants of the same prefix
+		 * \param sub the subject or a role
+		 * \param path the path prefix, `/` covers everything
+		 * \param r the rights to deny, by default all of them
+		 * @returns `void`
+		 */
+		void deny_path(const subjects::subject<S>& sub, std::string_view path, enums::rights r = enums::rights::all) {
+			deny_path(intern(sub), path, r);
+		}
+		/**
+		 * Denies the rights to the interned subject under the path prefix
+		 * \param h the handle of the subject
+		 * \param path the path prefix, `/` covers everything
+		 * \param r the rights to deny, by default all of them
+		 * @returns `void`
+		 */
+		void deny_path(const handle_type h, std::string_view path, enums::rights r = enums::rights::all) {
+			if(h.value >= m_subjects.size()) {
+				libs::exception::raise("Error: Invalid subject handle");
+			}
+			mark_present(h);
+			m_paths.add(path, h.value, r, true);
+		}
+		/**
+		 * Removes the grants and the denials of the subject under the path prefix
+		 * \param sub the subject
+		 * \param path the path prefix
+		 * @returns `bool` false if the subject has no rules under the path
+		 */
+		bool remove_path(const subjects::subject<S>& sub, std::string_view path) {
+			return remove_path(find_handle(sub), path);
+		}
+		/**
+		 * Removes the grants and the denials of the interned subject under the path prefix
+		 * \param h the handle of the subject
+		 * \param path the path prefix
+		 * @returns `bool` false if the subject has no rules under the path
+		 */
+		bool remove_path(const handle_type h, std::string_view path) {
+			return h.is_valid() && m_paths.remove(path, h.value);
+		}
+		/**
+		 * Compiles the path rules into the trie, otherwise the first check after a change does it
+		 * @returns `void`
+		 */
+		void compile_paths() {
+			if(m_paths.dirty()) {
+				m_paths.compile();
+			}
+		}
+		/**
+		 * Checks whether or not the path is allowed within the specified subject or one of its roles.
+		 * The deepest path prefix with the rules of the subject or its roles decides, the denials override the grants.
+		 * \param sub the subject
+		 * \param path the checked path
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed_path(const subjects::subject<S>& sub, std::string_view path, enums::rights required = enums::rights::none) {
+			return is_allowed_path(find_handle(sub), path, required);
+		}
+		/**
+		 * Checks whether or not the path is allowed within the interned subject or one of its roles
+		 * \param h the handle of the subject
+		 * \param path the checked path
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed_path(const handle_type h, std::string_view path, enums::rights required = enums::rights::none) {
+			// Chacks the path in O(d log c) where d is the depth of the path and c the number of children per node.
+			compile_paths();
+			if(!h.is_valid()) {
+				return false;
+			}
+			enums::rights effective = enums::rights::none;
+			const bool found = m_paths.resolve(path, [this, h](std::uint32_t subject) {
+				return subject == h.value || m_roles.is_member(h.value, subject);
+			}, effective);
+			return found && enums::access_level(effective).permits(required);
 		}
 		/**
 		 * Removes the subject
 		 * \param sub the subject
 		 * @returns `void`
 		 */
-		void remove(subjects::subject<S>& sub) {
-			// removes the subject in O(1) - averrage.
-			auto it = m_map.find(sub);
-			if(it != m_map.end()) {
-				m_map.erase(it);
+		void remove(const subjects::subject<S>& sub) {
+			remove(find_handle(sub));
+		}
+		/**
+		 * Removes the interned subject, the handle stays valid
+		 * \param h the handle of the subject
+		 * @returns `void`
+		 */
+		void remove(const handle_type h) {
+			// removes the subject in O(n) where n is the number of its resources.
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::remove);
+			storage::subject_slots* owner = find_subject(h);
+			record_audit(audit::op::remove_subject, h, 0, owner != nullptr);
+			if(owner) {
+				m_metrics.count(metrics::counter::remove_subject);
+				m_store.release_all(*owner);
+				m_roles.remove_subject(h.value);
+				m_paths.remove_subject(h.value);
+				owner->present = false;
+				--m_size;
+				log(journal::op::remove_subject, [this, h](std::string& out) {
+					put_subject(out, h);
+				});
 			}
 		}
 		/**
@@ -130,14 +1135,40 @@ class acl {
 		 * \param uuid of the resource
 		 * @returns `void`
 		 */
-		void remove(subjects::subject<S>& sub, const size_t uuid) {
-			// removes the resource from the subject in O(1) - averrage.
-			auto it = m_map.find(sub);
-			if(it != m_map.end()) {
-				auto itt = it->second.find(uuid);
-				if(itt != it->second.end()) {
-					it->second.erase(itt);
-				}
+		void remove(const subjects::subject<S>& sub, const size_t uuid) {
+			remove(find_handle(sub), uuid);
+		}
+		/**
+		 * Removes the specified resource from the interned subject
+		 * \param h the handle of the subject
+		 * \param uuid of the resource
+		 * @returns `void`
+		 */
+		void remove(const handle_type h, const size_t uuid) {
+			// removes the resource from the subject in O(1).
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::remove);
+			storage::slot<R>* s = find_slot(h, uuid);
+			record_audit(audit::op::remove_grant, h, uuid, s != nullptr);
+			if(s) {
+				m_metrics.count(metrics::counter::remove_grant);
+				m_store.release(*s, m_subjects[s->subject]);
+				log_grant(journal::op::remove_grant, uuid, enums::rights::none);
+			}
+		}
+		/**
+		 * Removes the resource from its owning subject
+		 * \param uuid of the resource
+		 * @returns `void`
+		 */
+		void remove(const size_t uuid) {
+			// removes the resource in O(1) through the uuid index.
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::remove);
+			storage::slot<R>* s = m_store.find(uuid);
+			record_audit(audit::op::remove_grant, s ? handle_type{s->subject} : handle_type{}, uuid, s != nullptr);
+			if(s) {
+				m_metrics.count(metrics::counter::remove_grant);
+				m_store.release(*s, m_subjects[s->subject]);
+				log_grant(journal::op::remove_grant, uuid, enums::rights::none);
 			}
 		}
 		/**
@@ -145,9 +1176,20 @@ class acl {
 		 * \param sub the subject
 		 * @returns `bool`
 		 */
-		bool has_subject(subjects::subject<S>& sub) {
+		bool has_subject(const subjects::subject<S>& sub) noexcept {
 			// Checks whether the subject exists in O(1) - averrage.
-			return m_map.find(sub) != m_map.end();
+			return has_subject(find_handle(sub));
+		}
+		/**
+		 * Checks whether the interned subject exists.
+		 * \param h the handle of the subject
+		 * @returns `bool`
+		 */
+		bool has_subject(const handle_type h) noexcept {
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::has_subject);
+			const bool found = find_subject(h) != nullptr;
+			m_metrics.count(found ? metrics::counter::has_subject_hit : metrics::counter::has_subject_miss);
+			return found;
 		}
 		/**
 		 * Checks whether the specified resource exists within the specified subject.
@@ -155,65 +1197,692 @@ class acl {
 		 * \param uuid the uuid of the resource
 		 * @returns `bool`
 		 */
-		bool has_resource(subjects::subject<S>& sub, const size_t uuid) {
+		bool has_resource(const subjects::subject<S>& sub, const size_t uuid) noexcept {
 			// Checks whether the resource exists within the specified subject in O(1) - averrage.
-			auto it = m_map.find(sub);
-			if(it != m_map.end()) {
-				auto itt = it->second.find(uuid);
-				if(itt != it->second.end()) {
-					return true;
-				}
-			}
-			return false;
+			return has_resource(find_handle(sub), uuid);
+		}
+		/**
+		 * Checks whether the specified resource exists within the interned subject.
+		 * \param h the handle of the subject
+		 * \param uuid the uuid of the resource
+		 * @returns `bool`
+		 */
+		bool has_resource(const handle_type h, const size_t uuid) noexcept {
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::has_resource);
+			const bool found = find_slot(h, uuid) != nullptr;
+			m_metrics.count(found ? metrics::counter::has_resource_hit : metrics::counter::has_resource_miss);
+			return found;
 		}
 		/**
-		 * Tryies to pop the resource from the specified subject.
+		 * Tryies to pop the resource from the specified subject, the grant is removed along with it.
 		 * \param sub the subject
 		 * \param res the resource
 		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
 		 * \tparam R is the type of the raw resource
 		 */
-		std::unique_ptr<resources::resource<R>> try_pop(subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res) {
+		std::unique_ptr<resources::resource<R>> try_pop(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res) {
+			return try_pop(sub, *res);
+		}
+		/**
+		 * Tryies to pop the resource from the specified subject, the grant is removed along with it.
+		 * The passed resource serves as a key only, it is neither consumed nor modified.
+		 * \param sub the subject
+		 * \param res the resource
+		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
+		 */
+		std::unique_ptr<resources::resource<R>> try_pop(const subjects::subject<S>& sub, const resources::resource<R>& res) {
 			// Tryies to pop out the specified resource form the specified subject in O(1) - averrage.
-			auto it = m_map.find(sub);
-			size_t uuid = res.get()->get_uuid();
-			if(it != m_map.end()) {
-				auto itt = it->second.find(uuid);
-				if(itt != it->second.end()) {
-					std::unique_ptr<resources::resource<R>> uptr = std::move(itt->second.first);
-					subjects::subject<S> key = itt->first;
-					m_map.erase(key);
-					return std::move(uptr);
-				}
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::try_pop);
+			if(storage::slot<R>* s = find_slot(find_handle(sub), res.get_uuid())) {
+				resources::payload<R> data = m_store.release(*s, m_subjects[s->subject]);
+				std::unique_ptr<resources::resource<R>> popped = data ?
+					std::make_unique<resources::resource<R>>(std::move(data), res.get_uuid()) : nullptr;
+				log_grant(journal::op::remove_grant, res.get_uuid(), enums::rights::none);
+				m_metrics.count(popped ? metrics::counter::pop_hit : metrics::counter::pop_miss);
+				return popped;
 			}
+			m_metrics.count(metrics::counter::pop_miss);
 			return nullptr;
 		}
 		/**
-		 * Tryies to pop the resource from the specified subject.
+		 * Tryies to pop the resource from the specified subject, the grant itself stays in place.
 		 * \param sub the subject
 		 * \param uuid the uuid of the specified resource
 		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
 		 * \tparam R is the type of the raw resource
 		 */
-		std::unique_ptr<resources::resource<R>> try_pop(subjects::subject<S>& sub, size_t uuid) {
-			// Tryies to pop out the specified resource by its uuid form the specified subject in O(1) - averrage.
-			auto it = m_map.find(sub);
-			if(it != m_map.end()) {
-				auto itt = it->second.find(uuid);
-				if(itt != it->second.end()) {
-					std::unique_ptr<resources::resource<R>> uptr = std::move(itt->second.first);
-					const size_t key = itt->first;
-					return std::move(uptr);
-				}
+		std::unique_ptr<resources::resource<R>> try_pop(const subjects::subject<S>& sub, size_t uuid) {
+			return try_pop(find_handle(sub), uuid);
+		}
+		/**
+		 * Tryies to pop the resource from the interned subject, the grant itself stays in place.
+		 * \param h the handle of the subject
+		 * \param uuid the uuid of the specified resource
+		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
+		 */
+		std::unique_ptr<resources::resource<R>> try_pop(const handle_type h, size_t uuid) {
+			// Tryies to pop out the specified resource by its uuid form the specified subject in O(1).
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::try_pop);
+			storage::slot<R>* s = find_slot(h, uuid);
+			if(s && s->resource) {
+				log_grant(journal::op::pop, uuid, enums::rights::none);
+				m_metrics.count(metrics::counter::pop_hit);
+				return std::make_unique<resources::resource<R>>(std::move(s->resource), uuid);
+			}
+			m_metrics.count(metrics::counter::pop_miss);
+			return nullptr;
+		}
+		/**
+		 * Tryies to pop the resource from its owning subject, the grant itself stays in place.
+		 * \param uuid the uuid of the specified resource
+		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
+		 */
+		std::unique_ptr<resources::resource<R>> try_pop(const size_t uuid) {
+			// Tryies to pop out the specified resource in O(1) through the uuid index.
+			metrics::scoped_timer<> timer(m_metrics, metrics::op::try_pop);
+			storage::slot<R>* s = m_store.find(uuid);
+			if(s && s->resource) {
+				log_grant(journal::op::pop, uuid, enums::rights::none);
+				m_metrics.count(metrics::counter::pop_hit);
+				return std::make_unique<resources::resource<R>>(std::move(s->resource), uuid);
 			}
+			m_metrics.count(metrics::counter::pop_miss);
 			return nullptr;
 		}
+		/**
+		 * Adds the resource to the specified subject without raising
+		 * \param sub the subject
+		 * \param res the resource
+		 * \param access the access level for the resource, by default it is set to be `forbiden`
+		 * @returns `status::result<size_t>` the uuid of the added resource or the error
+		 */
+		status::result<size_t> try_add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access = enums::access_level()) noexcept {
+			const S* id = sub.try_get_id();
+			if(!id) {
+				return status::code::invalid_subject;
+			}
+			// Checked ahead of interning, so a failed call leaves no new subject behind.
+			if(!res) {
+				return status::code::invalid_resource;
+			}
+			handle_type h;
+			const status::code c = guarded([&] {
+				h = intern_id(*id);
+			});
+			if(c != status::code::ok) {
+				return c;
+			}
+			return try_add(h, std::move(res), access);
+		}
+		/**
+		 * Adds the resource to the specified subject without raising, parses the string access level specifier
+		 * \param sub the subject
+		 * \param res the resource
+		 * \param access the access level specifier, e.g. `allowed`, `forbiden` or `read|write`
+		 * @returns `status::result<size_t>` the uuid of the added resource or the error
+		 */
+		status::result<size_t> try_add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				std::string_view access) noexcept {
+			const status::result<enums::access_level> parsed = enums::access_level::parse(access);
+			if(!parsed) {
+				return parsed.error();
+			}
+			return try_add(sub, std::move(res), parsed.value());
+		}
+		/**
+		 * Adds the resource to the interned subject without raising
+		 * \param h the handle of the subject
+		 * \param res the resource
+		 * \param access the access level for the resource, by default it is set to be `forbiden`
+		 * @returns `status::result<size_t>` the uuid of the added resource or the error
+		 */
+		status::result<size_t> try_add(const handle_type h, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access = enums::access_level()) noexcept {
+			if(h.value >= m_subjects.size()) {
+				return status::code::unknown_subject;
+			}
+			if(!res) {
+				return status::code::invalid_resource;
+			}
+			size_t uuid = 0;
+			const status::code c = guarded([&] {
+				uuid = add(h, std::move(res), access);
+			});
+			if(c != status::code::ok) {
+				return c;
+			}
+			return uuid;
+		}
+		/**
+		 * Allows an access to the specified resource within the specified subject without raising
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant, by default all of them
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code try_allow_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) noexcept {
+			return try_allow_access(find_handle(sub), uuid, r);
+		}
+		/**
+		 * Allows an access to the specified resource within the interned subject without raising
+		 * \param h the handle of the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant, by default all of them
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code try_allow_access(const handle_type h, const size_t uuid, enums::rights r = enums::rights::all) noexcept {
+			const status::code c = check(h, uuid);
+			if(c != status::code::ok) {
+				record_audit(audit::op::allow, h, uuid, false);
+				return c;
+			}
+			return guarded([&] {
+				allow_access(h, uuid, r);
+			});
+		}
+		/**
+		 * Forbids the access to the specified resource within the specified subject without raising
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to revoke, by default all of them
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code try_forbid_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) noexcept {
+			return try_forbid_access(find_handle(sub), uuid, r);
+		}
+		/**
+		 * Forbids the access to the specified resource within the interned subject without raising
+		 * \param h the handle of the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to revoke, by default all of them
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code try_forbid_access(const handle_type h, const size_t uuid, enums::rights r = enums::rights::all) noexcept {
+			const status::code c = check(h, uuid);
+			if(c != status::code::ok) {
+				record_audit(audit::op::forbid, h, uuid, false);
+				return c;
+			}
+			return guarded([&] {
+				forbid_access(h, uuid, r);
+			});
+		}
+		/**
+		 * Removes the subject without raising
+		 * \param sub the subject
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code try_remove(const subjects::subject<S>& sub) noexcept {
+			const handle_type h = find_handle(sub);
+			if(!find_subject(h)) {
+				record_audit(audit::op::remove_subject, h, 0, false);
+				return status::code::unknown_subject;
+			}
+			return guarded([&] {
+				remove(h);
+			});
+		}
+		/**
+		 * Removes the specified resource from the subject without raising
+		 * \param sub the subject
+		 * \param uuid of the resource
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code try_remove(const subjects::subject<S>& sub, const size_t uuid) noexcept {
+			const handle_type h = find_handle(sub);
+			const status::code c = check(h, uuid);
+			if(c != status::code::ok) {
+				record_audit(audit::op::remove_grant, h, uuid, false);
+				return c;
+			}
+			return guarded([&] {
+				remove(h, uuid);
+			});
+		}
+		/**
+		 * Makes the subject a member of the role without raising
+		 * \param role the role, i.e. a subject whose grants are shared
+		 * \param member the subject
+		 * @returns `status::result<bool>` false if the membership already exists, or the error
+		 */
+		status::result<bool> try_add_member(const subjects::subject<S>& role, const subjects::subject<S>& member) noexcept {
+			const S* role_id = role.try_get_id();
+			const S* member_id = member.try_get_id();
+			if(!role_id || !member_id) {
+				return status::code::invalid_subject;
+			}
+			bool added = false;
+			bool cycle = false;
+			const status::code c = guarded([&] {
+				const handle_type r = intern_id(*role_id);
+				const handle_type m = intern_id(*member_id);
+				cycle = r == m || m_roles.is_member(r.value, m.value);
+				if(!cycle) {
+					added = add_member(r, m);
+				}
+			});
+			if(c != status::code::ok) {
+				return c;
+			}
+			if(cycle) {
+				return status::code::role_cycle;
+			}
+			return added;
+		}
+		/**
+		 * Gets the id of the interned subject without raising
+		 * \param h the handle of the subject
+		 * @returns `const S*` the id or nullptr if the handle is not of this acl
+		 */
+		const S* try_get_id(const handle_type h) const noexcept {
+			return h.value < m_table.size() ? &m_table.get_id(h) : nullptr;
+		}
+		/**
+		 * Attaches the journal, from now on every mutation appends its record to it.
+		 * The records are only buffered, the caller makes them durable with `journal::writer::commit`,
+		 * preferably after releasing its own lock so the concurrent mutators share a single sync.
+		 * \param j the journal, nullptr detaches the attached one, it must outlive the attachment
+		 * @returns `void`
+		 */
+		void attach_journal(journal::writer* j) noexcept {
+			static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+			m_journal = j;
+		}
+		/**
+		 * Attaches the shared memory segment, the current state is published into it whole and from now on every
+		 * mutation is applied to it as well, so the other processes query the acl through `shared::reader`.
+		 * \param w the writer of the segment, nullptr detaches the attached one, it must outlive the attachment
+		 * @returns `void`
+		 */
+		void attach_shared(shared::writer* w) {
+			static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+			m_shared = w;
+			if(m_shared) {
+				publish_shared();
+			}
+		}
+		/**
+		 * Attaches the audit log, from now on every check and every change of the access records its decision into it.
+		 * The records are only pushed into the ring of the calling thread, the drainer of the log writes them out.
+		 * \param a the audit log, nullptr detaches the attached one, it must outlive the attachment
+		 * @returns `void`
+		 */
+		void attach_audit(audit::writer* a) noexcept {
+			m_audit = a;
+		}
+		/**
+		 * Gets the sequence number of the last record appended by the acl, the one to commit
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t journal_lsn() const noexcept {
+			return m_lsn;
+		}
+		/**
+		 * Replays the journal on top of the current state, e.g. the last loaded snapshot.
+		 * The replay is idempotent, the records already reflected in the state leave it as is,
+		 * so the journal could be truncated at any point after the snapshot has been saved.
+		 * The replayed mutations are not journaled again, the attached shared segment is published anew once replayed.
+		 * \param path the path of the journal
+		 * @returns `size_t` the number of the replayed records, the torn tail is ignored
+		 */
+		size_t replay(const std::string& path) {
+			static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+			journal::reader reader(path);
+			// Detaches the journal, the shared segment and the audit log for the replay, they are attached back even if
+			// the replay fails. The replayed mutations are not the decisions to audit.
+			struct detach {
+				journal::writer*& journal;
+				journal::writer* attached;
+				shared::writer*& segment;
+				shared::writer* shared;
+				audit::writer*& log;
+				audit::writer* audited;
+				~detach() {
+					journal = attached;
+					segment = shared;
+					log = audited;
+				}
+			} guard{m_journal, m_journal, m_shared, m_shared, m_audit, m_audit};
+			m_journal = nullptr;
+			m_shared = nullptr;
+			m_audit = nullptr;
+			size_t count = 0;
+			journal::op o;
+			std::string_view data;
+			while(reader.next(o, data)) {
+				apply(o, journal::payload(data));
+				++count;
+			}
+			m_shared = guard.shared;
+			if(m_shared) {
+				publish_shared();
+			}
+			return count;
+		}
+		/**
+		 * Reclaims the expired grants: the expired resources are removed, the lapsed rights are forbidden.
+		 * The work is bounded, call it periodically, e.g. while holding the writer lock for a short time.
+		 * \param now the current time
+		 * \param budget the maximum number of the timers to process in this call
+		 * @returns `size_t` the number of the reclaimed expiries
+		 */
+		size_t reclaim_expired(const clock::time_point now = clock::now(), const size_t budget = 4096) {
+			// Reclaims the expiries in O(1) - amortized per expiry.
+			if(!m_expiries) {
+				return 0;
+			}
+			size_t reclaimed = 0;
+			m_expiries->advance(to_ns(now), budget, [this, &reclaimed](const timers::timer& t) {
+				storage::slot<R>* s = m_store.find(t.key);
+				// The timer is stale if the grant has gone or its expiry has been moved since.
+				if(!s || s->generation != t.generation || s->expires != t.deadline) {
+					return;
+				}
+				if(s->expires_grant) {
+					remove(t.key);
+				} else {
+					const enums::rights lapsed = s->expiring;
+					set_expiry(*s, 0, enums::rights::none, false);
+					forbid_access(handle_type{s->subject}, t.key, lapsed);
+				}
+				++reclaimed;
+			});
+			return reclaimed;
+		}
+		/**
+		 * Gets the number of the scheduled expiries, including the superseded ones not reclaimed yet
+		 * @returns `size_t`
+		 */
+		size_t pending_expiries() const noexcept {
+			return m_expiries ? m_expiries->size() : 0;
+		}
+		/**
+		 * Saves the acl into a versioned and checksummed snapshot file.
+		 * The resources are saved only if `R` has a serializer, see `serialization::serializer`.
+		 * \param path the path of the file, it is replaced as a whole once the new one is durable
+		 * @returns `void`
+		 */
+		void save(const std::string& path) const {
+			static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+			snapshot::writer w;
+			std::vector<std::uint32_t> positions(m_subjects.size(), storage::npos);
+			for(std::uint32_t h = 0; h < m_subjects.size(); ++h) {
+				if(m_subjects[h].present) {
+					std::string key;
+					serialization::serializer<S>::write(key, m_table.get_id(handle_type{h}));
+					positions[h] = w.add_subject(std::move(key));
+				}
+			}
+			std::string bytes;
+			m_store.for_each([&](const storage::slot<R>& s) {
+				const std::string* res = nullptr;
+				if constexpr(serialization::is_serializable<R>) {
+					if(s.resource) {
+						bytes.clear();
+						serialization::serializer<R>::write(bytes, *s.resource.get());
+						res = &bytes;
+					}
+				}
+				w.add_entry(s.uuid, positions[s.subject], s.access.get_rights(), res);
+				if(s.expires != 0) {
+					w.add_expiry(s.uuid, s.expires, s.expiring, s.expires_grant);
+				}
+			});
+			m_roles.for_each_membership([&](std::uint32_t role, std::uint32_t member) {
+				w.add_membership(positions[role], positions[member]);
+			});
+			w.set_next_uuid(m_uuid);
+			w.write(path);
+		}
+		/**
+		 * Bulk-loads a snapshot file into the empty acl, the uuids are preserved.
+		 * The grants saved without a resource are loaded without one, like the popped ones.
+		 * \param path the path of the file
+		 * @returns `void`
+		 */
+		void load(const std::string& path) {
+			static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+			if(m_size != 0 || m_store.size() != 0 || m_roles.size() != 0) {
+				libs::exception::raise("Error: A snapshot could be loaded into an empty acl only");
+			}
+			snapshot::view<S> v(path);
+			std::vector<handle_type> handles(v.subject_count());
+			for(std::uint32_t i = 0; i < handles.size(); ++i) {
+				S id{};
+				if(!serialization::serializer<S>::read(v.subject_key(i), id)) {
+					libs::exception::raise("Error: Invalid snapshot: malformed subject");
+				}
+				handles[i] = intern_id(id);
+				m_subjects[handles[i].value].present = true;
+				++m_size;
+			}
+			m_store.reserve(v.entry_count());
+			for(size_t i = 0; i < v.entry_count(); ++i) {
+				const snapshot::entry_record& e = v.entries()[i];
+				const handle_type h = handles[e.subject];
+				storage::slot<R>& s = m_store.acquire(e.uuid, m_subjects[h.value], h.value);
+				s.access = enums::access_level(static_cast<enums::rights>(e.rights));
+				if constexpr(serialization::is_serializable<R>) {
+					if(e.resource_offset != snapshot::no_resource) {
+						R value{};
+						if(!serialization::serializer<R>::read(v.resource_bytes(e), value)) {
+							libs::exception::raise("Error: Invalid snapshot: malformed resource");
+						}
+						s.resource.emplace(std::move(value));
+					}
+				}
+			}
+			for(size_t i = 0; i < v.membership_count(); ++i) {
+				const snapshot::membership_record& m = v.memberships()[i];
+				m_roles.add_member(handles[m.role].value, handles[m.member].value);
+			}
+			for(size_t i = 0; i < v.expiry_count(); ++i) {
+				const snapshot::expiry_record& x = v.expiries()[i];
+				if(storage::slot<R>* s = m_store.find(x.uuid)) {
+					schedule_expiry(*s, x.expires, static_cast<enums::rights>(x.expiring), x.grant != 0);
+				}
+			}
+			m_uuid = v.next_uuid();
+			if(m_shared) {
+				publish_shared();
+			}
+		}
+		/**
+		 * Freezes the policy into an immutable acl which is shared across threads without any synchronization.
+		 * The grants, the role memberships and the expiries are frozen, the resources and the path grants are not.
+		 * \param mr the memory resource of the frozen acl, by default the one of this acl
+		 * @returns `frozen::frozen_acl<S>`
+		 */
+		frozen::frozen_acl<S> freeze(std::pmr::memory_resource* mr = nullptr) const {
+			typename frozen::frozen_acl<S>::builder b;
+			std::vector<std::uint32_t> positions(m_subjects.size(), storage::npos);
+			for(std::uint32_t h = 0; h < m_subjects.size(); ++h) {
+				if(m_subjects[h].present) {
+					positions[h] = b.add_subject(m_table.get_id(handle_type{h}));
+				}
+			}
+			m_store.for_each([&](const storage::slot<R>& s) {
+				b.add_entry(s.uuid, positions[s.subject], s.access.get_rights());
+				if(s.expires != 0) {
+					b.add_expiry(s.uuid, s.expires, s.expiring, s.expires_grant);
+				}
+			});
+			m_roles.for_each_membership([&](std::uint32_t role, std::uint32_t member) {
+				b.add_membership(positions[role], positions[member]);
+			});
+			return b.build(mr ? mr : get_memory_resource());
+		}
+		/**
+		 * Scrapes the metrics, the counters and the latencies are collected only with `ACL_ENABLE_METRICS`.
+		 * The counters could be scraped concurrently with the operations, the table sizes could not.
+		 * @returns `metrics::snapshot`
+		 */
+		metrics::snapshot get_metrics() const noexcept {
+			metrics::snapshot out;
+			m_metrics.read(out);
+			out.tables.subjects = m_size;
+			out.tables.interned_subjects = m_table.size();
+			out.tables.subject_buckets = m_table.bucket_count();
+			out.tables.subject_load_factor = m_table.load_factor();
+			out.tables.grants = m_store.size();
+			out.tables.slot_capacity = m_store.capacity();
+			out.tables.index_size = m_store.index_size();
+			return out;
+		}
+		/**
+		 * Calls the function for every grant of the interned subject, the latest added first.
+		 * The grants the subject gets through its roles are not visited, see `subjects_allowed`.
+		 * \param h the handle of the subject
+		 * \param f the function taking `const grant_view&`
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each_resource(const handle_type h, F f) const {
+			// Visits the grants in O(n) where n is the number of the grants of the subject.
+			if(h.value >= m_subjects.size() || !m_subjects[h.value].present) {
+				return;
+			}
+			const std::int64_t now = to_ns(clock::now());
+			m_store.for_each_owned(m_subjects[h.value], [&f, now](const storage::slot<R>& s) {
+				f(view_of(s, now));
+			});
+		}
+		/**
+		 * Calls the function for every grant of the subject, the latest added first
+		 * \param sub the subject
+		 * \param f the function taking `const grant_view&`
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each_resource(const subjects::subject<S>& sub, F f) const {
+			for_each_resource(find_handle(sub), f);
+		}
+		/**
+		 * Lists the uuids of the resources granted to the subject, the latest added first
+		 * \param sub the subject
+		 * @returns `std::vector<size_t>` empty if the subject does not exist
+		 */
+		std::vector<size_t> resources_of(const subjects::subject<S>& sub) const {
+			const handle_type h = find_handle(sub);
+			std::vector<size_t> uuids;
+			if(h.value < m_subjects.size()) {
+				uuids.reserve(m_subjects[h.value].count);
+			}
+			for_each_resource(h, [&uuids](const grant_view& g) {
+				uuids.push_back(g.uuid);
+			});
+			return uuids;
+		}
+		/**
+		 * Lists the subjects allowed to access the resource, i.e. its owner and the members of the owner role
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * \param threads the number of the threads scanning the subjects, the memberships are checked in parallel
+		 * @returns `std::vector<handle_type>` the handles in the ascending order
+		 */
+		std::vector<handle_type> subjects_allowed(const size_t uuid, enums::rights required = enums::rights::none,
+				const unsigned threads = 1) const {
+			// Scans the subjects in O(n) where n is the number of the subjects.
+			std::vector<handle_type> out;
+			const storage::slot<R>* s = m_store.find(uuid);
+			if(!s || !permits(*s, required)) {
+				return out;
+			}
+			if(m_roles.size() == 0) {
+				out.push_back(handle_type{s->subject});
+				return out;
+			}
+			const size_t n = m_subjects.size();
+			const unsigned parts = parts_of(n, threads);
+			std::vector<std::vector<handle_type>> found(parts);
+			parallel_for(n, parts, [&](const size_t from, const size_t to, const unsigned part) {
+				for(size_t h = from; h < to; ++h) {
+					const handle_type candidate{static_cast<std::uint32_t>(h)};
+					if(m_subjects[h].present && applies(candidate, *s)) {
+						found[part].push_back(candidate);
+					}
+				}
+			});
+			for(const std::vector<handle_type>& part : found) {
+				out.insert(out.end(), part.begin(), part.end());
+			}
+			return out;
+		}
+		/**
+		 * Calls the function for every grant of the acl, the slots are scanned sequentially through the memory.
+		 * With more than one thread the parts of the table are visited concurrently, so the function must be
+		 * thread-safe, the grants of one part are visited in order by one thread.
+		 * \param f the function taking `const grant_view&`
+		 * \param threads the number of the threads scanning the table
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each_grant(F f, const unsigned threads = 1) const {
+			// Visits the grants in O(n) where n is the number of the slots.
+			const std::int64_t now = to_ns(clock::now());
+			const size_t n = m_store.slot_count();
+			parallel_for(n, parts_of(n, threads), [this, &f, now](const size_t from, const size_t to, unsigned) {
+				m_store.for_each_slot(from, to, [&f, now](const storage::slot<R>& s) {
+					f(view_of(s, now));
+				});
+			});
+		}
+		/**
+		 * Collects the grants which permit the required rights, e.g. for an access review or an export
+		 * \param required the rights to check, by default any granted right is enough
+		 * \param threads the number of the threads scanning the table
+		 * @returns `std::vector<grant_view>` the grants in the order of the slots, i.e. of the storage
+		 */
+		std::vector<grant_view> grants(enums::rights required = enums::rights::none, const unsigned threads = 1) const {
+			const std::int64_t now = to_ns(clock::now());
+			const size_t n = m_store.slot_count();
+			const unsigned parts = parts_of(n, threads);
+			std::vector<std::vector<grant_view>> found(parts);
+			parallel_for(n, parts, [&](const size_t from, const size_t to, const unsigned part) {
+				m_store.for_each_slot(from, to, [&](const storage::slot<R>& s) {
+					const grant_view g = view_of(s, now);
+					if(enums::access_level(g.rights).permits(required)) {
+						found[part].push_back(g);
+					}
+				});
+			});
+			std::vector<grant_view> out;
+			for(const std::vector<grant_view>& part : found) {
+				out.insert(out.end(), part.begin(), part.end());
+			}
+			return out;
+		}
+		/**
+		 * Counts the grants which permit the required rights
+		 * \param required the rights to check, by default any granted right is enough
+		 * \param threads the number of the threads scanning the table
+		 * @returns `size_t`
+		 */
+		size_t count_allowed(enums::rights required = enums::rights::none, const unsigned threads = 1) const {
+			const std::int64_t now = to_ns(clock::now());
+			const size_t n = m_store.slot_count();
+			const unsigned parts = parts_of(n, threads);
+			std::vector<size_t> counts(parts);
+			parallel_for(n, parts, [&](const size_t from, const size_t to, const unsigned part) {
+				size_t count = 0;
+				m_store.for_each_slot(from, to, [&](const storage::slot<R>& s) {
+					count += enums::access_level(rights_at(s, now)).permits(required);
+				});
+				counts[part] = count;
+			});
+			size_t total = 0;
+			for(const size_t c : counts) {
+				total += c;
+			}
+			return total;
+		}
 		/**
 		 * Gets the size of access list.
-		 * @returns `const size_t`
+		 * @returns `const size_t` the number of subjects
 		 */
 		const size_t size() const {
-			return m_map.size();
+			return m_size;
 		}
 };
 }
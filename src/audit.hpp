@@ -0,0 +1,417 @@
+#ifndef __AUDIT_HPP__
+#define __AUDIT_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "exception.hpp"
+#include "snapshot.hpp"
+
+/// file: audit.hpp
+
+namespace libs {
+	namespace audit {
+
+/**
+ * @brief Enumerates the audited operations.
+ */
+enum class op : std::uint8_t {
+	is_allowed = 1,
+	allow = 2,
+	forbid = 3,
+	remove_subject = 4,
+	remove_grant = 5
+};
+
+/**
+ * @brief An audit record, the file is the sequence of the records in the native byte order.
+ *
+ * The time is in nanoseconds since the epoch of the system clock, as coarse as the resolution of the
+ * writer. The decision of a check is whether it has been allowed, the one of a mutation is whether it
+ * has found its subject and resource.
+ */
+struct record {
+	std::int64_t time;
+	std::uint64_t uuid;
+	std::uint32_t subject;
+	op operation;
+	std::uint8_t decision;
+	std::uint8_t reserved[2];
+};
+
+static_assert(sizeof(record) == 24, "The audit record must be packed");
+
+/**
+ * @brief The bounded single producer single consumer ring of the records of one thread.
+ *
+ * The producer keeps the last seen head of the consumer, so it touches the shared line only when
+ * the ring looks full. The record is dropped and counted if the ring is full indeed.
+ */
+class ring {
+	private:
+		alignas(64) std::atomic<std::uint64_t> m_tail{0};
+		std::uint64_t m_cached_head{0};
+		std::atomic<std::uint64_t> m_dropped{0};
+		alignas(64) std::atomic<std::uint64_t> m_head{0};
+		alignas(64) std::unique_ptr<record[]> m_records;
+		const std::uint64_t m_mask;
+	public:
+		/// Whether a thread produces into the ring, the one left by an exited thread is taken over by the next.
+		std::atomic<bool> in_use{false};
+		/**
+		 * The constructor with the capacity
+		 * \param capacity the number of the records, rounded up to a power of two
+		 */
+		explicit ring(size_t capacity): m_mask([capacity]() {
+			size_t n = 2;
+			while(n < capacity) {
+				n *= 2;
+			}
+			return n - 1;
+		}()) {
+			// Zeroed, so the pages are touched here rather than by the first records.
+			m_records.reset(new record[m_mask + 1]());
+		}
+		/**
+		 * Pushes the record, called by the producer only
+		 * \param r the record
+		 * @returns `bool` false if the ring is full and the record is dropped
+		 */
+		bool try_push(const record& r) noexcept {
+			const std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+			if(tail - m_cached_head > m_mask) {
+				m_cached_head = m_head.load(std::memory_order_acquire);
+				if(tail - m_cached_head > m_mask) {
+					m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					return false;
+				}
+			}
+			m_records[tail & m_mask] = r;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+		/**
+		 * Pops the records in place, called by the consumer only
+		 * \param f called as f(record* first, size_t count) for each of the at most two contiguous runs of the
+		 * records, they are handed back to the producer once it returns
+		 * @returns `size_t` the number of the popped records
+		 */
+		template <typename F>
+		size_t consume(F f) {
+			const std::uint64_t head = m_head.load(std::memory_order_relaxed);
+			const std::uint64_t tail = m_tail.load(std::memory_order_acquire);
+			const size_t count = static_cast<size_t>(tail - head);
+			const size_t first = static_cast<size_t>(head & m_mask);
+			const size_t run = std::min(count, static_cast<size_t>(m_mask + 1) - first);
+			if(run) {
+				f(m_records.get() + first, run);
+			}
+			if(count > run) {
+				f(m_records.get(), count - run);
+			}
+			m_head.store(tail, std::memory_order_release);
+			return count;
+		}
+		/**
+		 * Gets the number of the dropped records
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t dropped() const noexcept {
+			return m_dropped.load(std::memory_order_relaxed);
+		}
+};
+
+/**
+ * @brief Collects the audit records of the threads and writes them to the file in batches.
+ *
+ * Every thread records into its own ring, the first record of a thread binds a ring to it. The
+ * drainer thread wakes up by the interval and appends the records of all the rings to the file in
+ * one batch. The records the drainer has fallen behind with are dropped and counted, the checks
+ * never wait for it. Reading the clock costs more than the rest of a record, so the drainer also
+ * ticks a coarse clock the records take their time from, unless the resolution is zero.
+ */
+class writer {
+	private:
+		// The ring of the thread for one writer, kept alive by the thread until it exits.
+		struct binding {
+			std::uint64_t writer{};
+			std::shared_ptr<ring> bound;
+			binding(std::uint64_t w, std::shared_ptr<ring> r) noexcept: writer(w), bound(std::move(r)) {}
+			binding(binding&&) = default;
+			binding& operator=(binding&&) = default;
+			~binding() {
+				if(bound) {
+					bound->in_use.store(false, std::memory_order_release);
+				}
+			}
+		};
+		struct cache {
+			std::uint64_t writer{};
+			ring* bound{nullptr};
+		};
+		const std::uint64_t m_id;
+		const size_t m_capacity;
+		const std::chrono::milliseconds m_interval;
+		const std::chrono::microseconds m_resolution;
+		// The coarse clock, in nanoseconds since the epoch of the system clock.
+		alignas(64) std::atomic<std::int64_t> m_now{0};
+		std::FILE* m_file{nullptr};
+		std::mutex m_rings_mutex;
+		std::vector<std::shared_ptr<ring>> m_rings;
+		// Serializes the consumers of the rings, i.e. the drainer and `flush`.
+		std::mutex m_drain_mutex;
+		std::uint64_t m_written{0};
+		const char* m_error{nullptr};
+		std::mutex m_wake_mutex;
+		std::condition_variable m_wake;
+		bool m_stop{false};
+		std::thread m_drainer;
+		static std::uint64_t next_id() noexcept {
+			static std::atomic<std::uint64_t> id{0};
+			return id.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+		static std::int64_t wall_time() noexcept {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		}
+		static cache& last() noexcept {
+			static thread_local cache c;
+			return c;
+		}
+		ring* bind() {
+			static thread_local std::vector<binding> bindings;
+			// The rings of the destroyed writers are released.
+			for(size_t i = bindings.size(); i-- > 0;) {
+				if(bindings[i].bound.use_count() == 1) {
+					bindings.erase(bindings.begin() + static_cast<std::ptrdiff_t>(i));
+				}
+			}
+			for(const binding& b : bindings) {
+				if(b.writer == m_id) {
+					return b.bound.get();
+				}
+			}
+			std::shared_ptr<ring> r;
+			{
+				std::lock_guard<std::mutex> lock(m_rings_mutex);
+				for(const std::shared_ptr<ring>& candidate : m_rings) {
+					bool expected = false;
+					if(candidate->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+						r = candidate;
+						break;
+					}
+				}
+				if(!r) {
+					r = std::make_shared<ring>(m_capacity);
+					r->in_use.store(true, std::memory_order_relaxed);
+					m_rings.push_back(r);
+				}
+			}
+			bindings.emplace_back(m_id, r);
+			return r.get();
+		}
+		ring* local() {
+			cache& c = last();
+			if(c.writer != m_id) {
+				c.bound = bind();
+				c.writer = m_id;
+			}
+			return c.bound;
+		}
+		// Moves the records of the rings into the file, the caller holds the drain lock. Returns the error message or nullptr.
+		const char* drain() {
+			const char* error = nullptr;
+			{
+				// The records are written out of the rings, nothing is copied in between.
+				std::lock_guard<std::mutex> lock(m_rings_mutex);
+				for(const std::shared_ptr<ring>& r : m_rings) {
+					r->consume([this, &error](const record* first, const size_t count) {
+						if(!error && std::fwrite(first, sizeof(record), count, m_file) != count) {
+							error = "Error: Could not write the audit log";
+						}
+						m_written += error ? 0 : count;
+					});
+				}
+			}
+			if(!error && std::fflush(m_file) != 0) {
+				error = "Error: Could not flush the audit log";
+			}
+			return error;
+		}
+		void run() {
+			const std::chrono::nanoseconds step = m_resolution.count() > 0 ?
+				std::min<std::chrono::nanoseconds>(m_resolution, m_interval) : std::chrono::nanoseconds(m_interval);
+			std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now() + m_interval;
+			std::unique_lock<std::mutex> lock(m_wake_mutex);
+			while(!m_stop) {
+				m_wake.wait_for(lock, step, [this] {
+					return m_stop;
+				});
+				m_now.store(wall_time(), std::memory_order_relaxed);
+				if(!m_stop && std::chrono::steady_clock::now() < due) {
+					continue;
+				}
+				due = std::chrono::steady_clock::now() + m_interval;
+				lock.unlock();
+				{
+					// The error is kept for the next `flush` to raise, the drainer goes on.
+					std::lock_guard<std::mutex> drain_lock(m_drain_mutex);
+					if(const char* error = drain()) {
+						m_error = error;
+					}
+				}
+				lock.lock();
+			}
+		}
+	public:
+		/**
+		 * Opens the audit file for appending and starts the drainer
+		 * \param path the path of the file
+		 * \param capacity the number of the records every thread could have pending, rounded up to a power of two
+		 * \param interval the time the drainer sleeps between the batches
+		 * \param resolution the resolution of the time of the records, zero reads the system clock for every record
+		 */
+		explicit writer(const std::string& path, size_t capacity = 16384,
+				std::chrono::milliseconds interval = std::chrono::milliseconds(10),
+				std::chrono::microseconds resolution = std::chrono::microseconds(1000)):
+			m_id(next_id()), m_capacity(capacity), m_interval(interval), m_resolution(resolution), m_now(wall_time()) {
+			m_file = std::fopen(path.c_str(), "ab");
+			if(!m_file) {
+				std::string msg = std::string("Error: Could not open the audit log: ") + path;
+				libs::exception::raise(msg.c_str());
+			}
+			m_drainer = std::thread([this] {
+				run();
+			});
+		}
+		/**
+		 * The copy constructor deleted
+		 */
+		writer(const writer&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		writer& operator=(const writer&) = delete;
+		/**
+		 * Stops the drainer, drains the rings the last time and closes the file.
+		 * The threads must not record into the writer meanwhile.
+		 */
+		~writer() {
+			{
+				std::lock_guard<std::mutex> lock(m_wake_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_one();
+			m_drainer.join();
+			{
+				// The error is dropped, there is no one left to report it to.
+				std::lock_guard<std::mutex> lock(m_drain_mutex);
+				drain();
+			}
+			std::fclose(m_file);
+		}
+		/**
+		 * Records the operation into the ring of the calling thread, the first call of a thread allocates its ring
+		 * \param o the operation
+		 * \param subject the handle value of the subject
+		 * \param uuid the uuid of the resource
+		 * \param decision whether it has been allowed or applied
+		 * @returns `bool` false if the ring is full and the record has been dropped
+		 */
+		bool record_op(const op o, const std::uint32_t subject, const std::uint64_t uuid, const bool decision) {
+			record r;
+			r.time = m_resolution.count() > 0 ? m_now.load(std::memory_order_relaxed) : wall_time();
+			r.uuid = uuid;
+			r.subject = subject;
+			r.operation = o;
+			r.decision = decision;
+			r.reserved[0] = 0;
+			r.reserved[1] = 0;
+			return local()->try_push(r);
+		}
+		/**
+		 * Drains the records pushed so far into the file on the calling thread, raises the error of the drainer if any
+		 * @returns `void`
+		 */
+		void flush() {
+			std::lock_guard<std::mutex> lock(m_drain_mutex);
+			const char* error = drain();
+			if(!error) {
+				error = m_error;
+			}
+			m_error = nullptr;
+			if(error) {
+				libs::exception::raise(error);
+			}
+		}
+		/**
+		 * Gets the number of the records written to the file
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t written() {
+			std::lock_guard<std::mutex> lock(m_drain_mutex);
+			return m_written;
+		}
+		/**
+		 * Gets the number of the records dropped because the drainer has fallen behind
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t dropped() {
+			std::lock_guard<std::mutex> lock(m_rings_mutex);
+			std::uint64_t total = 0;
+			for(const std::shared_ptr<ring>& r : m_rings) {
+				total += r->dropped();
+			}
+			return total;
+		}
+		/**
+		 * Gets the number of the rings, i.e. the most threads which have recorded at once
+		 * @returns `size_t`
+		 */
+		size_t ring_count() {
+			std::lock_guard<std::mutex> lock(m_rings_mutex);
+			return m_rings.size();
+		}
+};
+
+/**
+ * @brief Reads the records of an audit file up to the end, a torn tail record is ignored.
+ */
+class reader {
+	private:
+		snapshot::mapped_file m_file;
+		size_t m_pos{};
+	public:
+		/**
+		 * Opens the audit file
+		 * \param path the path of the file
+		 */
+		explicit reader(const std::string& path): m_file(path) {}
+		/**
+		 * Reads the next record
+		 * \param r receives the record
+		 * @returns `bool` false at the end of the records
+		 */
+		bool next(record& r) noexcept {
+			if(m_file.size() - m_pos < sizeof(record)) {
+				return false;
+			}
+			std::memcpy(&r, m_file.data() + m_pos, sizeof(record));
+			m_pos += sizeof(record);
+			return true;
+		}
+};
+}
+}
+
+#endif // __AUDIT_HPP__
@@ -0,0 +1,310 @@
+#ifndef __CLIENT_HPP__
+#define __CLIENT_HPP__
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "access_level.hpp"
+#include "exception.hpp"
+#include "protocol.hpp"
+#include "resource.hpp"
+#include "serializer.hpp"
+#include "status.hpp"
+#include "subject.hpp"
+
+/// file: client.hpp
+
+namespace libs {
+	namespace daemon {
+
+/**
+ * @brief Queries the acl served by the daemon, see `server.hpp`.
+ *
+ * The plain calls wait for their own response. The requests could be pipelined instead: `send`
+ * only buffers the request, `flush` writes out everything buffered and `receive` gets the responses
+ * in the order of the requests, the plain calls are not mixed with the pending ones. A client is
+ * used by one thread at a time.
+ * \tparam S the type of data stored in subject, serializable
+ * \tparam R the type of data stored in resource, serializable
+ */
+template <typename S, typename R>
+class client {
+	private:
+		static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+		static_assert(serialization::is_serializable<R>, "The resource type must have a serializer");
+		static constexpr size_t read_size = 64 * 1024;
+		static constexpr size_t window = 4096;
+		int m_fd{-1};
+		std::string m_out;
+		std::string m_in;
+		// The bytes of `m_in` consumed by the responses already received.
+		size_t m_consumed{};
+		std::uint32_t m_tag{};
+		std::string m_subject;
+		std::string m_resource;
+		std::unique_ptr<char[]> m_buffer{new char[read_size]};
+
+		response call(const op code, const S& id, const size_t uuid, const enums::rights r, const R* res = nullptr) {
+			const std::uint32_t tag = send(code, id, uuid, r, res);
+			flush();
+			const response resp = receive();
+			if(resp.tag != tag) {
+				libs::exception::raise("Error: Unexpected response of the daemon");
+			}
+			return resp;
+		}
+	public:
+		/**
+		 * Connects to the daemon
+		 * \param path the path of the socket
+		 */
+		explicit client(const std::string& path) {
+			sockaddr_un addr{};
+			if(path.size() >= sizeof(addr.sun_path)) {
+				libs::exception::raise("Error: The socket path is too long");
+			}
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+			m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if(m_fd < 0) {
+				libs::exception::raise("Error: Could not create the socket");
+			}
+			if(::connect(m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+				::close(m_fd);
+				m_fd = -1;
+				libs::exception::raise("Error: Could not connect to the daemon");
+			}
+		}
+		/**
+		 * The copy constructor deleted
+		 */
+		client(const client&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		client& operator=(const client&) = delete;
+		/**
+		 * Disconnects, the requests still buffered are dropped
+		 */
+		~client() {
+			if(m_fd >= 0) {
+				::close(m_fd);
+			}
+		}
+		/**
+		 * Buffers the request without sending it
+		 * \param code the request
+		 * \param id the id of the subject
+		 * \param uuid the uuid of the resource, if any
+		 * \param r the rights to check, grant or revoke
+		 * \param res the resource of `op::add`
+		 * @returns `std::uint32_t` the tag the response is matched by
+		 */
+		std::uint32_t send(const op code, const S& id, const size_t uuid = 0, const enums::rights r = enums::rights::none,
+				const R* res = nullptr) {
+			m_subject.clear();
+			serialization::serializer<S>::write(m_subject, id);
+			m_resource.clear();
+			if(res) {
+				serialization::serializer<R>::write(m_resource, *res);
+			}
+			request req;
+			req.tag = ++m_tag;
+			req.code = code;
+			req.rights = r;
+			req.uuid = uuid;
+			req.subject = m_subject;
+			req.resource = m_resource;
+			encode(m_out, req);
+			return req.tag;
+		}
+		/**
+		 * Writes out the buffered requests
+		 * @returns `void`
+		 */
+		void flush() {
+			size_t sent = 0;
+			while(sent < m_out.size()) {
+				const ssize_t put = ::send(m_fd, m_out.data() + sent, m_out.size() - sent, MSG_NOSIGNAL);
+				if(put < 0 && errno == EINTR) {
+					continue;
+				}
+				if(put <= 0) {
+					libs::exception::raise("Error: Could not send to the daemon");
+				}
+				sent += static_cast<size_t>(put);
+			}
+			m_out.clear();
+		}
+		/**
+		 * Waits for the next response
+		 * @returns `response` the popped resource it refers to is valid until the next call
+		 */
+		response receive() {
+			std::string_view rest(m_in.data() + m_consumed, m_in.size() - m_consumed);
+			size_t size = frame_size(rest);
+			while(size == 0) {
+				if(is_malformed(rest)) {
+					libs::exception::raise("Error: Malformed response of the daemon");
+				}
+				const ssize_t got = ::recv(m_fd, m_buffer.get(), read_size, 0);
+				if(got < 0 && errno == EINTR) {
+					continue;
+				}
+				if(got <= 0) {
+					libs::exception::raise("Error: The daemon closed the connection");
+				}
+				m_in.erase(0, m_consumed);
+				m_consumed = 0;
+				m_in.append(m_buffer.get(), static_cast<size_t>(got));
+				rest = m_in;
+				size = frame_size(rest);
+			}
+			response resp;
+			if(!decode(rest.substr(0, size), resp)) {
+				libs::exception::raise("Error: Malformed response of the daemon");
+			}
+			m_consumed += size;
+			return resp;
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const subjects::subject<S>& sub, const size_t uuid, enums::rights required = enums::rights::none) {
+			return call(op::is_allowed, sub.get_id(), uuid, required).value;
+		}
+		/**
+		 * Checks a batch of (subject id, uuid) pairs in one round trip, the daemon answers them by a batched call
+		 * \param checks the pairs of the subject id and the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `std::vector<bool>` the results in the order of the checks
+		 */
+		std::vector<bool> is_allowed_batch(const std::vector<std::pair<S, size_t>>& checks, enums::rights required = enums::rights::none) {
+			std::vector<bool> results(checks.size());
+			// Sent by windows, so neither side blocks on a full socket while the other does as well.
+			for(size_t begin = 0; begin < checks.size(); begin += window) {
+				const size_t end = std::min(checks.size(), begin + window);
+				for(size_t i = begin; i < end; ++i) {
+					send(op::is_allowed, checks[i].first, checks[i].second, required);
+				}
+				flush();
+				for(size_t i = begin; i < end; ++i) {
+					results[i] = receive().value;
+				}
+			}
+			return results;
+		}
+		/**
+		 * Checks whether the specified resource exists within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * @returns `bool`
+		 */
+		bool has_resource(const subjects::subject<S>& sub, const size_t uuid) {
+			return call(op::has_resource, sub.get_id(), uuid, enums::rights::none).value;
+		}
+		/**
+		 * Checks whether the specified subject exists
+		 * \param sub the subject
+		 * @returns `bool`
+		 */
+		bool has_subject(const subjects::subject<S>& sub) {
+			return call(op::has_subject, sub.get_id(), 0, enums::rights::none).value;
+		}
+		/**
+		 * Adds the resource to the specified subject
+		 * \param sub the subject
+		 * \param res the resource, sent by its serialized value
+		 * \param access the access level for the resource, by default it is set to be `forbiden`
+		 * @returns `status::result<size_t>` the uuid of the added resource or the error
+		 */
+		status::result<size_t> add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access = enums::access_level()) {
+			if(!res || !res->get()) {
+				return status::code::invalid_resource;
+			}
+			const response resp = call(op::add, sub.get_id(), 0, access.get_rights(), res->get());
+			if(resp.code != status::code::ok) {
+				return resp.code;
+			}
+			return static_cast<size_t>(resp.uuid);
+		}
+		/**
+		 * Allows an access to the specified resource within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant, by default all of them
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code allow_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) {
+			return call(op::allow, sub.get_id(), uuid, r).code;
+		}
+		/**
+		 * Forbids the access to the specified resource within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to revoke, by default all of them
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code forbid_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) {
+			return call(op::forbid, sub.get_id(), uuid, r).code;
+		}
+		/**
+		 * Removes the subject along with its resources
+		 * \param sub the subject
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code remove(const subjects::subject<S>& sub) {
+			return call(op::remove_subject, sub.get_id(), 0, enums::rights::none).code;
+		}
+		/**
+		 * Removes the specified resource from the subject
+		 * \param sub the subject
+		 * \param uuid of the resource
+		 * @returns `status::code` `status::code::ok` or the error
+		 */
+		status::code remove(const subjects::subject<S>& sub, const size_t uuid) {
+			return call(op::remove_grant, sub.get_id(), uuid, enums::rights::none).code;
+		}
+		/**
+		 * Tryies to pop the resource from the specified subject, the grant itself stays in place.
+		 * \param sub the subject
+		 * \param uuid the uuid of the specified resource
+		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
+		 */
+		std::unique_ptr<resources::resource<R>> try_pop(const subjects::subject<S>& sub, const size_t uuid) {
+			const response resp = call(op::try_pop, sub.get_id(), uuid, enums::rights::none);
+			if(resp.code != status::code::ok) {
+				return nullptr;
+			}
+			std::unique_ptr<resources::resource<R>> res = std::make_unique<resources::resource<R>>();
+			if(resp.has_resource) {
+				R value;
+				if(!serialization::serializer<R>::read(resp.resource, value)) {
+					libs::exception::raise("Error: Malformed resource sent by the daemon");
+				}
+				res = std::make_unique<resources::resource<R>>(std::move(value));
+			}
+			res->set_uuid(uuid);
+			return res;
+		}
+};
+}
+}
+
+#endif // __CLIENT_HPP__
@@ -0,0 +1,656 @@
+#ifndef __CONCURRENT_ACL_HPP__
+#define __CONCURRENT_ACL_HPP__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "access_level.hpp"
+#include "epoch.hpp"
+#include "exception.hpp"
+#include "resource.hpp"
+#include "shard_map.hpp"
+#include "subject.hpp"
+#include "version_clock.hpp"
+
+/// file: concurrent_acl.hpp
+
+namespace libs {
+	namespace acl {
+/**
+ * @brief Defines the thread-safe counterpart of the acl.
+ *
+ * The subjects are partitioned into shards, every shard keeps its subjects in a map changed one
+ * entry at a time, each subject chains its incarnations the views could still read. The grants live in the shard
+ * of their subject, mapped by the uuid, the state of a grant is a single atomic word of its rights and version.
+ * The readers, i.e. `is_allowed`, `has_resource` and `has_subject`, never lock, the writers
+ * serialize per shard and commit in the version order. The views taken by `snapshot` read a
+ * consistent past version, the states superseded meanwhile are kept for them. The unlinked
+ * objects are reclaimed through the epoch domain.
+ * \tparam S the type of data stored in subject
+ * \tparam R the type of data stored in resource
+ * \tparam N the number of shards
+ */
+template <typename S, typename R, size_t N = 64>
+class concurrent_acl {
+	private:
+		static constexpr unsigned version_shift = 8;
+		static constexpr std::uint64_t rights_mask = static_cast<std::uint8_t>(enums::rights::all);
+		// Marks the state of the removed grant, or of the grant which did not exist yet.
+		static constexpr std::uint64_t removed = 0x80;
+		// The version of the subject which is not created yet, or not removed yet.
+		static constexpr std::uint64_t never = ~std::uint64_t(0);
+		// Keeps a superseded state of the grant while a view could still read it.
+		struct history {
+			const std::uint64_t state;
+			std::atomic<history*> older;
+			history(std::uint64_t s, history* next): state(s), older(next) {}
+			~history() {
+				history* h = older.load(std::memory_order_relaxed);
+				while(h) {
+					history* next = h->older.exchange(nullptr, std::memory_order_relaxed);
+					delete h;
+					h = next;
+				}
+			}
+		};
+		struct grant {
+			// The version the state was set at, shifted by `version_shift`, along with the rights.
+			std::atomic<std::uint64_t> state{removed};
+			std::atomic<history*> older{nullptr};
+			const std::uint64_t subject;
+			std::unique_ptr<resources::resource<R>> resource;
+			grant(std::uint64_t sub, std::unique_ptr<resources::resource<R>> res):
+				subject(sub), resource(std::move(res)) {}
+			~grant() {
+				delete older.load(std::memory_order_relaxed);
+			}
+		};
+		// An incarnation of the subject, the shard maps the subject to the latest one which chains the older ones.
+		struct subject_node {
+			// Identifies the node, the ids are never reused so a re-added subject never matches stale grants.
+			const std::uint64_t id;
+			const S key;
+			// The versions the subject was added and removed at.
+			std::atomic<std::uint64_t> created{never};
+			std::atomic<std::uint64_t> removed_at{never};
+			std::atomic<subject_node*> older{nullptr};
+			// Accessed by the writers of the shard only.
+			std::unordered_set<size_t> uuids;
+			subject_node(std::uint64_t node_id, const S& k): id(node_id), key(k) {}
+		};
+		struct alignas(64) shard {
+			std::mutex mutex;
+			concurrency::shard_map<S, subject_node*> subjects;
+			concurrency::shard_map<size_t, grant*> grants;
+		};
+		// The work put off until no view pins a version older than `version`.
+		enum class chore : std::uint8_t {
+			grant,
+			node,
+			history
+		};
+		struct deferred {
+			chore kind;
+			std::uint64_t version;
+			size_t shard;
+			size_t uuid;
+			subject_node* node;
+		};
+
+		std::array<shard, N> m_shards;
+		std::atomic<size_t> m_uuid{1};
+		std::atomic<std::uint64_t> m_node_id{1};
+		std::atomic<size_t> m_size{0};
+		concurrency::epoch_domain& m_domain{concurrency::epoch_domain::global()};
+		concurrency::version_clock m_versions;
+		std::mutex m_deferred_mutex;
+		std::vector<deferred> m_deferred;
+		// The oldest version any deferred chore waits for, `never` if there is none.
+		std::atomic<std::uint64_t> m_next_ready{never};
+
+		static constexpr std::uint64_t version_of(const std::uint64_t state) noexcept {
+			return state >> version_shift;
+		}
+		size_t shard_index(const S& id) const noexcept {
+			const std::uint64_t h = static_cast<std::uint64_t>(std::hash<S>()(id)) * 0x9e3779b97f4a7c15ull;
+			return (h >> 32) % N;
+		}
+		shard& shard_of(const S& id) noexcept {
+			return m_shards[shard_index(id)];
+		}
+		// Must be called within an epoch guard or with the shard locked, only the latest node could be alive.
+		subject_node* find_node(const S& id) noexcept {
+			subject_node* node = shard_of(id).subjects.find(id);
+			return node && node->created.load(std::memory_order_acquire) != never &&
+				node->removed_at.load(std::memory_order_acquire) == never ? node : nullptr;
+		}
+		// Must be called within an epoch guard, finds the node alive as of the pinned version.
+		const subject_node* find_node(const S& id, const std::uint64_t version) noexcept {
+			const subject_node* node = shard_of(id).subjects.find(id);
+			while(node && node->created.load(std::memory_order_acquire) > version) {
+				node = node->older.load(std::memory_order_acquire);
+			}
+			return node && node->removed_at.load(std::memory_order_acquire) > version ? node : nullptr;
+		}
+		// Must be called within an epoch guard or with the shard locked.
+		grant* find_grant(const S& id, const size_t uuid) noexcept {
+			const subject_node* node = find_node(id);
+			grant* g = node ? shard_of(id).grants.find(uuid) : nullptr;
+			return g && g->subject == node->id && !(g->state.load(std::memory_order_acquire) & removed) ? g : nullptr;
+		}
+		// Must be called within an epoch guard, gets the state of the grant as of the pinned version.
+		std::uint64_t find_state(const S& id, const size_t uuid, const std::uint64_t version) noexcept {
+			const subject_node* node = find_node(id, version);
+			const grant* g = node ? shard_of(id).grants.find(uuid) : nullptr;
+			if(!g || g->subject != node->id) {
+				return removed;
+			}
+			const std::uint64_t state = g->state.load(std::memory_order_acquire);
+			if(version_of(state) <= version) {
+				return state;
+			}
+			const history* h = g->older.load(std::memory_order_acquire);
+			while(h && version_of(h->state) > version) {
+				h = h->older.load(std::memory_order_acquire);
+			}
+			return h ? h->state : removed;
+		}
+		// Drops the states no view could read. Only the views walk the history and none of them goes
+		// past the newest state not later than the oldest pinned version, so the rest is deleted at once.
+		static bool prune(grant& g, const std::uint64_t oldest) noexcept {
+			if(version_of(g.state.load(std::memory_order_relaxed)) <= oldest) {
+				delete g.older.exchange(nullptr, std::memory_order_relaxed);
+				return false;
+			}
+			history* h = g.older.load(std::memory_order_relaxed);
+			while(h && version_of(h->state) > oldest) {
+				h = h->older.load(std::memory_order_relaxed);
+			}
+			if(h) {
+				delete h->older.exchange(nullptr, std::memory_order_relaxed);
+			}
+			return true;
+		}
+		void defer(const chore kind, const std::uint64_t version, const size_t index, const size_t uuid, subject_node* node) {
+			std::lock_guard<std::mutex> lock(m_deferred_mutex);
+			m_deferred.push_back(deferred{kind, version, index, uuid, node});
+			if(version < m_next_ready.load(std::memory_order_relaxed)) {
+				m_next_ready.store(version, std::memory_order_release);
+			}
+		}
+		// Must be called with no shard locked, the writers take the chores which are ready off the views.
+		void collect_ready() {
+			const std::uint64_t next = m_next_ready.load(std::memory_order_acquire);
+			if(next != never && next <= m_versions.oldest()) {
+				collect();
+			}
+		}
+		// Must be called with the shard locked, sets the state of the grant keeping the superseded one for the views.
+		std::uint64_t set_state(const size_t index, const size_t uuid, grant& g, const std::uint64_t bits) {
+			const std::uint64_t state = g.state.load(std::memory_order_relaxed);
+			if((state & (rights_mask | removed)) == bits) {
+				return 0;
+			}
+			history* h = new history(state, g.older.load(std::memory_order_relaxed));
+			const std::uint64_t version = m_versions.begin();
+			g.older.store(h, std::memory_order_release);
+			g.state.store(version << version_shift | bits, std::memory_order_release);
+			m_versions.commit(version);
+			if(prune(g, m_versions.oldest())) {
+				defer(chore::history, version, index, uuid, nullptr);
+			}
+			return version;
+		}
+		// Must be called with the shard locked, unlinks the grant removed at the version once no view could see it.
+		void reclaim(const size_t index, const size_t uuid, const std::uint64_t version) {
+			if(m_versions.oldest() < version) {
+				defer(chore::grant, version, index, uuid, nullptr);
+				return;
+			}
+			m_domain.retire(m_shards[index].grants.erase(uuid));
+		}
+		// Must be called with the shard locked, unlinks the subject removed at the version once no view could see it.
+		void reclaim(const size_t index, subject_node* node, const std::uint64_t version) {
+			if(m_versions.oldest() < version) {
+				defer(chore::node, version, index, 0, node);
+				return;
+			}
+			for(const size_t uuid : node->uuids) {
+				m_domain.retire(m_shards[index].grants.erase(uuid));
+			}
+			// Unlinks the node from the chain of the subject, the later incarnations stay.
+			concurrency::shard_map<S, subject_node*>& subjects = m_shards[index].subjects;
+			subject_node* n = subjects.find(node->key);
+			subject_node* older = node->older.load(std::memory_order_relaxed);
+			if(n == node) {
+				if(older) {
+					subjects.assign(node->key, older);
+				} else {
+					subjects.erase(node->key);
+				}
+			} else {
+				while(n && n->older.load(std::memory_order_relaxed) != node) {
+					n = n->older.load(std::memory_order_relaxed);
+				}
+				if(n) {
+					n->older.store(older, std::memory_order_release);
+				}
+			}
+			m_domain.retire(node);
+		}
+		// Must be called with the shard locked, marks the grant removed, the caller reclaims it afterwards.
+		std::pair<grant*, std::uint64_t> remove_grant(const size_t index, const S& id, const size_t uuid) {
+			subject_node* node = find_node(id);
+			grant* g = node ? find_grant(id, uuid) : nullptr;
+			if(!g) {
+				return {nullptr, 0};
+			}
+			const std::uint64_t version = set_state(index, uuid, *g, removed);
+			node->uuids.erase(uuid);
+			return {g, version};
+		}
+	public:
+		/**
+		 * @brief Reads the acl as of the pinned version, all the checks made through one view agree with each other.
+		 *
+		 * The view never blocks the writers nor is blocked by them, the states it could read are kept until it is
+		 * destroyed and reclaimed by the next writer afterwards.
+		 * It could be passed between the threads but must not outlive the acl.
+		 */
+		class view {
+			private:
+				concurrent_acl* m_acl;
+				concurrency::version_clock::pin m_pin;
+				friend class concurrent_acl;
+				explicit view(concurrent_acl& acl): m_acl(&acl), m_pin(acl.m_versions) {}
+				std::uint64_t find_state(const subjects::subject<S>& sub, const size_t uuid) const {
+					const S* id = sub.try_get_id();
+					if(!id) {
+						return removed;
+					}
+					concurrency::epoch_domain::guard guard(m_acl->m_domain);
+					return m_acl->find_state(*id, uuid, m_pin.version());
+				}
+			public:
+				/**
+				 * The copy constructor deleted
+				 */
+				view(const view&) = delete;
+				/**
+				 * The assignement operator deleted
+				 */
+				view& operator=(const view&) = delete;
+				/**
+				 * The move constructor
+				 * \param other the view that should be moved.
+				 */
+				view(view&& other) noexcept: m_acl(other.m_acl), m_pin(std::move(other.m_pin)) {
+					other.m_acl = nullptr;
+				}
+				/**
+				 * Unpins the version without locking, the next writer reclaims the states kept for it alone
+				 */
+				~view() = default;
+				/**
+				 * Gets the version the view reads
+				 * @returns `std::uint64_t`
+				 */
+				std::uint64_t version() const noexcept {
+					return m_pin.version();
+				}
+				/**
+				 * Checks whether or not the resource was allowed within the specified subject, never blocks
+				 * \param sub the subject
+				 * \param uuid the uuid of the resource
+				 * \param required the rights to check, by default any granted right is enough
+				 * @returns `bool` returns true if allowed, false vice versa.
+				 */
+				bool is_allowed(const subjects::subject<S>& sub, const size_t uuid, enums::rights required = enums::rights::none) const {
+					const std::uint64_t state = find_state(sub, uuid);
+					return !(state & removed) && enums::access_level(static_cast<enums::rights>(state & rights_mask)).permits(required);
+				}
+				/**
+				 * Checks whether the specified resource existed within the specified subject, never blocks
+				 * \param sub the subject
+				 * \param uuid the uuid of the resource
+				 * @returns `bool`
+				 */
+				bool has_resource(const subjects::subject<S>& sub, const size_t uuid) const {
+					return !(find_state(sub, uuid) & removed);
+				}
+				/**
+				 * Checks whether the specified subject existed, never blocks
+				 * \param sub the subject
+				 * @returns `bool`
+				 */
+				bool has_subject(const subjects::subject<S>& sub) const {
+					const S* id = sub.try_get_id();
+					if(!id) {
+						return false;
+					}
+					concurrency::epoch_domain::guard guard(m_acl->m_domain);
+					return m_acl->find_node(*id, m_pin.version()) != nullptr;
+				}
+		};
+		/**
+		 * The default constructor
+		 */
+		concurrent_acl() = default;
+		/**
+		 * The copy constructor deleted
+		 */
+		concurrent_acl(const concurrent_acl&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		concurrent_acl& operator=(const concurrent_acl&) = delete;
+		/**
+		 * The destructor, there must be no concurrent calls nor views meanwhile
+		 */
+		~concurrent_acl() {
+			// The removed grants and nodes left for the views are still mapped, or chained to the latest nodes.
+			for(shard& sh : m_shards) {
+				sh.grants.for_each([](const size_t, grant* g) {
+					delete g;
+				});
+				sh.subjects.for_each([](const S&, subject_node* node) {
+					while(node) {
+						subject_node* older = node->older.load(std::memory_order_relaxed);
+						delete node;
+						node = older;
+					}
+				});
+			}
+			m_domain.reclaim();
+		}
+		/**
+		 * Pins the latest version, the view sees the acl as of it while the writers go on
+		 * @returns `view`
+		 */
+		view snapshot() {
+			return view(*this);
+		}
+		/**
+		 * Reclaims the states, grants and subjects kept for the views which are gone. The writers call it
+		 * themselves once some are ready.
+		 * @returns `void`
+		 */
+		void collect() {
+			std::vector<deferred> ready;
+			{
+				std::lock_guard<std::mutex> lock(m_deferred_mutex);
+				if(m_deferred.empty()) {
+					return;
+				}
+				const std::uint64_t oldest = m_versions.oldest();
+				auto it = std::partition(m_deferred.begin(), m_deferred.end(), [oldest](const deferred& d) {
+					return d.version > oldest;
+				});
+				ready.assign(it, m_deferred.end());
+				m_deferred.erase(it, m_deferred.end());
+				std::uint64_t next = never;
+				for(const deferred& d : m_deferred) {
+					next = std::min(next, d.version);
+				}
+				m_next_ready.store(next, std::memory_order_release);
+			}
+			for(const deferred& d : ready) {
+				std::lock_guard<std::mutex> lock(m_shards[d.shard].mutex);
+				switch(d.kind) {
+					case chore::grant:
+						reclaim(d.shard, d.uuid, d.version);
+						break;
+					case chore::node:
+						reclaim(d.shard, d.node, d.version);
+						break;
+					case chore::history:
+						// The later changes of the grant defer their own trimming.
+						if(grant* g = m_shards[d.shard].grants.find(d.uuid)) {
+							prune(*g, m_versions.oldest());
+						}
+						break;
+				}
+			}
+		}
+		/**
+		 * Adds the resource to the specified subject, the uuid is allocated atomically
+		 * \param sub the subject
+		 * \param res the resource
+		 * \param access the access level for the resource, by default it is set to be `forbiden`
+		 * @returns `size_t` the uuid of the added resource
+		 */
+		size_t add(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res,
+				enums::access_level access = enums::access_level()) {
+			const S& id = sub.get_id();
+			const size_t uuid = m_uuid.fetch_add(1, std::memory_order_relaxed);
+			res.get()->set_uuid(uuid);
+			const size_t index = shard_index(id);
+			shard& sh = m_shards[index];
+			collect_ready();
+			std::lock_guard<std::mutex> lock(sh.mutex);
+			subject_node* node = find_node(id);
+			std::unique_ptr<subject_node> fresh;
+			if(!node) {
+				fresh = std::make_unique<subject_node>(m_node_id.fetch_add(1, std::memory_order_relaxed), id);
+				node = fresh.get();
+			}
+			std::unique_ptr<grant> g = std::make_unique<grant>(node->id, std::move(res));
+			subject_node* latest = sh.subjects.find(id);
+			typename concurrency::shard_map<S, subject_node*>::entry subject_entry;
+			if(fresh && !latest) {
+				subject_entry = sh.subjects.prepare(id, node);
+			}
+			typename concurrency::shard_map<size_t, grant*>::entry grant_entry = sh.grants.prepare(uuid, g.get());
+			node->uuids.insert(uuid);
+			// Nothing fails from now on, the grant and the node are linked ahead of the version and stay unseen until it.
+			sh.grants.insert(std::move(grant_entry));
+			if(fresh) {
+				fresh->older.store(latest, std::memory_order_relaxed);
+				if(!latest) {
+					sh.subjects.insert(std::move(subject_entry));
+				} else {
+					sh.subjects.assign(id, node);
+				}
+			}
+			const bool created = fresh != nullptr;
+			const std::uint64_t version = m_versions.begin();
+			g.release()->state.store(version << version_shift | static_cast<std::uint8_t>(access.get_rights()), std::memory_order_release);
+			if(created) {
+				// The grant becomes visible along with the subject.
+				fresh.release()->created.store(version, std::memory_order_release);
+			}
+			m_versions.commit(version);
+			if(created) {
+				m_size.fetch_add(1, std::memory_order_relaxed);
+			}
+			return uuid;
+		}
+		/**
+		 * Allows an access to the specified resource within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to grant, by default all of them
+		 * @returns `void`
+		 */
+		void allow_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) {
+			const S* key = sub.try_get_id();
+			if(!key) {
+				return;
+			}
+			const S& id = *key;
+			const size_t index = shard_index(id);
+			collect_ready();
+			std::lock_guard<std::mutex> lock(m_shards[index].mutex);
+			if(grant* g = find_grant(id, uuid)) {
+				set_state(index, uuid, *g, (g->state.load(std::memory_order_relaxed) | static_cast<std::uint8_t>(r)) & rights_mask);
+			}
+		}
+		/**
+		 * Forbids the access to the specified resource within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid og the specified resource
+		 * \param r the rights to revoke, by default all of them
+		 * @returns `void`
+		 */
+		void forbid_access(const subjects::subject<S>& sub, const size_t uuid, enums::rights r = enums::rights::all) {
+			const S* key = sub.try_get_id();
+			if(!key) {
+				return;
+			}
+			const S& id = *key;
+			const size_t index = shard_index(id);
+			collect_ready();
+			std::lock_guard<std::mutex> lock(m_shards[index].mutex);
+			if(grant* g = find_grant(id, uuid)) {
+				set_state(index, uuid, *g, g->state.load(std::memory_order_relaxed) & rights_mask & ~std::uint64_t(static_cast<std::uint8_t>(r)));
+			}
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject, never blocks
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const subjects::subject<S>& sub, const size_t uuid, enums::rights required = enums::rights::none) {
+			const S* id = sub.try_get_id();
+			if(!id) {
+				return false;
+			}
+			concurrency::epoch_domain::guard guard(m_domain);
+			grant* g = find_grant(*id, uuid);
+			return g ? enums::access_level(static_cast<enums::rights>(g->state.load(std::memory_order_acquire) & rights_mask)).permits(required) : false;
+		}
+		/**
+		 * Removes the subject along with its resources
+		 * \param sub the subject
+		 * @returns `void`
+		 */
+		void remove(const subjects::subject<S>& sub) {
+			const S* key = sub.try_get_id();
+			if(!key) {
+				return;
+			}
+			const S& id = *key;
+			const size_t index = shard_index(id);
+			collect_ready();
+			std::lock_guard<std::mutex> lock(m_shards[index].mutex);
+			subject_node* node = find_node(id);
+			if(!node) {
+				return;
+			}
+			// Stamping the removal is the linearization point, the stale cells never match another node.
+			const std::uint64_t version = m_versions.begin();
+			node->removed_at.store(version, std::memory_order_release);
+			m_versions.commit(version);
+			m_size.fetch_sub(1, std::memory_order_relaxed);
+			reclaim(index, node, version);
+		}
+		/**
+		 * Removes the specified resource from the subject
+		 * \param sub the subject
+		 * \param uuid of the resource
+		 * @returns `void`
+		 */
+		void remove(const subjects::subject<S>& sub, const size_t uuid) {
+			const S* key = sub.try_get_id();
+			if(!key) {
+				return;
+			}
+			const S& id = *key;
+			const size_t index = shard_index(id);
+			collect_ready();
+			std::lock_guard<std::mutex> lock(m_shards[index].mutex);
+			const std::pair<grant*, std::uint64_t> removal = remove_grant(index, id, uuid);
+			if(removal.first) {
+				reclaim(index, uuid, removal.second);
+			}
+		}
+		/**
+		 * Checks whether the specified subject exists, never blocks
+		 * \param sub the subject
+		 * @returns `bool`
+		 */
+		bool has_subject(const subjects::subject<S>& sub) {
+			const S* id = sub.try_get_id();
+			if(!id) {
+				return false;
+			}
+			concurrency::epoch_domain::guard guard(m_domain);
+			return find_node(*id) != nullptr;
+		}
+		/**
+		 * Checks whether the specified resource exists within the specified subject, never blocks
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * @returns `bool`
+		 */
+		bool has_resource(const subjects::subject<S>& sub, const size_t uuid) {
+			const S* id = sub.try_get_id();
+			if(!id) {
+				return false;
+			}
+			concurrency::epoch_domain::guard guard(m_domain);
+			return find_grant(*id, uuid) != nullptr;
+		}
+		/**
+		 * Tryies to pop the resource from the specified subject, the grant is removed along with it.
+		 * \param sub the subject
+		 * \param res the resource
+		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
+		 */
+		std::unique_ptr<resources::resource<R>> try_pop(const subjects::subject<S>& sub, std::unique_ptr<resources::resource<R>> res) {
+			const S* key = sub.try_get_id();
+			if(!key) {
+				return nullptr;
+			}
+			const S& id = *key;
+			const size_t uuid = res.get()->get_uuid();
+			const size_t index = shard_index(id);
+			collect_ready();
+			std::lock_guard<std::mutex> lock(m_shards[index].mutex);
+			const std::pair<grant*, std::uint64_t> removal = remove_grant(index, id, uuid);
+			if(!removal.first) {
+				return nullptr;
+			}
+			std::unique_ptr<resources::resource<R>> uptr = std::move(removal.first->resource);
+			reclaim(index, uuid, removal.second);
+			return uptr;
+		}
+		/**
+		 * Tryies to pop the resource from the specified subject, the grant itself stays in place.
+		 * \param sub the subject
+		 * \param uuid the uuid of the specified resource
+		 * @returns `std::unique_ptr<resources::resource<R>>` returns the specified resourse if it exists, otherwise nullptr
+		 */
+		std::unique_ptr<resources::resource<R>> try_pop(const subjects::subject<S>& sub, const size_t uuid) {
+			const S* key = sub.try_get_id();
+			if(!key) {
+				return nullptr;
+			}
+			const S& id = *key;
+			collect_ready();
+			std::lock_guard<std::mutex> lock(shard_of(id).mutex);
+			// The resources are accessed by the writers of the owning shard only.
+			grant* g = find_grant(id, uuid);
+			return g ? std::move(g->resource) : nullptr;
+		}
+		/**
+		 * Gets the size of access list.
+		 * @returns `size_t` the number of subjects
+		 */
+		size_t size() const noexcept {
+			return m_size.load(std::memory_order_relaxed);
+		}
+};
+}
+}
+
+#endif // __CONCURRENT_ACL_HPP__
@@ -0,0 +1,190 @@
+#ifndef __EPOCH_HPP__
+#define __EPOCH_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+/// file: epoch.hpp
+
+namespace libs {
+	namespace concurrency {
+
+/**
+ * @brief Epoch based memory reclamation.
+ *
+ * Readers announce the epoch they have entered in a per-thread record and never wait for anybody.
+ * Writers unlink an object first, then retire it, the object is deleted once every reader which
+ * could still see it has left its critical section.
+ */
+class epoch_domain {
+	private:
+		struct alignas(64) record {
+			std::atomic<std::uint64_t> epoch{0};
+			std::atomic<bool> in_use{false};
+			std::uint32_t nesting{};
+			record* next{nullptr};
+		};
+		struct retired {
+			void* ptr;
+			void (*deleter)(void*);
+			std::uint64_t epoch;
+		};
+		static constexpr size_t reclaim_threshold = 64;
+		std::atomic<std::uint64_t> m_epoch{1};
+		std::atomic<record*> m_records{nullptr};
+		std::mutex m_retired_mutex;
+		std::vector<retired> m_retired;
+		record* acquire_record() {
+			for(record* r = m_records.load(std::memory_order_acquire); r; r = r->next) {
+				bool expected = false;
+				if(!r->in_use.load(std::memory_order_relaxed) &&
+						r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					return r;
+				}
+			}
+			record* r = new record();
+			r->in_use.store(true, std::memory_order_relaxed);
+			record* head = m_records.load(std::memory_order_relaxed);
+			do {
+				r->next = head;
+			} while(!m_records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+			return r;
+		}
+		// Releases the calling thread's record when the thread exits.
+		struct thread_record {
+			record* rec{nullptr};
+			~thread_record() {
+				if(rec) {
+					rec->in_use.store(false, std::memory_order_release);
+				}
+			}
+		};
+		record& local_record() {
+			static thread_local thread_record local;
+			if(!local.rec) {
+				local.rec = acquire_record();
+			}
+			return *local.rec;
+		}
+		std::uint64_t min_active_epoch() const noexcept {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+			for(record* r = m_records.load(std::memory_order_acquire); r; r = r->next) {
+				const std::uint64_t e = r->epoch.load(std::memory_order_acquire);
+				if(e != 0 && e < min) {
+					min = e;
+				}
+			}
+			return min;
+		}
+		epoch_domain() = default;
+	public:
+		/**
+		 * The copy constructor deleted
+		 */
+		epoch_domain(const epoch_domain&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		epoch_domain& operator=(const epoch_domain&) = delete;
+		~epoch_domain() {
+			for(retired& r : m_retired) {
+				r.deleter(r.ptr);
+			}
+			record* r = m_records.load(std::memory_order_relaxed);
+			while(r) {
+				record* next = r->next;
+				delete r;
+				r = next;
+			}
+		}
+		/**
+		 * Gets the process wide domain
+		 * @returns `epoch_domain&`
+		 */
+		static epoch_domain& global() {
+			static epoch_domain domain;
+			return domain;
+		}
+		/**
+		 * @brief Keeps the calling thread inside a read critical section, the objects it loads are not deleted meanwhile.
+		 */
+		class guard {
+			private:
+				record& m_record;
+			public:
+				/**
+				 * Enters the critical section
+				 * \param domain the domain of the protected objects
+				 */
+				explicit guard(epoch_domain& domain = epoch_domain::global()): m_record(domain.local_record()) {
+					if(m_record.nesting++ == 0) {
+						m_record.epoch.store(domain.m_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+					}
+				}
+				/**
+				 * The copy constructor deleted
+				 */
+				guard(const guard&) = delete;
+				/**
+				 * The assignement operator deleted
+				 */
+				guard& operator=(const guard&) = delete;
+				/**
+				 * Leaves the critical section
+				 */
+				~guard() {
+					if(--m_record.nesting == 0) {
+						m_record.epoch.store(0, std::memory_order_release);
+					}
+				}
+		};
+		/**
+		 * Retires the already unlinked object, it is deleted once no reader could reach it
+		 * \param ptr the object
+		 * \tparam T the type of the object
+		 * @returns `void`
+		 */
+		template <typename T>
+		void retire(T* ptr) {
+			if(!ptr) {
+				return;
+			}
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_acq_rel);
+			std::lock_guard<std::mutex> lock(m_retired_mutex);
+			m_retired.push_back(retired{ptr, [](void* p) { delete static_cast<T*>(p); }, epoch});
+			if(m_retired.size() >= reclaim_threshold) {
+				reclaim_locked();
+			}
+		}
+		/**
+		 * Deletes the retired objects which are not reachable by any reader anymore
+		 * @returns `void`
+		 */
+		void reclaim() {
+			std::lock_guard<std::mutex> lock(m_retired_mutex);
+			reclaim_locked();
+		}
+	private:
+		void reclaim_locked() {
+			const std::uint64_t min = min_active_epoch();
+			size_t kept = 0;
+			for(size_t i = 0; i < m_retired.size(); ++i) {
+				if(m_retired[i].epoch < min) {
+					m_retired[i].deleter(m_retired[i].ptr);
+				} else {
+					m_retired[kept++] = m_retired[i];
+				}
+			}
+			m_retired.resize(kept);
+		}
+};
+}
+}
+
+#endif // __EPOCH_HPP__
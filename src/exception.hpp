@@ -1,12 +1,23 @@
 #ifndef __EXCEPTION_HPP__
 #define __EXCEPTION_HPP__
 
+#include <cstdio>
+#include <cstdlib>
 #include <exception>
 #include <memory>
 #include <string>
 
 #include "exception"
 
+/// The errors are raised as `custom_exception` unless `ACL_NO_EXCEPTIONS` is defined or the exceptions are
+/// disabled, e.g. by `-fno-exceptions`, then raising prints the message and aborts. The `try_*` calls of the
+/// acl report their errors as `status::code` and never raise, so they are the API of such builds.
+#if defined(ACL_NO_EXCEPTIONS) || !(defined(__cpp_exceptions) || defined(__EXCEPTIONS))
+#define ACL_EXCEPTIONS 0
+#else
+#define ACL_EXCEPTIONS 1
+#endif
+
 namespace libs {
 	namespace exception {
 /**
@@ -31,6 +42,20 @@ class custom_exception: public std::exception {
 			return m_msg.get()->c_str();
 		}
 };
+
+/**
+ * Raises the error, i.e. throws it as `custom_exception` or aborts with it where the exceptions are off
+ * \param msg the error message
+ * @returns `void` never
+ */
+[[noreturn]] inline void raise(const char* msg) {
+#if ACL_EXCEPTIONS
+	throw custom_exception(msg);
+#else
+	std::fprintf(stderr, "%s\n", msg);
+	std::abort();
+#endif
+}
 }
 }
 
@@ -0,0 +1,412 @@
+#ifndef __FROZEN_ACL_HPP__
+#define __FROZEN_ACL_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <vector>
+
+#include "access_level.hpp"
+#include "exception.hpp"
+#include "subject.hpp"
+#include "subject_table.hpp"
+
+/// file: frozen_acl.hpp
+
+namespace libs {
+	namespace frozen {
+
+/// The index value which marks a missing subject.
+constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+/**
+ * @brief An immutable policy: the subjects are placed by a minimal perfect hash and the grants are packed by uuid.
+ *
+ * The subject hashes are split into buckets of about four, every bucket keeps the seed which places its
+ * subjects into distinct free slots, so a lookup is two hashes and a single key comparison. The grants
+ * are a flat array indexed by the uuid, the role memberships are the sorted transitive roles of every
+ * subject. Nothing is mutated after the build, so the frozen acl is shared across threads as is.
+ * The resources stay with the mutable acl, since they are consumed by the access.
+ * \tparam S the type of data stored in subject
+ */
+template <typename S>
+class frozen_acl {
+	public:
+		using view_type = typename subjects::key_traits<S>::view_type;
+		class builder;
+	private:
+		struct entry {
+			std::uint32_t subject;
+			enums::rights rights;
+			bool expiring;
+		};
+		struct expiry {
+			std::uint64_t uuid;
+			std::int64_t expires;
+			enums::rights expiring;
+			bool grant;
+		};
+		std::pmr::vector<std::uint32_t> m_seeds;
+		std::pmr::vector<S> m_ids;
+		std::pmr::vector<entry> m_entries;
+		std::pmr::vector<std::uint32_t> m_role_offsets;
+		std::pmr::vector<std::uint32_t> m_roles;
+		std::pmr::vector<expiry> m_expiries;
+		size_t m_first_uuid{1};
+		size_t m_size{};
+		static std::uint64_t mix(std::uint64_t x) noexcept {
+			x ^= x >> 30;
+			x *= 0xbf58476d1ce4e5b9ull;
+			x ^= x >> 27;
+			x *= 0x94d049bb133111ebull;
+			return x ^ (x >> 31);
+		}
+		// Maps the hash onto [0, n) without a division.
+		static std::uint64_t reduce(const std::uint64_t x, const std::uint64_t n) noexcept {
+#if defined(__SIZEOF_INT128__)
+			return static_cast<std::uint64_t>((static_cast<unsigned __int128>(x) * n) >> 64);
+#else
+			return x % n;
+#endif
+		}
+		static std::uint64_t hash(const view_type& id) noexcept {
+			return mix(std::hash<view_type>()(id));
+		}
+		static std::uint64_t place(const std::uint64_t h, const std::uint32_t seed, const std::uint64_t n) noexcept {
+			return reduce(mix(h ^ mix(seed + 0x9e3779b97f4a7c15ull)), n);
+		}
+		const entry* find_entry(const size_t uuid) const noexcept {
+			const size_t offset = uuid - m_first_uuid;
+			return uuid >= m_first_uuid && offset < m_entries.size() && m_entries[offset].subject != npos ? &m_entries[offset] : nullptr;
+		}
+		enums::rights effective_rights(const size_t uuid, const entry& e) const noexcept {
+			if(!e.expiring) {
+				return e.rights;
+			}
+			auto it = std::lower_bound(m_expiries.begin(), m_expiries.end(), uuid, [](const expiry& x, const size_t u) {
+				return x.uuid < u;
+			});
+			const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::system_clock::now().time_since_epoch()).count();
+			if(it == m_expiries.end() || it->uuid != uuid || it->expires > now) {
+				return e.rights;
+			}
+			return it->grant ? enums::rights::none : e.rights & ~it->expiring;
+		}
+		bool applies(const std::uint32_t subject, const std::uint32_t owner) const noexcept {
+			if(subject == owner) {
+				return true;
+			}
+			if(subject == npos) {
+				return false;
+			}
+			auto first = m_roles.begin() + m_role_offsets[subject];
+			auto last = m_roles.begin() + m_role_offsets[subject + 1];
+			return std::binary_search(first, last, owner);
+		}
+		explicit frozen_acl(std::pmr::memory_resource* mr):
+			m_seeds(mr), m_ids(mr), m_entries(mr), m_role_offsets(mr), m_roles(mr), m_expiries(mr) {}
+	public:
+		/**
+		 * Finds the slot of the subject
+		 * \param id the id of the subject or its view
+		 * @returns `std::uint32_t` the slot or `npos` if the subject is not in the policy
+		 */
+		std::uint32_t find(const view_type& id) const noexcept {
+			// Finds the slot in O(1).
+			if(m_ids.empty()) {
+				return npos;
+			}
+			const std::uint64_t h = hash(id);
+			const std::uint32_t slot = static_cast<std::uint32_t>(place(h, m_seeds[reduce(h, m_seeds.size())], m_ids.size()));
+			return subjects::key_traits<S>::view(m_ids[slot]) == id ? slot : npos;
+		}
+		/**
+		 * Checks whether the specified subject exists.
+		 * \param sub the subject
+		 * @returns `bool`
+		 */
+		bool has_subject(const subjects::subject<S>& sub) const noexcept {
+			return sub.is_valid() && find(subjects::key_traits<S>::view(sub.get_id())) != npos;
+		}
+		/**
+		 * Checks whether the specified resource exists within the specified subject.
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * @returns `bool`
+		 */
+		bool has_resource(const subjects::subject<S>& sub, const size_t uuid) const noexcept {
+			// Checks the resource in O(1).
+			const entry* e = find_entry(uuid);
+			return e && sub.is_valid() && e->subject == find(subjects::key_traits<S>::view(sub.get_id()));
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject or one of its roles
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool`
+		 */
+		bool is_allowed(const subjects::subject<S>& sub, const size_t uuid, enums::rights required = enums::rights::none) const noexcept {
+			return sub.is_valid() && is_allowed(subjects::key_traits<S>::view(sub.get_id()), uuid, required);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the subject of the id or one of its roles
+		 * \param id the id of the subject or its view
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool`
+		 */
+		bool is_allowed(const view_type& id, const size_t uuid, enums::rights required = enums::rights::none) const noexcept {
+			// Checks the access in O(1), plus O(log r) if the subject has r roles and the grant is not its own.
+			const entry* e = find_entry(uuid);
+			return e && enums::access_level(effective_rights(uuid, *e)).permits(required) && applies(find(id), e->subject);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within its owning subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool`
+		 */
+		bool is_allowed(const size_t uuid, enums::rights required = enums::rights::none) const noexcept {
+			const entry* e = find_entry(uuid);
+			return e && enums::access_level(effective_rights(uuid, *e)).permits(required);
+		}
+		/**
+		 * Checks whether the subject belongs to the role, directly or through the nested roles
+		 * \param member the member subject
+		 * \param role the role subject
+		 * @returns `bool`
+		 */
+		bool is_member(const subjects::subject<S>& member, const subjects::subject<S>& role) const noexcept {
+			if(!member.is_valid() || !role.is_valid()) {
+				return false;
+			}
+			const std::uint32_t m = find(subjects::key_traits<S>::view(member.get_id()));
+			const std::uint32_t r = find(subjects::key_traits<S>::view(role.get_id()));
+			return m != npos && r != npos && m != r && applies(m, r);
+		}
+		/**
+		 * Gets the number of the bytes held by the policy, the heap of the ids excluded
+		 * @returns `size_t`
+		 */
+		size_t memory_usage() const noexcept {
+			return sizeof(*this) + m_seeds.capacity() * sizeof(std::uint32_t) + m_ids.capacity() * sizeof(S) +
+				m_entries.capacity() * sizeof(entry) + m_role_offsets.capacity() * sizeof(std::uint32_t) +
+				m_roles.capacity() * sizeof(std::uint32_t) + m_expiries.capacity() * sizeof(expiry);
+		}
+		/**
+		 * Gets the number of the grants
+		 * @returns `size_t`
+		 */
+		size_t grants() const noexcept {
+			return m_size;
+		}
+		/**
+		 * Gets the size of the policy.
+		 * @returns `size_t` the number of subjects
+		 */
+		size_t size() const noexcept {
+			return m_ids.size();
+		}
+};
+
+/**
+ * @brief Collects the subjects, grants, memberships and expiries and builds the frozen acl out of them.
+ * \tparam S the type of data stored in subject
+ */
+template <typename S>
+class frozen_acl<S>::builder {
+	private:
+		struct pending_entry {
+			std::uint64_t uuid;
+			std::uint32_t subject;
+			enums::rights rights;
+		};
+		std::vector<S> m_ids;
+		std::vector<pending_entry> m_entries;
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> m_memberships;
+		std::vector<expiry> m_expiries;
+		// Finds the seeds which place every bucket of the hashes into the free slots, returns the slot of every hash.
+		static std::vector<std::uint32_t> place_all(const std::vector<std::uint64_t>& hashes, std::pmr::vector<std::uint32_t>& seeds) {
+			const size_t n = hashes.size();
+			const size_t buckets = (n + 3) / 4;
+			seeds.assign(buckets, 0);
+			std::vector<std::uint32_t> offsets(buckets + 1);
+			for(const std::uint64_t h : hashes) {
+				++offsets[reduce(h, buckets) + 1];
+			}
+			for(size_t b = 0; b < buckets; ++b) {
+				offsets[b + 1] += offsets[b];
+			}
+			std::vector<std::uint32_t> keys(n);
+			std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for(std::uint32_t i = 0; i < n; ++i) {
+				keys[fill[reduce(hashes[i], buckets)]++] = i;
+			}
+			// The largest buckets are placed first, while most of the slots are still free.
+			std::vector<std::uint32_t> order(buckets);
+			for(std::uint32_t b = 0; b < buckets; ++b) {
+				order[b] = b;
+			}
+			std::stable_sort(order.begin(), order.end(), [&offsets](std::uint32_t lhs, std::uint32_t rhs) {
+				return offsets[lhs + 1] - offsets[lhs] > offsets[rhs + 1] - offsets[rhs];
+			});
+			std::vector<bool> taken(n);
+			std::vector<std::uint32_t> slots(n);
+			std::vector<std::uint32_t> trial;
+			for(const std::uint32_t b : order) {
+				const std::uint32_t first = offsets[b];
+				const std::uint32_t last = offsets[b + 1];
+				for(std::uint32_t i = first + 1; i < last; ++i) {
+					for(std::uint32_t j = first; j < i; ++j) {
+						if(hashes[keys[i]] == hashes[keys[j]]) {
+							libs::exception::raise("Error: The subject hashes collide");
+						}
+					}
+				}
+				for(std::uint32_t seed = 0;; ++seed) {
+					trial.clear();
+					bool free = true;
+					for(std::uint32_t i = first; i < last && free; ++i) {
+						const std::uint32_t slot = static_cast<std::uint32_t>(place(hashes[keys[i]], seed, n));
+						free = !taken[slot] && std::find(trial.begin(), trial.end(), slot) == trial.end();
+						trial.push_back(slot);
+					}
+					if(free) {
+						seeds[b] = seed;
+						for(std::uint32_t i = first; i < last; ++i) {
+							slots[keys[i]] = trial[i - first];
+							taken[trial[i - first]] = true;
+						}
+						break;
+					}
+				}
+			}
+			return slots;
+		}
+	public:
+		/**
+		 * Adds a subject
+		 * \param id the id of the subject, it has to be distinct from the added ones
+		 * @returns `std::uint32_t` the index of the subject within the builder
+		 */
+		std::uint32_t add_subject(const S& id) {
+			m_ids.push_back(id);
+			return static_cast<std::uint32_t>(m_ids.size() - 1);
+		}
+		/**
+		 * Adds a grant
+		 * \param uuid the uuid of the resource
+		 * \param subject the index returned by `add_subject`
+		 * \param rights the granted rights
+		 * @returns `void`
+		 */
+		void add_entry(const std::uint64_t uuid, const std::uint32_t subject, const enums::rights rights) {
+			m_entries.push_back(pending_entry{uuid, subject, rights});
+		}
+		/**
+		 * Adds a direct role membership
+		 * \param role the index of the role returned by `add_subject`
+		 * \param member the index of the member returned by `add_subject`
+		 * @returns `void`
+		 */
+		void add_membership(const std::uint32_t role, const std::uint32_t member) {
+			m_memberships.emplace_back(member, role);
+		}
+		/**
+		 * Adds an expiry of a grant
+		 * \param uuid the uuid of the resource
+		 * \param expires the expiry time in nanoseconds since the epoch of the system clock
+		 * \param expiring the rights which lapse at the expiry
+		 * \param grant whether the whole grant expires
+		 * @returns `void`
+		 */
+		void add_expiry(const std::uint64_t uuid, const std::int64_t expires, const enums::rights expiring, const bool grant) {
+			m_expiries.push_back(expiry{uuid, expires, expiring, grant});
+		}
+		/**
+		 * Builds the frozen acl
+		 * \param mr the memory resource of the frozen acl, by default the default one
+		 * @returns `frozen_acl<S>`
+		 */
+		frozen_acl<S> build(std::pmr::memory_resource* mr = std::pmr::get_default_resource()) const {
+			// Builds the policy in O(n) expected, plus O(m log m) for the m roles of the subjects.
+			frozen_acl<S> f(mr);
+			const size_t n = m_ids.size();
+			std::vector<std::uint64_t> hashes(n);
+			for(size_t i = 0; i < n; ++i) {
+				hashes[i] = hash(subjects::key_traits<S>::view(m_ids[i]));
+			}
+			const std::vector<std::uint32_t> slots = n ? place_all(hashes, f.m_seeds) : std::vector<std::uint32_t>();
+			f.m_ids.resize(n);
+			for(size_t i = 0; i < n; ++i) {
+				f.m_ids[slots[i]] = m_ids[i];
+			}
+
+			// The transitive roles of every subject, by the slots.
+			std::vector<std::vector<std::uint32_t>> direct(n);
+			for(const std::pair<std::uint32_t, std::uint32_t>& m : m_memberships) {
+				direct[m.first].push_back(m.second);
+			}
+			std::vector<std::vector<std::uint32_t>> closures(n);
+			std::vector<bool> seen(n);
+			std::vector<std::uint32_t> visited;
+			for(std::uint32_t i = 0; i < n; ++i) {
+				std::vector<std::uint32_t> pending(direct[i]);
+				visited.clear();
+				while(!pending.empty()) {
+					const std::uint32_t role = pending.back();
+					pending.pop_back();
+					if(!seen[role]) {
+						seen[role] = true;
+						visited.push_back(role);
+						pending.insert(pending.end(), direct[role].begin(), direct[role].end());
+					}
+				}
+				std::vector<std::uint32_t>& closure = closures[slots[i]];
+				for(const std::uint32_t role : visited) {
+					seen[role] = false;
+					closure.push_back(slots[role]);
+				}
+				std::sort(closure.begin(), closure.end());
+			}
+			f.m_role_offsets.resize(n + 1);
+			for(size_t s = 0; s < n; ++s) {
+				f.m_role_offsets[s + 1] = f.m_role_offsets[s] + static_cast<std::uint32_t>(closures[s].size());
+				f.m_roles.insert(f.m_roles.end(), closures[s].begin(), closures[s].end());
+			}
+
+			std::vector<expiry> expiries(m_expiries);
+			std::sort(expiries.begin(), expiries.end(), [](const expiry& lhs, const expiry& rhs) {
+				return lhs.uuid < rhs.uuid;
+			});
+			f.m_expiries.assign(expiries.begin(), expiries.end());
+			if(!m_entries.empty()) {
+				std::uint64_t first = m_entries.front().uuid;
+				std::uint64_t last = first;
+				for(const pending_entry& e : m_entries) {
+					first = std::min(first, e.uuid);
+					last = std::max(last, e.uuid);
+				}
+				f.m_first_uuid = first;
+				f.m_entries.assign(last - first + 1, entry{npos, enums::rights::none, false});
+				for(const pending_entry& e : m_entries) {
+					f.m_entries[e.uuid - first] = entry{slots[e.subject], e.rights, false};
+				}
+				for(const expiry& x : expiries) {
+					if(x.uuid >= first && x.uuid <= last) {
+						f.m_entries[x.uuid - first].expiring = true;
+					}
+				}
+			}
+			f.m_size = m_entries.size();
+			return f;
+		}
+};
+}
+}
+
+#endif // __FROZEN_ACL_HPP__
@@ -0,0 +1,328 @@
+#ifndef __JOURNAL_HPP__
+#define __JOURNAL_HPP__
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define ACL_JOURNAL_FSYNC 1
+#endif
+
+#include "exception.hpp"
+#include "snapshot.hpp"
+
+/// file: journal.hpp
+
+namespace libs {
+	namespace journal {
+
+/**
+ * @brief Enumerates the journaled mutations.
+ */
+enum class op : std::uint8_t {
+	add = 1,
+	allow = 2,
+	forbid = 3,
+	remove_subject = 4,
+	remove_grant = 5,
+	pop = 6,
+	add_member = 7,
+	remove_member = 8,
+	expire = 9
+};
+
+/**
+ * Appends the raw bytes of the value to the payload
+ * \param out the payload
+ * \param value the trivially copyable value
+ * @returns `void`
+ */
+template <typename T>
+void put(std::string& out, const T& value) {
+	static_assert(std::is_trivially_copyable<T>::value, "The value must be trivially copyable");
+	out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * Appends the length prefixed bytes to the payload
+ * \param out the payload
+ * \param bytes the bytes
+ * @returns `void`
+ */
+inline void put_bytes(std::string& out, std::string_view bytes) {
+	put(out, static_cast<std::uint32_t>(bytes.size()));
+	out.append(bytes.data(), bytes.size());
+}
+
+/**
+ * @brief Consumes the values of a record payload in the order they were put.
+ */
+class payload {
+	private:
+		std::string_view m_in;
+	public:
+		explicit payload(std::string_view in) noexcept: m_in(in) {}
+		template <typename T>
+		bool get(T& value) noexcept {
+			if(m_in.size() < sizeof(T)) {
+				return false;
+			}
+			std::memcpy(&value, m_in.data(), sizeof(T));
+			m_in.remove_prefix(sizeof(T));
+			return true;
+		}
+		bool get_bytes(std::string_view& bytes) noexcept {
+			std::uint32_t size = 0;
+			if(!get(size) || m_in.size() < size) {
+				return false;
+			}
+			bytes = m_in.substr(0, size);
+			m_in.remove_prefix(size);
+			return true;
+		}
+};
+
+/**
+ * @brief Reads the records of a journal file up to the end or the first torn or corrupted record.
+ */
+class reader {
+	private:
+		snapshot::mapped_file m_file;
+		size_t m_pos{};
+	public:
+		/**
+		 * Opens the journal file
+		 * \param path the path of the file
+		 */
+		explicit reader(const std::string& path): m_file(path) {}
+		/**
+		 * Reads the next record
+		 * \param o receives the mutation
+		 * \param data receives the payload
+		 * @returns `bool` false at the end of the valid records
+		 */
+		bool next(op& o, std::string_view& data) noexcept {
+			std::uint32_t size = 0;
+			std::uint32_t sum = 0;
+			const size_t head = sizeof(size) + sizeof(sum);
+			if(m_file.size() - m_pos < head) {
+				return false;
+			}
+			std::memcpy(&size, m_file.data() + m_pos, sizeof(size));
+			std::memcpy(&sum, m_file.data() + m_pos + sizeof(size), sizeof(sum));
+			if(size == 0 || m_file.size() - m_pos - head < size) {
+				return false;
+			}
+			const char* record = m_file.data() + m_pos + head;
+			if(static_cast<std::uint32_t>(snapshot::checksum(record, size)) != sum) {
+				return false;
+			}
+			o = static_cast<op>(record[0]);
+			data = std::string_view(record + 1, size - 1);
+			m_pos += head + size;
+			return true;
+		}
+		/**
+		 * Gets the length of the valid records read so far, once `next` returned false the rest is torn
+		 * @returns `size_t`
+		 */
+		size_t valid_size() const noexcept {
+			return m_pos;
+		}
+};
+
+/**
+ * @brief Appends the mutation records to the journal file and makes them durable with group commit.
+ *
+ * `append` only buffers the record and returns its sequence number. `commit` waits until the record
+ * is durable: the first committer becomes the leader and writes and syncs everything appended so
+ * far, the committers arriving meanwhile wait for it and are usually covered by the same sync.
+ * The record layout is `[u32 size][u32 checksum][u8 op][payload]`, a torn tail is ignored on replay
+ * and cut off by the writer before it appends, so the records committed after a crash stay readable.
+ */
+class writer {
+	private:
+		std::string m_path;
+		std::FILE* m_file{nullptr};
+		bool m_sync{true};
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::string m_pending;
+		std::uint64_t m_appended{0};
+		std::uint64_t m_durable{0};
+		std::uint64_t m_syncs{0};
+		bool m_flushing{false};
+		// The error of the write which lost its batch, no later record is made durable after it.
+		const char* m_error{nullptr};
+		// Writes the batch out, returns the error message or nullptr.
+		const char* write_out(const std::string& batch) noexcept {
+			if(!batch.empty() && std::fwrite(batch.data(), 1, batch.size(), m_file) != batch.size()) {
+				return "Error: Could not write the journal";
+			}
+			if(std::fflush(m_file) != 0) {
+				return "Error: Could not flush the journal";
+			}
+#ifdef ACL_JOURNAL_FSYNC
+			if(m_sync && ::fsync(::fileno(m_file)) != 0) {
+				return "Error: Could not sync the journal";
+			}
+#endif
+			return nullptr;
+		}
+	public:
+		/**
+		 * Opens the journal file for appending
+		 * \param path the path of the file
+		 * \param sync whether `commit` syncs the file to the disk or only hands it over to the os
+		 */
+		explicit writer(const std::string& path, bool sync = true): m_path(path), m_sync(sync) {
+			// A missing file is created by the open, the errors of probing it are ignored.
+			std::error_code probe;
+			std::error_code ec;
+			bool torn = false;
+			if(std::filesystem::is_regular_file(path, probe) && std::filesystem::file_size(path, probe) != 0) {
+				reader r(path);
+				op o;
+				std::string_view data;
+				while(r.next(o, data)) {}
+				torn = r.valid_size() != std::filesystem::file_size(path, probe);
+				if(torn) {
+					std::filesystem::resize_file(path, r.valid_size(), ec);
+				}
+			}
+			m_file = ec ? nullptr : std::fopen(path.c_str(), "ab");
+			if(!m_file || (torn && write_out(std::string()))) {
+				if(m_file) {
+					std::fclose(m_file);
+				}
+				std::string msg = std::string("Error: Could not open the journal: ") + path;
+				libs::exception::raise(msg.c_str());
+			}
+		}
+		/**
+		 * The copy constructor deleted
+		 */
+		writer(const writer&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		writer& operator=(const writer&) = delete;
+		/**
+		 * Commits the pending records and closes the file
+		 */
+		~writer() {
+			// The error is dropped, there is no one left to report it to.
+			if(!m_error) {
+				write_out(m_pending);
+			}
+			std::fclose(m_file);
+		}
+		/**
+		 * Buffers the record
+		 * \param o the mutation
+		 * \param data the payload of the record
+		 * @returns `std::uint64_t` the sequence number of the record
+		 */
+		std::uint64_t append(const op o, std::string_view data) {
+			const char code = static_cast<char>(o);
+			std::uint64_t sum = snapshot::checksum(&code, 1);
+			sum = snapshot::checksum(data.data(), data.size(), sum);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			put(m_pending, static_cast<std::uint32_t>(data.size() + 1));
+			put(m_pending, static_cast<std::uint32_t>(sum));
+			m_pending.push_back(code);
+			m_pending.append(data.data(), data.size());
+			return ++m_appended;
+		}
+		/**
+		 * Waits until the record and all the preceding ones are durable, fails once a write has failed
+		 * \param lsn the sequence number of the record
+		 * @returns `void`
+		 */
+		void commit(const std::uint64_t lsn) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while(m_durable < lsn) {
+				if(m_error) {
+					libs::exception::raise(m_error);
+				}
+				if(m_flushing) {
+					m_cv.wait(lock);
+					continue;
+				}
+				m_flushing = true;
+				std::string batch;
+				batch.swap(m_pending);
+				const std::uint64_t upto = m_appended;
+				lock.unlock();
+				const char* error = write_out(batch);
+				lock.lock();
+				m_flushing = false;
+				if(error) {
+					// The batch is lost and the file might end in a part of it, so the writer fails
+					// every commit from now on and the followers waiting for the batch get the error too.
+					m_error = error;
+					m_cv.notify_all();
+					libs::exception::raise(error);
+				}
+				m_durable = upto;
+				++m_syncs;
+				m_cv.notify_all();
+			}
+		}
+		/**
+		 * Waits until all the appended records are durable
+		 * @returns `void`
+		 */
+		void commit() {
+			commit(last_lsn());
+		}
+		/**
+		 * Starts the journal anew, all the records appended so far must be in a snapshot saved already.
+		 * The writer failed by a write is usable again afterwards.
+		 * @returns `void`
+		 */
+		void reset() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while(m_flushing) {
+				m_cv.wait(lock);
+			}
+			std::error_code ec;
+			m_pending.clear();
+			std::filesystem::resize_file(m_path, 0, ec);
+			if(ec || write_out(m_pending)) {
+				libs::exception::raise("Error: Could not reset the journal");
+			}
+			m_durable = m_appended;
+			m_error = nullptr;
+			m_cv.notify_all();
+		}
+		/**
+		 * Gets the sequence number of the last appended record
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t last_lsn() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_appended;
+		}
+		/**
+		 * Gets the number of the writes which made records durable, each one covers a whole group
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t sync_count() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_syncs;
+		}
+};
+
+}
+}
+
+#endif // __JOURNAL_HPP__
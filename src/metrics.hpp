@@ -0,0 +1,226 @@
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/// file: metrics.hpp
+
+namespace libs {
+	namespace metrics {
+
+/// The metrics are collected only if `ACL_ENABLE_METRICS` is defined, otherwise the recording compiles to nothing.
+#ifdef ACL_ENABLE_METRICS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+/**
+ * @brief Enumerates the operation counters.
+ */
+enum class counter : size_t {
+	is_allowed_hit,
+	is_allowed_miss,
+	has_subject_hit,
+	has_subject_miss,
+	has_resource_hit,
+	has_resource_miss,
+	add,
+	remove_subject,
+	remove_grant,
+	pop_hit,
+	pop_miss,
+	// The subject map rehashed while interning.
+	subject_rehash,
+	// The slot array reallocated while adding.
+	store_growth,
+	count
+};
+
+/**
+ * @brief Enumerates the operations with a latency histogram.
+ */
+enum class op : size_t {
+	is_allowed,
+	has_subject,
+	has_resource,
+	add,
+	remove,
+	try_pop,
+	count
+};
+
+/// The number of the histogram buckets, the bucket b counts the latencies in [2^(b-1), 2^b) nanoseconds.
+constexpr size_t histogram_buckets = 64;
+
+/**
+ * @brief A copy of a latency histogram.
+ */
+struct histogram_snapshot {
+	std::uint64_t buckets[histogram_buckets]{};
+	/**
+	 * Gets the number of the recorded latencies
+	 * @returns `std::uint64_t`
+	 */
+	std::uint64_t count() const noexcept {
+		std::uint64_t total = 0;
+		for(const std::uint64_t b : buckets) {
+			total += b;
+		}
+		return total;
+	}
+	/**
+	 * Gets the upper bound of the percentile
+	 * \param p the percentile in [0, 1]
+	 * @returns `std::uint64_t` the upper bound of its bucket in nanoseconds, 0 if nothing is recorded
+	 */
+	std::uint64_t percentile(const double p) const noexcept {
+		const std::uint64_t total = count();
+		std::uint64_t seen = 0;
+		for(size_t b = 0; b < histogram_buckets; ++b) {
+			seen += buckets[b];
+			if(total && seen >= p * total) {
+				return b < 63 ? std::uint64_t(1) << b : ~std::uint64_t(0);
+			}
+		}
+		return 0;
+	}
+};
+
+/**
+ * @brief The lock-free log2 scale latency histogram.
+ */
+class histogram {
+	private:
+		std::atomic<std::uint64_t> m_buckets[histogram_buckets]{};
+	public:
+		/**
+		 * Records the latency
+		 * \param ns the latency in nanoseconds
+		 * @returns `void`
+		 */
+		void record(const std::uint64_t ns) noexcept {
+			size_t bucket = 0;
+			for(std::uint64_t v = ns; v; v >>= 1) {
+				++bucket;
+			}
+			m_buckets[bucket < histogram_buckets ? bucket : histogram_buckets - 1].fetch_add(1, std::memory_order_relaxed);
+		}
+		/**
+		 * Copies the buckets
+		 * \param out the copy
+		 * @returns `void`
+		 */
+		void read(histogram_snapshot& out) const noexcept {
+			for(size_t b = 0; b < histogram_buckets; ++b) {
+				out.buckets[b] = m_buckets[b].load(std::memory_order_relaxed);
+			}
+		}
+};
+
+/**
+ * @brief The sizes of the internal tables.
+ */
+struct table_stats {
+	size_t subjects{};
+	size_t interned_subjects{};
+	size_t subject_buckets{};
+	float subject_load_factor{};
+	size_t grants{};
+	size_t slot_capacity{};
+	size_t index_size{};
+};
+
+/**
+ * @brief A scraped copy of the metrics.
+ */
+struct snapshot {
+	bool enabled{};
+	std::uint64_t counters[static_cast<size_t>(counter::count)]{};
+	histogram_snapshot latencies[static_cast<size_t>(op::count)]{};
+	table_stats tables;
+	std::uint64_t get(const counter c) const noexcept {
+		return counters[static_cast<size_t>(c)];
+	}
+	const histogram_snapshot& latency(const op o) const noexcept {
+		return latencies[static_cast<size_t>(o)];
+	}
+};
+
+/**
+ * @brief Collects the counters and the latencies, they could be read concurrently with the recording.
+ * \tparam Enabled whether the metrics are collected, the disabled registry is empty and records nothing
+ */
+template <bool Enabled = enabled>
+class registry {
+	private:
+		std::atomic<std::uint64_t> m_counters[static_cast<size_t>(counter::count)]{};
+		histogram m_latencies[static_cast<size_t>(op::count)];
+	public:
+		using tick = std::chrono::steady_clock::time_point;
+		void count(const counter c, const std::uint64_t n = 1) noexcept {
+			m_counters[static_cast<size_t>(c)].fetch_add(n, std::memory_order_relaxed);
+		}
+		tick start() const noexcept {
+			return std::chrono::steady_clock::now();
+		}
+		void record(const op o, const tick started) noexcept {
+			const auto elapsed = std::chrono::steady_clock::now() - started;
+			m_latencies[static_cast<size_t>(o)].record(
+					static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+		}
+		void read(snapshot& out) const noexcept {
+			out.enabled = true;
+			for(size_t c = 0; c < static_cast<size_t>(counter::count); ++c) {
+				out.counters[c] = m_counters[c].load(std::memory_order_relaxed);
+			}
+			for(size_t o = 0; o < static_cast<size_t>(op::count); ++o) {
+				m_latencies[o].read(out.latencies[o]);
+			}
+		}
+};
+
+template <>
+class registry<false> {
+	public:
+		struct tick {};
+		void count(const counter, const std::uint64_t = 1) noexcept {}
+		tick start() const noexcept {
+			return tick{};
+		}
+		void record(const op, const tick) noexcept {}
+		void read(snapshot&) const noexcept {}
+};
+
+/**
+ * @brief Records the latency of the enclosing scope.
+ */
+template <bool Enabled = enabled>
+class scoped_timer {
+	private:
+		registry<Enabled>& m_registry;
+		const op m_op;
+		const typename registry<Enabled>::tick m_started;
+	public:
+		scoped_timer(registry<Enabled>& r, const op o) noexcept: m_registry(r), m_op(o), m_started(r.start()) {}
+		scoped_timer(const scoped_timer&) = delete;
+		scoped_timer& operator=(const scoped_timer&) = delete;
+		~scoped_timer() {
+			m_registry.record(m_op, m_started);
+		}
+};
+
+template <>
+class scoped_timer<false> {
+	public:
+		scoped_timer(registry<false>&, const op) noexcept {}
+		scoped_timer(const scoped_timer&) = delete;
+		scoped_timer& operator=(const scoped_timer&) = delete;
+};
+}
+}
+
+#endif // __METRICS_HPP__
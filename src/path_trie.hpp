@@ -0,0 +1,299 @@
+#ifndef __PATH_TRIE_HPP__
+#define __PATH_TRIE_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "access_level.hpp"
+
+/// file: path_trie.hpp
+
+namespace libs {
+	namespace paths {
+
+/**
+ * @brief A grant or a denial of the rights under a path prefix.
+ */
+struct rule {
+	std::uint32_t subject;
+	enums::rights rights;
+	bool deny;
+};
+
+/**
+ * Splits off the first non-empty component of the path
+ * \param path the path, it is advanced past the component
+ * @returns `std::string_view` the component, empty at the end of the path
+ */
+inline std::string_view next_component(std::string_view& path) noexcept {
+	while(!path.empty() && path.front() == '/') {
+		path.remove_prefix(1);
+	}
+	const size_t end = std::min(path.find('/'), path.size());
+	const std::string_view component = path.substr(0, end);
+	path.remove_prefix(end);
+	return component;
+}
+
+/**
+ * @brief Resolves the rights of the subjects under the hierarchical resource paths.
+ *
+ * The rules are attached to the path prefixes, e.g. `/data/tenant42`, and cover everything below them.
+ * The deepest prefix of the checked path which has rules applying to the subject decides, among
+ * its rules the denials override the grants. The rules are compiled into a radix trie kept in flat
+ * arrays: the nodes are laid out breadth first, so the children of a node are contiguous and sorted
+ * for a binary search, and the chains of nodes without rules are merged into a single edge.
+ */
+class path_trie {
+	private:
+		struct node {
+			std::uint32_t label_offset;
+			std::uint32_t label_size;
+			std::uint32_t first_child;
+			std::uint32_t child_count;
+			std::uint32_t first_rule;
+			std::uint32_t rule_count;
+		};
+		struct pending {
+			std::map<std::string_view, std::unique_ptr<pending>> children;
+			const std::pmr::vector<rule>* rules{nullptr};
+		};
+		// The rules by the normalized path, the source of the compiled trie.
+		std::pmr::map<std::pmr::string, std::pmr::vector<rule>> m_rules;
+		std::pmr::vector<node> m_nodes;
+		std::pmr::string m_labels;
+		std::pmr::vector<rule> m_compiled;
+		size_t m_size{};
+		bool m_dirty{false};
+		std::pmr::string normalize(std::string_view path) const {
+			std::pmr::string normalized(m_labels.get_allocator());
+			for(std::string_view c = next_component(path); !c.empty(); c = next_component(path)) {
+				if(!normalized.empty()) {
+					normalized.push_back('/');
+				}
+				normalized.append(c.data(), c.size());
+			}
+			return normalized;
+		}
+		std::string_view label(const node& n) const noexcept {
+			return std::string_view(m_labels.data() + n.label_offset, n.label_size);
+		}
+		void emit(const std::string& text, const pending* p) {
+			node n{static_cast<std::uint32_t>(m_labels.size()), static_cast<std::uint32_t>(text.size()), 0, 0,
+				static_cast<std::uint32_t>(m_compiled.size()), 0};
+			m_labels.append(text);
+			if(p->rules) {
+				m_compiled.insert(m_compiled.end(), p->rules->begin(), p->rules->end());
+				n.rule_count = static_cast<std::uint32_t>(p->rules->size());
+			}
+			m_nodes.push_back(n);
+		}
+	public:
+		/**
+		 * The constructor with the memory resource of the trie
+		 * \param mr the memory resource, by default the default one
+		 */
+		explicit path_trie(std::pmr::memory_resource* mr = std::pmr::get_default_resource()):
+			m_rules(mr), m_nodes(mr), m_labels(mr), m_compiled(mr) {}
+		/**
+		 * Adds the rights to the rule of the subject under the path, the trie has to be recompiled
+		 * \param path the path prefix, the empty one or `/` covers everything
+		 * \param subject the index of the subject
+		 * \param r the rights
+		 * \param deny whether the rule denies the rights
+		 * @returns `void`
+		 */
+		void add(std::string_view path, const std::uint32_t subject, const enums::rights r, const bool deny) {
+			std::pmr::vector<rule>& rules = m_rules.try_emplace(normalize(path)).first->second;
+			for(rule& existing : rules) {
+				if(existing.subject == subject && existing.deny == deny) {
+					existing.rights = existing.rights | r;
+					m_dirty = true;
+					return;
+				}
+			}
+			rules.push_back(rule{subject, r, deny});
+			++m_size;
+			m_dirty = true;
+		}
+		/**
+		 * Removes the rules of the subject under the path, the trie has to be recompiled
+		 * \param path the path prefix
+		 * \param subject the index of the subject
+		 * @returns `bool` false if the subject has no rules under the path
+		 */
+		bool remove(std::string_view path, const std::uint32_t subject) {
+			auto it = m_rules.find(normalize(path));
+			if(it == m_rules.end()) {
+				return false;
+			}
+			std::pmr::vector<rule>& rules = it->second;
+			const size_t before = rules.size();
+			rules.erase(std::remove_if(rules.begin(), rules.end(), [subject](const rule& r) {
+				return r.subject == subject;
+			}), rules.end());
+			// Counted before the erase, which destroys the rules along with the entry.
+			const size_t removed = before - rules.size();
+			if(rules.empty()) {
+				m_rules.erase(it);
+			}
+			m_size -= removed;
+			m_dirty |= removed != 0;
+			return removed != 0;
+		}
+		/**
+		 * Removes all the rules of the subject, the trie has to be recompiled
+		 * \param subject the index of the subject
+		 * @returns `void`
+		 */
+		void remove_subject(const std::uint32_t subject) {
+			for(auto it = m_rules.begin(); it != m_rules.end();) {
+				std::pmr::vector<rule>& rules = it->second;
+				const size_t before = rules.size();
+				rules.erase(std::remove_if(rules.begin(), rules.end(), [subject](const rule& r) {
+					return r.subject == subject;
+				}), rules.end());
+				m_size -= before - rules.size();
+				m_dirty |= before != rules.size();
+				it = rules.empty() ? m_rules.erase(it) : std::next(it);
+			}
+		}
+		/**
+		 * Checks whether the rules have changed since the trie has been compiled
+		 * @returns `bool`
+		 */
+		bool dirty() const noexcept {
+			return m_dirty;
+		}
+		/**
+		 * Compiles the rules into the trie
+		 * @returns `void`
+		 */
+		void compile() {
+			// Compiles the trie in O(n log n) where n is the number of the path components.
+			pending root;
+			for(const auto& entry : m_rules) {
+				pending* p = &root;
+				std::string_view path = entry.first;
+				for(std::string_view c = next_component(path); !c.empty(); c = next_component(path)) {
+					std::unique_ptr<pending>& child = p->children[c];
+					if(!child) {
+						child = std::make_unique<pending>();
+					}
+					p = child.get();
+				}
+				p->rules = &entry.second;
+			}
+			m_nodes.clear();
+			m_labels.clear();
+			m_compiled.clear();
+			std::vector<const pending*> sources{&root};
+			emit(std::string(), &root);
+			for(size_t i = 0; i < sources.size(); ++i) {
+				m_nodes[i].first_child = static_cast<std::uint32_t>(m_nodes.size());
+				m_nodes[i].child_count = static_cast<std::uint32_t>(sources[i]->children.size());
+				for(const auto& child : sources[i]->children) {
+					std::string text(child.first);
+					const pending* p = child.second.get();
+					while(!p->rules && p->children.size() == 1) {
+						text.push_back('/');
+						text.append(p->children.begin()->first);
+						p = p->children.begin()->second.get();
+					}
+					emit(text, p);
+					sources.push_back(p);
+				}
+			}
+			m_dirty = false;
+		}
+		/**
+		 * Resolves the rights of the subject under the path with the compiled trie
+		 * \param path the checked path
+		 * \param applies the predicate which tells whether the rule of a subject index applies
+		 * \param effective receives the rights of the deepest prefix with the applying rules
+		 * @returns `bool` false if no rule applies
+		 */
+		template <typename F>
+		bool resolve(std::string_view path, F applies, enums::rights& effective) const noexcept {
+			// Resolves the rights in O(d log c) where d is the depth of the path and c the number of children.
+			if(m_nodes.empty()) {
+				return false;
+			}
+			bool found = false;
+			const node* n = &m_nodes[0];
+			while(true) {
+				enums::rights allowed = enums::rights::none;
+				enums::rights denied = enums::rights::none;
+				bool matched = false;
+				for(std::uint32_t r = n->first_rule; r < n->first_rule + n->rule_count; ++r) {
+					const rule& candidate = m_compiled[r];
+					if(applies(candidate.subject)) {
+						matched = true;
+						if(candidate.deny) {
+							denied = denied | candidate.rights;
+						} else {
+							allowed = allowed | candidate.rights;
+						}
+					}
+				}
+				if(matched) {
+					found = true;
+					effective = allowed & ~denied;
+				}
+				std::string_view rest = path;
+				const std::string_view component = next_component(rest);
+				if(component.empty() || n->child_count == 0) {
+					break;
+				}
+				const node* first = &m_nodes[n->first_child];
+				const node* last = first + n->child_count;
+				const node* child = std::lower_bound(first, last, component, [this](const node& c, std::string_view key) {
+					std::string_view l = label(c);
+					return next_component(l) < key;
+				});
+				if(child == last) {
+					break;
+				}
+				// Matches the rest of the merged edge component by component.
+				std::string_view edge = label(*child);
+				std::string_view remaining = path;
+				bool equal = true;
+				for(std::string_view e = next_component(edge); !e.empty(); e = next_component(edge)) {
+					if(next_component(remaining) != e) {
+						equal = false;
+						break;
+					}
+				}
+				if(!equal) {
+					break;
+				}
+				path = remaining;
+				n = child;
+			}
+			return found;
+		}
+		/**
+		 * Gets the number of the rules
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_size;
+		}
+		/**
+		 * Gets the number of the nodes of the compiled trie
+		 * @returns `size_t`
+		 */
+		size_t node_count() const noexcept {
+			return m_nodes.size();
+		}
+};
+}
+}
+
+#endif // __PATH_TRIE_HPP__
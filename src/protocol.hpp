@@ -0,0 +1,190 @@
+#ifndef __PROTOCOL_HPP__
+#define __PROTOCOL_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "access_level.hpp"
+#include "journal.hpp"
+#include "status.hpp"
+
+/// file: protocol.hpp
+
+namespace libs {
+	namespace daemon {
+
+/**
+ * @brief Enumerates the requests served by the daemon.
+ */
+enum class op : std::uint8_t {
+	is_allowed = 1,
+	has_resource = 2,
+	has_subject = 3,
+	add = 4,
+	allow = 5,
+	forbid = 6,
+	remove_subject = 7,
+	remove_grant = 8,
+	try_pop = 9
+};
+
+/**
+ * @brief Defines the request frame.
+ *
+ * The layout is `[u32 frame size][u32 tag][u8 op][u8 rights][u64 uuid][u32 size][subject]`
+ * followed by `[u32 size][resource]` for `op::add`, in the native byte order as the peers share the host.
+ * The tag is echoed back by the response, so the requests could be pipelined.
+ */
+struct request {
+	std::uint32_t tag{};
+	op code{op::is_allowed};
+	enums::rights rights{enums::rights::none};
+	std::uint64_t uuid{};
+	// The serialized subject, valid as long as the frame is.
+	std::string_view subject;
+	// The serialized resource of `op::add`, valid as long as the frame is.
+	std::string_view resource;
+};
+
+/**
+ * @brief Defines the response frame.
+ *
+ * The layout is `[u32 frame size][u32 tag][u8 status][u8 value][u64 uuid]` followed by
+ * `[u32 size][resource]` for `op::try_pop`. The value is the result of the checks, the uuid is the one
+ * allocated by `op::add`.
+ */
+struct response {
+	std::uint32_t tag{};
+	status::code code{status::code::ok};
+	bool value{};
+	std::uint64_t uuid{};
+	// The serialized popped resource, valid as long as the frame is.
+	std::string_view resource;
+	// Whether the popped resource has been sent.
+	bool has_resource{};
+};
+
+// The frames above are rejected as malformed.
+constexpr std::uint32_t max_frame_size = 16u << 20;
+constexpr size_t header_size = 2 * sizeof(std::uint32_t) + 2 * sizeof(std::uint8_t) + sizeof(std::uint64_t);
+
+/**
+ * Gets the size of the first frame of the buffer
+ * \param in the received bytes
+ * @returns `size_t` the size of the frame, 0 if it has not been received whole yet
+ */
+inline size_t frame_size(std::string_view in) noexcept {
+	std::uint32_t size = 0;
+	if(in.size() < sizeof(size)) {
+		return 0;
+	}
+	std::memcpy(&size, in.data(), sizeof(size));
+	return in.size() < size ? 0 : size;
+}
+
+/**
+ * Checks whether the first frame of the buffer declares a size which is never valid
+ * \param in the received bytes
+ * @returns `bool`
+ */
+inline bool is_malformed(std::string_view in) noexcept {
+	std::uint32_t size = 0;
+	if(in.size() < sizeof(size)) {
+		return false;
+	}
+	std::memcpy(&size, in.data(), sizeof(size));
+	return size < header_size || size > max_frame_size;
+}
+
+namespace details {
+	// Appends the frame with its size filled in by `finish`.
+	inline size_t start(std::string& out) {
+		const size_t begin = out.size();
+		journal::put(out, std::uint32_t(0));
+		return begin;
+	}
+	inline void finish(std::string& out, const size_t begin) noexcept {
+		const std::uint32_t size = static_cast<std::uint32_t>(out.size() - begin);
+		std::memcpy(&out[begin], &size, sizeof(size));
+	}
+}
+
+/**
+ * Appends the request frame
+ * \param out the output buffer
+ * \param r the request
+ * @returns `void`
+ */
+inline void encode(std::string& out, const request& r) {
+	const size_t begin = details::start(out);
+	journal::put(out, r.tag);
+	journal::put(out, r.code);
+	journal::put(out, r.rights);
+	journal::put(out, r.uuid);
+	journal::put_bytes(out, r.subject);
+	if(r.code == op::add) {
+		journal::put_bytes(out, r.resource);
+	}
+	details::finish(out, begin);
+}
+
+/**
+ * Appends the response frame
+ * \param out the output buffer
+ * \param r the response
+ * @returns `void`
+ */
+inline void encode(std::string& out, const response& r) {
+	const size_t begin = details::start(out);
+	journal::put(out, r.tag);
+	journal::put(out, r.code);
+	journal::put(out, static_cast<std::uint8_t>(r.value));
+	journal::put(out, r.uuid);
+	if(r.has_resource) {
+		journal::put_bytes(out, r.resource);
+	}
+	details::finish(out, begin);
+}
+
+/**
+ * Decodes the request frame
+ * \param frame the whole frame, see `frame_size`
+ * \param r receives the request, it refers to the frame
+ * @returns `bool` false if the frame is malformed
+ */
+inline bool decode(std::string_view frame, request& r) noexcept {
+	journal::payload in(frame.substr(sizeof(std::uint32_t)));
+	if(!in.get(r.tag) || !in.get(r.code) || !in.get(r.rights) || !in.get(r.uuid) || !in.get_bytes(r.subject)) {
+		return false;
+	}
+	if(static_cast<std::uint8_t>(r.code) < static_cast<std::uint8_t>(op::is_allowed) ||
+			static_cast<std::uint8_t>(r.code) > static_cast<std::uint8_t>(op::try_pop)) {
+		return false;
+	}
+	r.resource = std::string_view();
+	return r.code != op::add || in.get_bytes(r.resource);
+}
+
+/**
+ * Decodes the response frame
+ * \param frame the whole frame, see `frame_size`
+ * \param r receives the response, it refers to the frame
+ * @returns `bool` false if the frame is malformed
+ */
+inline bool decode(std::string_view frame, response& r) noexcept {
+	journal::payload in(frame.substr(sizeof(std::uint32_t)));
+	std::uint8_t value = 0;
+	if(!in.get(r.tag) || !in.get(r.code) || !in.get(value) || !in.get(r.uuid)) {
+		return false;
+	}
+	r.value = value != 0;
+	r.resource = std::string_view();
+	r.has_resource = in.get_bytes(r.resource);
+	return true;
+}
+}
+}
+
+#endif // __PROTOCOL_HPP__
@@ -1,24 +1,151 @@
 #ifndef __RESOURCE_HPP__
 #define __RESOURCE_HPP__
 
+#include <cstddef>
+#include <cstring>
 #include <memory>
+#include <new>
 #include <string>
 #include <type_traits>
+#include <utility>
  
 /// file: resource.hpp
 
 namespace libs {
 	namespace resources{
 
+/// The largest size of the types stored in place, see `is_inline`.
+constexpr size_t inline_size = 2 * sizeof(void*);
+
+/**
+ * @brief Selects the types stored in place rather than on the heap, i.e. the small handles.
+ *
+ * Could be specialized to keep a type on the heap, the inline types must be trivially copyable.
+ * \tparam T the type of raw data stored in resource
+ */
+template <typename T>
+struct is_inline: std::bool_constant<std::is_trivially_copyable<T>::value && sizeof(T) <= inline_size &&
+		alignof(T) <= alignof(std::max_align_t)> {};
+
+/**
+ * @brief Owns the raw data of a resource on the heap.
+ * \tparam T the type of raw data stored in resource
+ */
+template <typename T, bool = is_inline<T>::value>
+class payload {
+	private:
+		std::unique_ptr<T> m_value;
+	public:
+		payload() = default;
+		/**
+		 * Constructs the data in place of the previous one
+		 * \param args the arguments of the constructor of T
+		 * @returns `void`
+		 */
+		template <typename... Args>
+		void emplace(Args&&... args) {
+			m_value = std::make_unique<T>(std::forward<Args>(args)...);
+		}
+		/**
+		 * Gets the data
+		 * @returns `T*` nullptr if there is none
+		 */
+		T* get() const noexcept {
+			return m_value.get();
+		}
+		/**
+		 * Gets the owning pointer of the data
+		 * @returns `std::unique_ptr<T>&`
+		 */
+		std::unique_ptr<T>& pointer() noexcept {
+			return m_value;
+		}
+		/**
+		 * Destroys the data
+		 * @returns `void`
+		 */
+		void reset() noexcept {
+			m_value.reset();
+		}
+		explicit operator bool() const noexcept {
+			return m_value != nullptr;
+		}
+};
+
+/**
+ * @brief Keeps the raw data of a resource in place, the moved-from payload is left empty like the heap one.
+ * \tparam T the type of raw data stored in resource
+ */
+template <typename T>
+class payload<T, true> {
+	private:
+		union {
+			char m_empty{};
+			T m_value;
+		};
+		bool m_has{false};
+	public:
+		payload() noexcept {}
+		payload(const payload&) = delete;
+		payload& operator=(const payload&) = delete;
+		payload(payload&& rhs) noexcept: m_has(rhs.m_has) {
+			if(m_has) {
+				std::memcpy(static_cast<void*>(&m_value), &rhs.m_value, sizeof(T));
+			}
+			rhs.m_has = false;
+		}
+		payload& operator=(payload&& rhs) noexcept {
+			if(this != &rhs) {
+				m_has = rhs.m_has;
+				if(m_has) {
+					std::memcpy(static_cast<void*>(&m_value), &rhs.m_value, sizeof(T));
+				}
+				rhs.m_has = false;
+			}
+			return *this;
+		}
+		/**
+		 * Constructs the data in place of the previous one
+		 * \param args the arguments of the constructor of T
+		 * @returns `void`
+		 */
+		template <typename... Args>
+		void emplace(Args&&... args) {
+			::new(static_cast<void*>(&m_value)) T(std::forward<Args>(args)...);
+			m_has = true;
+		}
+		/**
+		 * Gets the data
+		 * @returns `T*` nullptr if there is none
+		 */
+		T* get() const noexcept {
+			return m_has ? const_cast<T*>(&m_value) : nullptr;
+		}
+		/**
+		 * Destroys the data, the trivially copyable data needs no destructor
+		 * @returns `void`
+		 */
+		void reset() noexcept {
+			m_has = false;
+		}
+		explicit operator bool() const noexcept {
+			return m_has;
+		}
+};
+
 /**
  * @brief Defines the resource.
+ *
+ * The small trivially copyable data is kept in place, see `is_inline`, the rest on the heap.
  * \tparam T the type of raw data stored in resource
  */
 template <typename T>
 class resource {
 	private:
 		size_t m_uuid{};
-		std::unique_ptr<T> m_resource;
+		payload<T> m_resource;
+		// The inline data moved to the heap by `get_resource`, it is put back in place by `get_payload`.
+		std::unique_ptr<T> m_boxed;
 	public: 
 		/**
 		 * The default constructor
@@ -27,7 +154,7 @@ class resource {
 			if constexpr(constexpr bool is_dev_constr = std::is_default_constructible<T>::value) {
 				static_assert(is_dev_constr, "T must be default construcitble");
 			}
-			m_resource = std::move(std::make_unique<T>());
+			m_resource.emplace();
 		}
 		/**
 		 * The copy constructor deleted
@@ -41,34 +168,83 @@ class resource {
 		 * The move constructor
 		 * \param res the resource object that should be moved.
 		 */		 
-		resource(resource<T>&& res): m_resource(std::move(res.m_resource)) {}
+		resource(resource<T>&& res) noexcept: m_uuid(res.m_uuid), m_resource(std::move(res.m_resource)),
+			m_boxed(std::move(res.m_boxed)) {}
 		/**
 		 * The move assignement operator
 		 * \param res the resource object that should be moved.
 		 */		 
-		resource& operator=(resource<T>&& res) { 
+		resource& operator=(resource<T>&& res) noexcept { 
+			m_uuid = res.m_uuid;
 			m_resource = std::move(res.m_resource);
+			m_boxed = std::move(res.m_boxed);
+			return *this;
 		}
 		/**
 		 * The constructor with argument
 		 * \param res a reference to the resource object
 		 */		 
-		resource(T& res): 
-	                m_resource(std::move(std::make_unique<T>(std::move(res)))) {}
+		resource(T& res) {
+			m_resource.emplace(std::move(res));
+		}
 		/**
 		 * The constructor with argument
 		 * \param res a rvalue-reference to the resource object
 		 */		 
-		resource(T&& res): 
-	                m_resource(std::move(std::make_unique<T>(res))) {}
+		resource(T&& res) {
+			m_resource.emplace(res);
+		}
+		/**
+		 * The constructor taking over the data
+		 * \param res the data, possibly none
+		 * \param uuid the uuid of the resource
+		 */
+		resource(payload<T>&& res, const size_t uuid) noexcept: m_uuid(uuid), m_resource(std::move(res)) {}
+		/**
+		 * Gets the owning pointer of the data, the inline data is moved to the heap for it, `get` does not move it
+		 * @returns `std::unique_ptr<T>&` null if there is none
+		 */
 		std::unique_ptr<T>& get_resource() {
+			if constexpr(is_inline<T>::value) {
+				if(m_resource) {
+					m_boxed = std::make_unique<T>(*m_resource.get());
+					m_resource.reset();
+				}
+				return m_boxed;
+			} else {
+				return m_resource.pointer();
+			}
+		}
+		/**
+		 * Gets the data wherever it is kept
+		 * @returns `T*` nullptr if there is none
+		 */
+		T* get() const noexcept {
+			if constexpr(is_inline<T>::value) {
+				if(m_boxed) {
+					return m_boxed.get();
+				}
+			}
+			return m_resource.get();
+		}
+		/**
+		 * Gets the holder of the data, the acl moves it into its grant
+		 * @returns `payload<T>&`
+		 */
+		payload<T>& get_payload() noexcept {
+			if constexpr(is_inline<T>::value) {
+				if(m_boxed) {
+					m_resource.emplace(*m_boxed);
+					m_boxed.reset();
+				}
+			}
 			return m_resource;
 		}
 		/**
 		 * Retrives the uuid of the specified resource
 		 * @returns `size_t`
 		 */		 
-		size_t get_uuid() {
+		size_t get_uuid() const noexcept {
 			return m_uuid;
 		}
 		/**
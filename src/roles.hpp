@@ -0,0 +1,209 @@
+#ifndef __ROLES_HPP__
+#define __ROLES_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "exception.hpp"
+
+/// file: roles.hpp
+
+namespace libs {
+	namespace roles {
+
+/// The value which marks a subject that is not a role.
+constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+/**
+ * @brief Keeps the role memberships of the subjects along with their precomputed transitive closures.
+ *
+ * Every subject which has members is a role and gets a dense role ordinal. Every subject keeps a bitset
+ * of the ordinals of all the roles it belongs to, directly or through the nested roles, so the membership
+ * check is a single bit test. The bitsets are updated incrementally, only the subjects below the changed
+ * membership are touched. The memberships form a DAG, the cycles are rejected.
+ */
+class role_graph {
+	private:
+		struct node {
+			std::pmr::vector<std::uint64_t> closure;
+			std::pmr::vector<std::uint32_t> roles;
+			std::pmr::vector<std::uint32_t> members;
+			std::uint32_t ordinal{npos};
+			explicit node(std::pmr::memory_resource* mr): closure(mr), roles(mr), members(mr) {}
+		};
+		std::pmr::vector<node> m_nodes;
+		std::pmr::vector<std::uint32_t> m_role_subjects;
+		size_t m_memberships{};
+		static void set_bit(std::pmr::vector<std::uint64_t>& bits, const std::uint32_t ordinal) {
+			if(bits.size() <= ordinal / 64) {
+				bits.resize(ordinal / 64 + 1);
+			}
+			bits[ordinal / 64] |= std::uint64_t(1) << (ordinal % 64);
+		}
+		static void merge(std::pmr::vector<std::uint64_t>& bits, const std::pmr::vector<std::uint64_t>& other) {
+			if(bits.size() < other.size()) {
+				bits.resize(other.size());
+			}
+			for(size_t i = 0; i < other.size(); ++i) {
+				bits[i] |= other[i];
+			}
+		}
+		void ensure(const std::uint32_t subject) {
+			while(m_nodes.size() <= subject) {
+				m_nodes.emplace_back(m_nodes.get_allocator().resource());
+			}
+		}
+		// Collects the subject and all the subjects below it, i.e. its transitive members.
+		std::vector<std::uint32_t> below(const std::uint32_t subject) const {
+			std::vector<std::uint32_t> found{subject};
+			std::vector<bool> seen(m_nodes.size());
+			seen[subject] = true;
+			for(size_t i = 0; i < found.size(); ++i) {
+				for(const std::uint32_t m : m_nodes[found[i]].members) {
+					if(!seen[m]) {
+						seen[m] = true;
+						found.push_back(m);
+					}
+				}
+			}
+			return found;
+		}
+		// Recomputes the closures of the affected subjects, their roles are recomputed first.
+		void recompute(const std::uint32_t subject, std::vector<char>& state) {
+			if(state[subject] != 1) {
+				return;
+			}
+			state[subject] = 2;
+			node& n = m_nodes[subject];
+			n.closure.assign(n.closure.size(), 0);
+			for(const std::uint32_t r : n.roles) {
+				recompute(r, state);
+				set_bit(n.closure, m_nodes[r].ordinal);
+				merge(n.closure, m_nodes[r].closure);
+			}
+		}
+	public:
+		/**
+		 * The constructor with the memory resource of the graph
+		 * \param mr the memory resource, by default the default one
+		 */
+		explicit role_graph(std::pmr::memory_resource* mr = std::pmr::get_default_resource()):
+			m_nodes(mr), m_role_subjects(mr) {}
+		/**
+		 * Checks whether the subject belongs to the role, directly or through the nested roles
+		 * \param member the index of the subject
+		 * \param role the index of the role
+		 * @returns `bool`
+		 */
+		bool is_member(const std::uint32_t member, const std::uint32_t role) const noexcept {
+			// Checks the membership in O(1) by the precomputed closure.
+			if(member >= m_nodes.size() || role >= m_nodes.size()) {
+				return false;
+			}
+			const std::uint32_t ordinal = m_nodes[role].ordinal;
+			const std::pmr::vector<std::uint64_t>& bits = m_nodes[member].closure;
+			return ordinal != npos && ordinal / 64 < bits.size() && (bits[ordinal / 64] >> (ordinal % 64)) & 1;
+		}
+		/**
+		 * Makes the subject a direct member of the role
+		 * \param role the index of the role
+		 * \param member the index of the subject, it could be a role itself
+		 * @returns `bool` false if the membership already exists
+		 */
+		bool add_member(const std::uint32_t role, const std::uint32_t member) {
+			// Updates the closures in O(m) where m is the number of the subjects below the member.
+			if(role == member || is_member(role, member)) {
+				libs::exception::raise("Error: The membership would make a cycle of roles");
+			}
+			ensure(std::max(role, member));
+			std::pmr::vector<std::uint32_t>& roles = m_nodes[member].roles;
+			if(std::find(roles.begin(), roles.end(), role) != roles.end()) {
+				return false;
+			}
+			if(m_nodes[role].ordinal == npos) {
+				m_nodes[role].ordinal = static_cast<std::uint32_t>(m_role_subjects.size());
+				m_role_subjects.push_back(role);
+			}
+			roles.push_back(role);
+			m_nodes[role].members.push_back(member);
+			++m_memberships;
+			const std::uint32_t ordinal = m_nodes[role].ordinal;
+			for(const std::uint32_t s : below(member)) {
+				set_bit(m_nodes[s].closure, ordinal);
+				merge(m_nodes[s].closure, m_nodes[role].closure);
+			}
+			return true;
+		}
+		/**
+		 * Removes the direct membership of the subject in the role
+		 * \param role the index of the role
+		 * \param member the index of the subject
+		 * @returns `bool` false if the membership does not exist
+		 */
+		bool remove_member(const std::uint32_t role, const std::uint32_t member) {
+			// Updates the closures in O(m) where m is the number of the subjects below the member.
+			if(role >= m_nodes.size() || member >= m_nodes.size()) {
+				return false;
+			}
+			std::pmr::vector<std::uint32_t>& roles = m_nodes[member].roles;
+			auto it = std::find(roles.begin(), roles.end(), role);
+			if(it == roles.end()) {
+				return false;
+			}
+			roles.erase(it);
+			std::pmr::vector<std::uint32_t>& members = m_nodes[role].members;
+			members.erase(std::find(members.begin(), members.end(), member));
+			--m_memberships;
+			std::vector<char> state(m_nodes.size());
+			const std::vector<std::uint32_t> affected = below(member);
+			for(const std::uint32_t s : affected) {
+				state[s] = 1;
+			}
+			for(const std::uint32_t s : affected) {
+				recompute(s, state);
+			}
+			return true;
+		}
+		/**
+		 * Removes all the memberships of the subject, both as a member and as a role
+		 * \param subject the index of the subject
+		 * @returns `void`
+		 */
+		void remove_subject(const std::uint32_t subject) {
+			if(subject >= m_nodes.size()) {
+				return;
+			}
+			while(!m_nodes[subject].members.empty()) {
+				remove_member(subject, m_nodes[subject].members.back());
+			}
+			while(!m_nodes[subject].roles.empty()) {
+				remove_member(m_nodes[subject].roles.back(), subject);
+			}
+		}
+		/**
+		 * Calls the function for every direct membership
+		 * \param f the function taking the indices of the role and the member
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each_membership(F f) const {
+			for(std::uint32_t m = 0; m < m_nodes.size(); ++m) {
+				for(const std::uint32_t r : m_nodes[m].roles) {
+					f(r, m);
+				}
+			}
+		}
+		/**
+		 * Gets the number of the direct memberships
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_memberships;
+		}
+};
+}
+}
+
+#endif // __ROLES_HPP__
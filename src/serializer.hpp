@@ -0,0 +1,86 @@
+#ifndef __SERIALIZER_HPP__
+#define __SERIALIZER_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/// file: serializer.hpp
+
+namespace libs {
+	namespace serialization {
+
+/**
+ * @brief The serialization hook of the persisted subject and resource types.
+ *
+ * Specialize it for a custom type with `enabled = true` and the static `write` and `read` functions:
+ * `write` appends the bytes of the value to the output, `read` gets exactly the bytes written for
+ * one value, the container format keeps their length, and returns false if they are malformed. The types
+ * serialized as their own bytes could also provide `bytes`, which views them in place, so the lookups skip the copy.
+ * \tparam T the type of the serialized value
+ */
+template <typename T, typename Enable = void>
+struct serializer {
+	static constexpr bool enabled = false;
+};
+
+/**
+ * @brief Serializes the arithmetic types in the native byte order.
+ */
+template <typename T>
+struct serializer<T, std::enable_if_t<std::is_arithmetic<T>::value>> {
+	static constexpr bool enabled = true;
+	static void write(std::string& out, const T& value) {
+		out.append(bytes(value));
+	}
+	static std::string_view bytes(const T& value) noexcept {
+		return std::string_view(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+	static bool read(std::string_view in, T& value) noexcept {
+		if(in.size() != sizeof(T)) {
+			return false;
+		}
+		std::memcpy(&value, in.data(), sizeof(T));
+		return true;
+	}
+};
+
+/**
+ * @brief Serializes `std::string` as its raw bytes.
+ */
+template <>
+struct serializer<std::string> {
+	static constexpr bool enabled = true;
+	static void write(std::string& out, const std::string& value) {
+		out.append(value);
+	}
+	static std::string_view bytes(const std::string& value) noexcept {
+		return value;
+	}
+	static bool read(std::string_view in, std::string& value) {
+		value.assign(in.data(), in.size());
+		return true;
+	}
+};
+
+/**
+ * @brief Checks whether the type has a serializer.
+ */
+template <typename T>
+constexpr bool is_serializable = serializer<T>::enabled;
+
+/**
+ * @brief Checks whether the serializer of the type views the bytes of a value in place.
+ */
+template <typename T, typename Enable = void>
+struct has_bytes: std::false_type {};
+
+template <typename T>
+struct has_bytes<T, std::void_t<decltype(serializer<T>::bytes(std::declval<const T&>()))>>: std::true_type {};
+}
+}
+
+#endif // __SERIALIZER_HPP__
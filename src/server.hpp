@@ -0,0 +1,437 @@
+#ifndef __SERVER_HPP__
+#define __SERVER_HPP__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "acl.hpp"
+#include "exception.hpp"
+#include "journal.hpp"
+#include "protocol.hpp"
+#include "serializer.hpp"
+
+/// file: server.hpp
+
+namespace libs {
+	namespace daemon {
+
+/**
+ * @brief Serves the acl to the local processes over a Unix domain socket, see `protocol.hpp`.
+ *
+ * A single thread multiplexes the connections with epoll, so the acl itself needs no locking.
+ * The complete frames of a readable connection are handled at once, a run of the checks with the
+ * same rights is answered by one batched call with the lookups prefetched. The mutations of a loop
+ * iteration are made durable by one journal commit before any of the responses is sent.
+ * \tparam S the type of data stored in subject, serializable
+ * \tparam R the type of data stored in resource, serializable
+ */
+template <typename S, typename R>
+class server {
+	private:
+		static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+		static_assert(serialization::is_serializable<R>, "The resource type must have a serializer");
+		using handle_type = typename acl::acl<S, R>::handle_type;
+		using view_type = typename acl::acl<S, R>::view_type;
+		struct connection {
+			int fd;
+			std::string in;
+			std::string out;
+			size_t sent{};
+			std::uint32_t events{};
+		};
+		static constexpr size_t read_size = 64 * 1024;
+		// The connection is not read while this much of its output is pending, i.e. the client does not read.
+		static constexpr size_t max_pending = 4u << 20;
+		static constexpr int max_events = 64;
+
+		acl::acl<S, R>& m_acl;
+		journal::writer* m_journal;
+		std::string m_path;
+		int m_listener{-1};
+		int m_epoll{-1};
+		int m_wakeup{-1};
+		std::atomic<bool> m_stopped{false};
+		std::unordered_map<int, std::unique_ptr<connection>> m_connections;
+		// The connections with the output to send after the iteration.
+		std::vector<int> m_dirty;
+		// The connections whose frames were held back by the full output which has drained since.
+		std::vector<int> m_backlog;
+		bool m_mutated{false};
+		// The current batch of the checks.
+		op m_batch_op{op::is_allowed};
+		enums::rights m_batch_rights{enums::rights::none};
+		std::vector<std::pair<handle_type, size_t>> m_checks;
+		std::vector<std::uint32_t> m_tags;
+		std::unique_ptr<bool[]> m_results;
+		size_t m_results_size{};
+		std::string m_bytes;
+		std::unique_ptr<char[]> m_buffer{new char[read_size]};
+		size_t m_requests{};
+		size_t m_batches{};
+
+		[[noreturn]] void fail(const char* msg) {
+			close_all();
+			libs::exception::raise(msg);
+		}
+		void close_all() noexcept {
+			for(auto& entry : m_connections) {
+				::close(entry.first);
+			}
+			m_connections.clear();
+			for(int* fd : {&m_listener, &m_epoll, &m_wakeup}) {
+				if(*fd >= 0) {
+					::close(*fd);
+					*fd = -1;
+				}
+			}
+		}
+		bool watch(const int fd, const std::uint32_t events, const int ctl) noexcept {
+			epoll_event ev{};
+			ev.events = events;
+			ev.data.fd = fd;
+			return ::epoll_ctl(m_epoll, ctl, fd, &ev) == 0;
+		}
+		void drop(const int fd) noexcept {
+			::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+			::close(fd);
+			m_connections.erase(fd);
+		}
+		connection* find(const int fd) noexcept {
+			auto it = m_connections.find(fd);
+			return it == m_connections.end() ? nullptr : it->second.get();
+		}
+		void accept_all() {
+			while(true) {
+				const int fd = ::accept4(m_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if(fd < 0) {
+					return;
+				}
+				if(!watch(fd, EPOLLIN, EPOLL_CTL_ADD)) {
+					::close(fd);
+					continue;
+				}
+				std::unique_ptr<connection> conn = std::make_unique<connection>();
+				conn->fd = fd;
+				conn->events = EPOLLIN;
+				m_connections[fd] = std::move(conn);
+			}
+		}
+		// Reads whatever has arrived, returns false once the peer is gone.
+		bool receive(connection& conn) {
+			while(true) {
+				const ssize_t got = ::read(conn.fd, m_buffer.get(), read_size);
+				if(got > 0) {
+					conn.in.append(m_buffer.get(), static_cast<size_t>(got));
+					continue;
+				}
+				return got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+			}
+		}
+		// Sends the pending output, returns false if the connection failed.
+		bool send(connection& conn) noexcept {
+			while(conn.sent < conn.out.size()) {
+				const ssize_t put = ::send(conn.fd, conn.out.data() + conn.sent, conn.out.size() - conn.sent, MSG_NOSIGNAL);
+				if(put < 0) {
+					return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+				}
+				conn.sent += static_cast<size_t>(put);
+			}
+			conn.out.clear();
+			conn.sent = 0;
+			return true;
+		}
+		bool update(connection& conn) noexcept {
+			const size_t pending = conn.out.size() - conn.sent;
+			const std::uint32_t events = (pending < max_pending ? std::uint32_t(EPOLLIN) : 0u) | (pending ? std::uint32_t(EPOLLOUT) : 0u);
+			if(events == conn.events) {
+				return true;
+			}
+			conn.events = events;
+			return watch(conn.fd, events, EPOLL_CTL_MOD);
+		}
+		handle_type find_subject(std::string_view bytes) {
+			if constexpr(std::is_same<view_type, std::string_view>::value) {
+				return m_acl.find(bytes);
+			} else {
+				S id;
+				return serialization::serializer<S>::read(bytes, id) ? m_acl.find(view_type(id)) : handle_type();
+			}
+		}
+		void flush_batch(std::string& out) {
+			const size_t count = m_checks.size();
+			if(count == 0) {
+				return;
+			}
+			if(m_results_size < count) {
+				m_results_size = count * 2;
+				m_results = std::make_unique<bool[]>(m_results_size);
+			}
+			if(m_batch_op == op::is_allowed) {
+				m_acl.is_allowed_batch(m_checks.data(), count, m_results.get(), m_batch_rights);
+			} else {
+				m_acl.has_resource_batch(m_checks.data(), count, m_results.get());
+			}
+			response resp;
+			for(size_t i = 0; i < count; ++i) {
+				resp.tag = m_tags[i];
+				resp.value = m_results[i];
+				encode(out, resp);
+			}
+			m_checks.clear();
+			m_tags.clear();
+			++m_batches;
+		}
+		void execute(const request& r, std::string& out) {
+			response resp;
+			resp.tag = r.tag;
+			S id;
+			const bool valid = serialization::serializer<S>::read(r.subject, id);
+			switch(r.code) {
+				case op::has_subject:
+					resp.value = m_acl.has_subject(find_subject(r.subject));
+					break;
+				case op::add: {
+					R value;
+					if(!valid) {
+						resp.code = status::code::invalid_subject;
+					} else if(!serialization::serializer<R>::read(r.resource, value)) {
+						resp.code = status::code::invalid_resource;
+					} else {
+						const status::result<size_t> added = m_acl.try_add(subjects::subject<S>(id),
+								std::make_unique<resources::resource<R>>(std::move(value)), enums::access_level(r.rights));
+						resp.code = added.error();
+						resp.uuid = added.value_or(0);
+						m_mutated = true;
+					}
+					break;
+				}
+				case op::allow:
+					resp.code = m_acl.try_allow_access(find_subject(r.subject), r.uuid, r.rights);
+					m_mutated = true;
+					break;
+				case op::forbid:
+					resp.code = m_acl.try_forbid_access(find_subject(r.subject), r.uuid, r.rights);
+					m_mutated = true;
+					break;
+				case op::remove_subject:
+					resp.code = valid ? m_acl.try_remove(subjects::subject<S>(id)) : status::code::invalid_subject;
+					m_mutated = true;
+					break;
+				case op::remove_grant:
+					resp.code = valid ? m_acl.try_remove(subjects::subject<S>(id), r.uuid) : status::code::invalid_subject;
+					m_mutated = true;
+					break;
+				case op::try_pop: {
+					std::unique_ptr<resources::resource<R>> res = m_acl.try_pop(find_subject(r.subject), r.uuid);
+					if(!res) {
+						resp.code = status::code::unknown_resource;
+					} else if(res->get()) {
+						m_bytes.clear();
+						serialization::serializer<R>::write(m_bytes, *res->get());
+						resp.resource = m_bytes;
+						resp.has_resource = true;
+					}
+					m_mutated = true;
+					break;
+				}
+				default:
+					break;
+			}
+			encode(out, resp);
+		}
+		// Handles the complete frames received, returns false if the connection sent a malformed one.
+		bool handle(connection& conn) {
+			size_t consumed = 0;
+			bool valid = true;
+			while(conn.out.size() - conn.sent < max_pending) {
+				const std::string_view rest(conn.in.data() + consumed, conn.in.size() - consumed);
+				if(is_malformed(rest)) {
+					valid = false;
+					break;
+				}
+				const size_t size = frame_size(rest);
+				if(size == 0) {
+					break;
+				}
+				request r;
+				if(!decode(rest.substr(0, size), r)) {
+					valid = false;
+					break;
+				}
+				++m_requests;
+				if(r.code == op::is_allowed || r.code == op::has_resource) {
+					if(!m_checks.empty() && (r.code != m_batch_op || (r.code == op::is_allowed && r.rights != m_batch_rights))) {
+						flush_batch(conn.out);
+					}
+					m_batch_op = r.code;
+					m_batch_rights = r.rights;
+					m_checks.emplace_back(find_subject(r.subject), r.uuid);
+					m_tags.push_back(r.tag);
+				} else {
+					flush_batch(conn.out);
+					execute(r, conn.out);
+				}
+				consumed += size;
+			}
+			flush_batch(conn.out);
+			conn.in.erase(0, consumed);
+			m_dirty.push_back(conn.fd);
+			return valid;
+		}
+		void serve(const epoll_event& ev) {
+			connection* conn = find(ev.data.fd);
+			if(!conn) {
+				return;
+			}
+			if(ev.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+				const bool open = receive(*conn);
+				if(!handle(*conn) || !open) {
+					// The responses to the frames received before the hang up are lost along with the peer.
+					drop(conn->fd);
+					return;
+				}
+			}
+			if(ev.events & EPOLLOUT) {
+				m_dirty.push_back(conn->fd);
+			}
+		}
+	public:
+		/**
+		 * Binds the socket, a stale socket file left at the path is replaced
+		 * \param a the acl to serve, it must outlive the server
+		 * \param path the path of the socket
+		 * \param j the journal attached to the acl, the mutations are committed to it before they are answered
+		 */
+		server(acl::acl<S, R>& a, const std::string& path, journal::writer* j = nullptr): m_acl(a), m_journal(j), m_path(path) {
+			sockaddr_un addr{};
+			if(path.size() >= sizeof(addr.sun_path)) {
+				fail("Error: The socket path is too long");
+			}
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+			m_listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if(m_listener < 0) {
+				fail("Error: Could not create the socket");
+			}
+			::unlink(path.c_str());
+			if(::bind(m_listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(m_listener, SOMAXCONN) != 0) {
+				fail("Error: Could not bind the socket");
+			}
+			m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+			m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if(m_epoll < 0 || m_wakeup < 0 || !watch(m_listener, EPOLLIN, EPOLL_CTL_ADD) || !watch(m_wakeup, EPOLLIN, EPOLL_CTL_ADD)) {
+				fail("Error: Could not set up the event loop");
+			}
+		}
+		/**
+		 * The copy constructor deleted
+		 */
+		server(const server&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		server& operator=(const server&) = delete;
+		/**
+		 * Closes the connections and removes the socket file
+		 */
+		~server() {
+			close_all();
+			::unlink(m_path.c_str());
+		}
+		/**
+		 * Serves the connections until `stop` is called
+		 * @returns `void`
+		 */
+		void run() {
+			epoll_event events[max_events];
+			while(!m_stopped.load(std::memory_order_acquire)) {
+				// The held back frames are handled without waiting.
+				const int n = ::epoll_wait(m_epoll, events, max_events, m_backlog.empty() ? -1 : 0);
+				if(n < 0 && errno != EINTR) {
+					fail("Error: Could not wait for the connections");
+				}
+				for(const int fd : m_backlog) {
+					connection* conn = find(fd);
+					if(conn && !handle(*conn)) {
+						drop(fd);
+					}
+				}
+				m_backlog.clear();
+				for(int i = 0; i < n; ++i) {
+					if(events[i].data.fd == m_listener) {
+						accept_all();
+					} else if(events[i].data.fd == m_wakeup) {
+						std::uint64_t value;
+						while(::read(m_wakeup, &value, sizeof(value)) > 0) {}
+					} else {
+						serve(events[i]);
+					}
+				}
+				if(m_journal && m_mutated) {
+					m_journal->commit(m_acl.journal_lsn());
+				}
+				m_mutated = false;
+				for(const int fd : m_dirty) {
+					connection* conn = find(fd);
+					if(conn && (!send(*conn) || !update(*conn))) {
+						drop(fd);
+					} else if(conn && conn->out.size() - conn->sent < max_pending && frame_size(conn->in) != 0) {
+						m_backlog.push_back(fd);
+					}
+				}
+				m_dirty.clear();
+			}
+		}
+		/**
+		 * Makes `run` return, could be called from another thread or a signal handler
+		 * @returns `void`
+		 */
+		void stop() noexcept {
+			m_stopped.store(true, std::memory_order_release);
+			const std::uint64_t one = 1;
+			if(m_wakeup >= 0) {
+				[[maybe_unused]] const ssize_t put = ::write(m_wakeup, &one, sizeof(one));
+			}
+		}
+		/**
+		 * Gets the number of the requests handled
+		 * @returns `size_t`
+		 */
+		size_t requests() const noexcept {
+			return m_requests;
+		}
+		/**
+		 * Gets the number of the batched calls the checks were answered by
+		 * @returns `size_t`
+		 */
+		size_t batches() const noexcept {
+			return m_batches;
+		}
+		/**
+		 * Gets the number of the open connections
+		 * @returns `size_t`
+		 */
+		size_t connections() const noexcept {
+			return m_connections.size();
+		}
+};
+}
+}
+
+#endif // __SERVER_HPP__
@@ -0,0 +1,230 @@
+#ifndef __SHARD_MAP_HPP__
+#define __SHARD_MAP_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "epoch.hpp"
+
+/// file: shard_map.hpp
+
+namespace libs {
+	namespace concurrency {
+
+/**
+ * @brief A hash map changed by one writer at a time and read by any number of lock-free readers.
+ *
+ * The caller serializes the writers, e.g. by the lock of the shard. Every key is linked into its bucket
+ * by a link of its own, an insert publishes the new link at the head of the bucket and an erase unlinks it,
+ * so a change costs O(1) rather than a copy of the whole map. Once full the table is rebuilt into a doubled
+ * one of fresh links and published as a whole, once a quarter full into a halved one, so the memory follows
+ * the keys in the map. The unlinked links and tables are retired through the epoch domain, so the readers
+ * look up within its guard. The values are stored as they are, not owned.
+ * \tparam K the type of the keys
+ * \tparam V the type of the values, a pointer or another small trivially copyable type
+ * \tparam Hash the hash of the keys
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class shard_map {
+	private:
+		struct link {
+			const K key;
+			std::atomic<V> value;
+			std::atomic<link*> next;
+			link(const K& k, V v, link* n): key(k), value(v), next(n) {}
+		};
+		struct table {
+			const size_t mask;
+			std::unique_ptr<std::atomic<link*>[]> buckets;
+			explicit table(const size_t size): mask(size - 1), buckets(new std::atomic<link*>[size]()) {}
+			~table() {
+				for(size_t i = 0; i <= mask; ++i) {
+					link* l = buckets[i].load(std::memory_order_relaxed);
+					while(l) {
+						link* next = l->next.load(std::memory_order_relaxed);
+						delete l;
+						l = next;
+					}
+				}
+			}
+		};
+		static constexpr size_t initial_size = 8;
+		epoch_domain& m_domain;
+		std::atomic<table*> m_table;
+		size_t m_size{};
+		// Spreads the hash, so the keys the shards are picked by still fill all the buckets.
+		static size_t bucket_of(const K& key, const size_t mask) noexcept {
+			std::uint64_t h = static_cast<std::uint64_t>(Hash()(key));
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+			return static_cast<size_t>(h) & mask;
+		}
+		link* find_link(const K& key) const noexcept {
+			const table* t = m_table.load(std::memory_order_acquire);
+			for(link* l = t->buckets[bucket_of(key, t->mask)].load(std::memory_order_acquire); l;
+					l = l->next.load(std::memory_order_acquire)) {
+				if(l->key == key) {
+					return l;
+				}
+			}
+			return nullptr;
+		}
+		// Must be called by the writer, rebuilds the table of the size. Nothing changes if it fails.
+		void rebuild(const size_t size) {
+			const table* t = m_table.load(std::memory_order_relaxed);
+			std::unique_ptr<table> fresh = std::make_unique<table>(size);
+			for(size_t i = 0; i <= t->mask; ++i) {
+				for(link* l = t->buckets[i].load(std::memory_order_relaxed); l; l = l->next.load(std::memory_order_relaxed)) {
+					std::atomic<link*>& bucket = fresh->buckets[bucket_of(l->key, fresh->mask)];
+					bucket.store(new link(l->key, l->value.load(std::memory_order_relaxed),
+							bucket.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+				}
+			}
+			m_domain.retire(m_table.exchange(fresh.release(), std::memory_order_acq_rel));
+		}
+	public:
+		/**
+		 * @brief The key and value allocated ahead of the insert, so the insert itself never fails.
+		 */
+		class entry {
+			private:
+				std::unique_ptr<link> m_link;
+				friend class shard_map;
+				explicit entry(link* l) noexcept: m_link(l) {}
+			public:
+				/**
+				 * The default constructor of the empty entry
+				 */
+				entry() = default;
+		};
+		/**
+		 * The constructor with the domain the unlinked links are retired through
+		 * \param domain the epoch domain of the readers
+		 */
+		explicit shard_map(epoch_domain& domain = epoch_domain::global()):
+			m_domain(domain), m_table(new table(initial_size)) {}
+		/**
+		 * The copy constructor deleted
+		 */
+		shard_map(const shard_map&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		shard_map& operator=(const shard_map&) = delete;
+		/**
+		 * The destructor, there must be no readers left
+		 */
+		~shard_map() {
+			delete m_table.load(std::memory_order_relaxed);
+		}
+		/**
+		 * Finds the value of the key, called within an epoch guard or by the writer
+		 * \param key the key
+		 * @returns `V` the value, or the value initialized one if the key is missing
+		 */
+		V find(const K& key) const noexcept {
+			const link* l = find_link(key);
+			return l ? l->value.load(std::memory_order_acquire) : V{};
+		}
+		/**
+		 * Allocates the entry of the missing key and makes room for it, called by the writer. Nothing visible changes if it fails.
+		 * \param key the key, it must not be in the map
+		 * \param value the value
+		 * @returns `entry` the entry to insert before any other change of the map
+		 */
+		entry prepare(const K& key, const V value) {
+			const size_t buckets = m_table.load(std::memory_order_relaxed)->mask + 1;
+			if(m_size >= buckets) {
+				rebuild(2 * buckets);
+			}
+			return entry(new link(key, value, nullptr));
+		}
+		/**
+		 * Inserts the prepared entry, called by the writer
+		 * \param e the entry
+		 * @returns `void`
+		 */
+		void insert(entry e) noexcept {
+			const table* t = m_table.load(std::memory_order_relaxed);
+			link* l = e.m_link.release();
+			std::atomic<link*>& bucket = t->buckets[bucket_of(l->key, t->mask)];
+			l->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			bucket.store(l, std::memory_order_release);
+			++m_size;
+		}
+		/**
+		 * Inserts the missing key, called by the writer. Nothing changes if it fails.
+		 * \param key the key, it must not be in the map
+		 * \param value the value
+		 * @returns `void`
+		 */
+		void insert(const K& key, const V value) {
+			insert(prepare(key, value));
+		}
+		/**
+		 * Replaces the value of the key in place, called by the writer
+		 * \param key the key
+		 * \param value the value
+		 * @returns `bool` false if the key is missing
+		 */
+		bool assign(const K& key, const V value) noexcept {
+			link* l = find_link(key);
+			if(l) {
+				l->value.store(value, std::memory_order_release);
+			}
+			return l != nullptr;
+		}
+		/**
+		 * Erases the key, called by the writer
+		 * \param key the key
+		 * @returns `V` the value of the erased key, or the value initialized one if the key is missing
+		 */
+		V erase(const K& key) {
+			const size_t buckets = m_table.load(std::memory_order_relaxed)->mask + 1;
+			if(buckets > initial_size && 4 * m_size <= buckets && find_link(key)) {
+				rebuild(buckets / 2);
+			}
+			const table* t = m_table.load(std::memory_order_relaxed);
+			std::atomic<link*>* prev = &t->buckets[bucket_of(key, t->mask)];
+			for(link* l = prev->load(std::memory_order_relaxed); l; l = prev->load(std::memory_order_relaxed)) {
+				if(l->key == key) {
+					// The readers standing on the link still follow its next one.
+					prev->store(l->next.load(std::memory_order_relaxed), std::memory_order_release);
+					--m_size;
+					const V value = l->value.load(std::memory_order_relaxed);
+					m_domain.retire(l);
+					return value;
+				}
+				prev = &l->next;
+			}
+			return V{};
+		}
+		/**
+		 * Calls the function for every key and value, called by the writer
+		 * \param f the function taking `const K&` and `V`
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each(F f) const {
+			const table* t = m_table.load(std::memory_order_relaxed);
+			for(size_t i = 0; i <= t->mask; ++i) {
+				for(link* l = t->buckets[i].load(std::memory_order_relaxed); l; l = l->next.load(std::memory_order_relaxed)) {
+					f(l->key, l->value.load(std::memory_order_relaxed));
+				}
+			}
+		}
+		/**
+		 * Gets the number of the keys, called by the writer
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_size;
+		}
+};
+}
+}
+
+#endif // __SHARD_MAP_HPP__
@@ -0,0 +1,901 @@
+#ifndef __SHARED_ACL_HPP__
+#define __SHARED_ACL_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ACL_SHARED_MEMORY 1
+#endif
+
+#include "access_level.hpp"
+#include "exception.hpp"
+#include "journal.hpp"
+#include "serializer.hpp"
+#include "snapshot.hpp"
+#include "subject.hpp"
+
+/// file: shared_acl.hpp
+
+namespace libs {
+	namespace shared {
+
+/// The version of the segment layout.
+constexpr std::uint32_t format_version = 1;
+/// The subject ordinal of the empty subject record.
+constexpr std::uint32_t empty = 0;
+/// The subject ordinal of the removed subject records and grants.
+constexpr std::uint32_t removed = ~std::uint32_t(0);
+
+/**
+ * @brief The header at the beginning of the shared segment.
+ *
+ * The header is followed by the subject table, the grant table and the arena of the subject keys, every
+ * offset is relative to the beginning of the segment, so the segment is mapped at any address. The
+ * writer makes the sequence odd for the time of an update, the readers retry the lookups which have
+ * seen it odd or changed. The layout changes only within an update, once the segment has grown its
+ * size is past the mappings of the readers, they map it again.
+ */
+struct header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::atomic<std::uint64_t> sequence;
+	std::atomic<std::uint64_t> size;
+	std::atomic<std::uint64_t> subjects_offset;
+	std::atomic<std::uint64_t> subject_capacity;
+	std::atomic<std::uint64_t> grants_offset;
+	std::atomic<std::uint64_t> grant_capacity;
+	std::atomic<std::uint64_t> arena_offset;
+	std::atomic<std::uint64_t> arena_size;
+	std::atomic<std::uint64_t> subject_count;
+	std::atomic<std::uint64_t> grant_count;
+};
+
+/**
+ * @brief A subject record of the open addressing table, its key is the serialized id kept in the arena.
+ */
+struct subject_record {
+	std::atomic<std::uint64_t> hash;
+	std::atomic<std::uint64_t> key_offset;
+	std::atomic<std::uint32_t> key_size;
+	// The ordinal the grants refer to the subject by, `empty` or `removed` if there is no subject.
+	std::atomic<std::uint32_t> id;
+};
+
+/**
+ * @brief A grant record of the open addressing table, the expiry time is in nanoseconds since the epoch of the system clock.
+ */
+struct grant_record {
+	// Zero marks the empty record.
+	std::atomic<std::uint64_t> uuid;
+	// The ordinal of the owning subject, `removed` if the grant has been removed.
+	std::atomic<std::uint32_t> subject;
+	std::atomic<std::uint8_t> rights;
+	std::atomic<std::uint8_t> expiring;
+	std::atomic<std::uint8_t> expires_grant;
+	std::uint8_t reserved;
+	std::atomic<std::int64_t> expires;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free &&
+		std::atomic<std::uint8_t>::is_always_lock_free && std::atomic<std::int64_t>::is_always_lock_free,
+		"The atomics must be lock free to be shared across the processes");
+static_assert(sizeof(header) % 8 == 0 && sizeof(subject_record) % 8 == 0 && sizeof(grant_record) % 8 == 0,
+		"The shared records must keep the tables 8 bytes aligned");
+
+constexpr char segment_magic[8] = {'A', 'C', 'L', 'S', 'H', 'M', '\0', '\0'};
+
+namespace details {
+	constexpr size_t npos = ~size_t(0);
+
+	inline std::uint64_t hash(std::string_view key) noexcept {
+		const std::uint64_t h = snapshot::checksum(key.data(), key.size());
+		return h ^ (h >> 29);
+	}
+
+	// The tables of a segment, resolved from its header.
+	struct layout {
+		std::uint64_t size;
+		const subject_record* subjects;
+		size_t subject_capacity;
+		const grant_record* grants;
+		size_t grant_capacity;
+		const char* arena;
+		size_t arena_size;
+	};
+
+	// Resolves the tables, returns false if they do not fit the mapping or are torn.
+	inline bool resolve(const char* base, const size_t mapped, layout& l) noexcept {
+		const header* h = reinterpret_cast<const header*>(base);
+		l.size = h->size.load(std::memory_order_relaxed);
+		const std::uint64_t subjects = h->subjects_offset.load(std::memory_order_relaxed);
+		const std::uint64_t grants = h->grants_offset.load(std::memory_order_relaxed);
+		const std::uint64_t arena = h->arena_offset.load(std::memory_order_relaxed);
+		l.subject_capacity = h->subject_capacity.load(std::memory_order_relaxed);
+		l.grant_capacity = h->grant_capacity.load(std::memory_order_relaxed);
+		l.arena_size = h->arena_size.load(std::memory_order_relaxed);
+		if(l.size > mapped || l.subject_capacity == 0 || (l.subject_capacity & (l.subject_capacity - 1)) != 0 ||
+				l.grant_capacity == 0 || (l.grant_capacity & (l.grant_capacity - 1)) != 0 ||
+				subjects < sizeof(header) || subjects + l.subject_capacity * sizeof(subject_record) > grants ||
+				grants + l.grant_capacity * sizeof(grant_record) > arena || arena + l.arena_size > l.size) {
+			return false;
+		}
+		l.subjects = reinterpret_cast<const subject_record*>(base + subjects);
+		l.grants = reinterpret_cast<const grant_record*>(base + grants);
+		l.arena = base + arena;
+		return true;
+	}
+
+	// Finds the live subject record of the key. The probes are bounded and the keys are checked against the
+	// arena, since the reader may see the records half updated, its result is then discarded.
+	inline size_t find_subject(const layout& l, std::string_view key, const std::uint64_t h) noexcept {
+		const size_t mask = l.subject_capacity - 1;
+		for(size_t i = h & mask, n = 0; n < l.subject_capacity; i = (i + 1) & mask, ++n) {
+			const subject_record& r = l.subjects[i];
+			const std::uint32_t id = r.id.load(std::memory_order_relaxed);
+			if(id == empty) {
+				return npos;
+			}
+			if(id == removed || r.hash.load(std::memory_order_relaxed) != h) {
+				continue;
+			}
+			const std::uint64_t offset = r.key_offset.load(std::memory_order_relaxed);
+			const std::uint32_t size = r.key_size.load(std::memory_order_relaxed);
+			if(size == key.size() && offset <= l.arena_size && size <= l.arena_size - offset &&
+					(size == 0 || std::memcmp(l.arena + offset, key.data(), size) == 0)) {
+				return i;
+			}
+		}
+		return npos;
+	}
+
+	// Finds the grant record of the uuid, the removed one included.
+	inline size_t find_grant(const layout& l, const std::uint64_t uuid) noexcept {
+		const size_t mask = l.grant_capacity - 1;
+		for(size_t i = hash(std::string_view(reinterpret_cast<const char*>(&uuid), sizeof(uuid))) & mask, n = 0;
+				n < l.grant_capacity; i = (i + 1) & mask, ++n) {
+			const std::uint64_t u = l.grants[i].uuid.load(std::memory_order_relaxed);
+			if(u == uuid) {
+				return i;
+			}
+			if(u == 0) {
+				return npos;
+			}
+		}
+		return npos;
+	}
+
+	/**
+	 * @brief Owns the POSIX shared memory object and its mapping.
+	 */
+	class segment {
+		private:
+			std::string m_name;
+			int m_fd{-1};
+			char* m_data{nullptr};
+			size_t m_size{};
+			bool m_writable{false};
+		public:
+			/**
+			 * Creates the object, the stale one of the same name is unlinked first, or opens the existing one read-only
+			 * \param name the name of the object, e.g. `/acl`
+			 * \param create whether to create the object for writing
+			 */
+			segment(const std::string& name, const bool create): m_name(name), m_writable(create) {
+#ifdef ACL_SHARED_MEMORY
+				if(create) {
+					::shm_unlink(name.c_str());
+					m_fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+				} else {
+					m_fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+				}
+				if(m_fd < 0) {
+					std::string msg = std::string("Error: Could not open the shared memory: ") + name;
+					libs::exception::raise(msg.c_str());
+				}
+#else
+				libs::exception::raise("Error: The shared memory is not supported on this platform");
+#endif
+			}
+			/**
+			 * The copy constructor deleted
+			 */
+			segment(const segment&) = delete;
+			/**
+			 * The assignement operator deleted
+			 */
+			segment& operator=(const segment&) = delete;
+			/**
+			 * Unmaps the object, the writer unlinks it as well, the readers keep their mappings
+			 */
+			~segment() {
+#ifdef ACL_SHARED_MEMORY
+				if(m_data) {
+					::munmap(m_data, m_size);
+				}
+				::close(m_fd);
+				if(m_writable) {
+					::shm_unlink(m_name.c_str());
+				}
+#endif
+			}
+			/**
+			 * Maps the current size of the object
+			 * @returns `bool` false if the object could not be mapped
+			 */
+			bool map() noexcept {
+#ifdef ACL_SHARED_MEMORY
+				struct stat st;
+				if(::fstat(m_fd, &st) != 0 || st.st_size <= 0) {
+					return false;
+				}
+				const size_t size = static_cast<size_t>(st.st_size);
+				void* addr = ::mmap(nullptr, size, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+				if(addr == MAP_FAILED) {
+					return false;
+				}
+				if(m_data) {
+					::munmap(m_data, m_size);
+				}
+				m_data = static_cast<char*>(addr);
+				m_size = size;
+				return true;
+#else
+				return false;
+#endif
+			}
+			/**
+			 * Grows the object and maps it again, the contents are preserved
+			 * \param size the new size
+			 * @returns `void`
+			 */
+			void resize(const size_t size) {
+#ifdef ACL_SHARED_MEMORY
+				if(::ftruncate(m_fd, static_cast<off_t>(size)) != 0 || !map()) {
+					libs::exception::raise("Error: Could not grow the shared memory");
+				}
+#endif
+			}
+			char* data() const noexcept {
+				return m_data;
+			}
+			size_t size() const noexcept {
+				return m_size;
+			}
+			const std::string& name() const noexcept {
+				return m_name;
+			}
+	};
+}
+
+/**
+ * @brief Maintains the acl in a POSIX shared memory segment which the other processes query in place.
+ *
+ * The writer is attached to the acl by `acl::attach_shared` and applies the same records the journal
+ * gets. The subjects and the grants live in two open addressing tables linked by the subject ordinals,
+ * so the tables are rehashed, grown or compacted independently. Every update runs under the sequence
+ * lock of the segment, the readers never block the writer. The resources, the role memberships and the
+ * path grants stay within the writer process. Only one writer owns the segment, it unlinks the segment
+ * once destroyed.
+ */
+class writer {
+	private:
+		struct live_subject {
+			std::uint64_t hash;
+			std::uint32_t id;
+			std::string key;
+		};
+		struct live_grant {
+			std::uint64_t uuid;
+			std::uint32_t subject;
+			std::uint8_t rights;
+			std::uint8_t expiring;
+			std::uint8_t expires_grant;
+			std::int64_t expires;
+		};
+		details::segment m_segment;
+		unsigned m_depth{};
+		std::uint32_t m_next_id{1};
+		// The records in use, the removed ones included, until the next rebuild.
+		size_t m_subjects_used{};
+		size_t m_grants_used{};
+		size_t m_subject_count{};
+		size_t m_grant_count{};
+		size_t m_arena_used{};
+		size_t m_key_bytes{};
+		header* get_header() const noexcept {
+			return reinterpret_cast<header*>(m_segment.data());
+		}
+		subject_record* subjects() const noexcept {
+			return reinterpret_cast<subject_record*>(m_segment.data() + get_header()->subjects_offset.load(std::memory_order_relaxed));
+		}
+		grant_record* grants() const noexcept {
+			return reinterpret_cast<grant_record*>(m_segment.data() + get_header()->grants_offset.load(std::memory_order_relaxed));
+		}
+		char* arena() const noexcept {
+			return m_segment.data() + get_header()->arena_offset.load(std::memory_order_relaxed);
+		}
+		details::layout get_layout() const noexcept {
+			details::layout l{};
+			details::resolve(m_segment.data(), m_segment.size(), l);
+			return l;
+		}
+		static size_t round_up(size_t n) noexcept {
+			size_t capacity = 8;
+			while(capacity < n) {
+				capacity *= 2;
+			}
+			return capacity;
+		}
+		// Lays the tables out anew and inserts the live records back, the removed ones are dropped and the keys compacted.
+		void rebuild(const size_t subject_capacity, const size_t grant_capacity, const size_t arena_size) {
+			std::vector<live_subject> live_subjects;
+			std::vector<live_grant> live_grants;
+			if(get_header()->subject_capacity.load(std::memory_order_relaxed) != 0) {
+				const details::layout l = get_layout();
+				live_subjects.reserve(m_subject_count);
+				for(size_t i = 0; i < l.subject_capacity; ++i) {
+					const subject_record& r = l.subjects[i];
+					const std::uint32_t id = r.id.load(std::memory_order_relaxed);
+					if(id != empty && id != removed) {
+						live_subjects.push_back(live_subject{r.hash.load(std::memory_order_relaxed), id,
+								std::string(l.arena + r.key_offset.load(std::memory_order_relaxed), r.key_size.load(std::memory_order_relaxed))});
+					}
+				}
+				live_grants.reserve(m_grant_count);
+				for(size_t i = 0; i < l.grant_capacity; ++i) {
+					const grant_record& g = l.grants[i];
+					const std::uint64_t uuid = g.uuid.load(std::memory_order_relaxed);
+					const std::uint32_t subject = g.subject.load(std::memory_order_relaxed);
+					if(uuid != 0 && subject != removed) {
+						live_grants.push_back(live_grant{uuid, subject, g.rights.load(std::memory_order_relaxed),
+								g.expiring.load(std::memory_order_relaxed), g.expires_grant.load(std::memory_order_relaxed),
+								g.expires.load(std::memory_order_relaxed)});
+					}
+				}
+			}
+			const size_t subjects_offset = sizeof(header);
+			const size_t grants_offset = subjects_offset + subject_capacity * sizeof(subject_record);
+			const size_t arena_offset = grants_offset + grant_capacity * sizeof(grant_record);
+			const size_t size = arena_offset + arena_size;
+			// The segment never shrinks, the readers may still hold the larger mapping.
+			if(size > m_segment.size()) {
+				m_segment.resize(size);
+			}
+			header* h = get_header();
+			h->size.store(m_segment.size(), std::memory_order_relaxed);
+			h->subjects_offset.store(subjects_offset, std::memory_order_relaxed);
+			h->subject_capacity.store(subject_capacity, std::memory_order_relaxed);
+			h->grants_offset.store(grants_offset, std::memory_order_relaxed);
+			h->grant_capacity.store(grant_capacity, std::memory_order_relaxed);
+			h->arena_offset.store(arena_offset, std::memory_order_relaxed);
+			h->arena_size.store(arena_size, std::memory_order_relaxed);
+			for(size_t i = 0; i < subject_capacity; ++i) {
+				new (subjects() + i) subject_record{};
+			}
+			for(size_t i = 0; i < grant_capacity; ++i) {
+				new (grants() + i) grant_record{};
+			}
+			m_subjects_used = 0;
+			m_grants_used = 0;
+			m_arena_used = 0;
+			for(const live_subject& s : live_subjects) {
+				insert_subject(s.key, s.hash, s.id);
+			}
+			for(const live_grant& g : live_grants) {
+				grant_record& r = grants()[insert_grant(g.uuid)];
+				r.subject.store(g.subject, std::memory_order_relaxed);
+				r.rights.store(g.rights, std::memory_order_relaxed);
+				r.expiring.store(g.expiring, std::memory_order_relaxed);
+				r.expires_grant.store(g.expires_grant, std::memory_order_relaxed);
+				r.expires.store(g.expires, std::memory_order_relaxed);
+			}
+		}
+		// Makes room for the records about to be inserted, the tables are kept at most 3/4 full.
+		void reserve(const size_t subjects, const size_t key_bytes, const size_t grants) {
+			const header* h = get_header();
+			size_t subject_capacity = h->subject_capacity.load(std::memory_order_relaxed);
+			size_t grant_capacity = h->grant_capacity.load(std::memory_order_relaxed);
+			size_t arena_size = h->arena_size.load(std::memory_order_relaxed);
+			const bool subjects_full = (m_subjects_used + subjects) * 4 > subject_capacity * 3;
+			const bool grants_full = (m_grants_used + grants) * 4 > grant_capacity * 3;
+			const bool arena_full = m_arena_used + key_bytes > arena_size;
+			if(!subjects_full && !grants_full && !arena_full) {
+				return;
+			}
+			// Rehashed in place while the removed records are the most of the used ones, grown twice otherwise.
+			if((m_subject_count + subjects) * 2 > subject_capacity) {
+				subject_capacity = round_up((m_subject_count + subjects) * 2);
+			}
+			if((m_grant_count + grants) * 2 > grant_capacity) {
+				grant_capacity = round_up((m_grant_count + grants) * 2);
+			}
+			if((m_key_bytes + key_bytes) * 2 > arena_size) {
+				arena_size = (m_key_bytes + key_bytes) * 2;
+			}
+			rebuild(subject_capacity, grant_capacity, (arena_size + 7) / 8 * 8);
+		}
+		size_t insert_subject(std::string_view key, const std::uint64_t h, const std::uint32_t id) {
+			const size_t mask = get_header()->subject_capacity.load(std::memory_order_relaxed) - 1;
+			subject_record* records = subjects();
+			size_t i = h & mask;
+			for(std::uint32_t current = records[i].id.load(std::memory_order_relaxed); current != empty && current != removed;
+					current = records[i].id.load(std::memory_order_relaxed)) {
+				i = (i + 1) & mask;
+			}
+			if(records[i].id.load(std::memory_order_relaxed) == empty) {
+				++m_subjects_used;
+			}
+			std::memcpy(arena() + m_arena_used, key.data(), key.size());
+			records[i].hash.store(h, std::memory_order_relaxed);
+			records[i].key_offset.store(m_arena_used, std::memory_order_relaxed);
+			records[i].key_size.store(static_cast<std::uint32_t>(key.size()), std::memory_order_relaxed);
+			records[i].id.store(id, std::memory_order_relaxed);
+			m_arena_used += key.size();
+			return i;
+		}
+		size_t insert_grant(const std::uint64_t uuid) {
+			const size_t mask = get_header()->grant_capacity.load(std::memory_order_relaxed) - 1;
+			grant_record* records = grants();
+			size_t i = details::hash(std::string_view(reinterpret_cast<const char*>(&uuid), sizeof(uuid))) & mask;
+			while(records[i].uuid.load(std::memory_order_relaxed) != 0 && records[i].subject.load(std::memory_order_relaxed) != removed) {
+				i = (i + 1) & mask;
+			}
+			if(records[i].uuid.load(std::memory_order_relaxed) == 0) {
+				++m_grants_used;
+			}
+			records[i].uuid.store(uuid, std::memory_order_relaxed);
+			return i;
+		}
+		std::uint32_t intern(std::string_view key) {
+			const std::uint64_t h = details::hash(key);
+			size_t i = details::find_subject(get_layout(), key, h);
+			if(i == details::npos) {
+				reserve(1, key.size(), 0);
+				i = insert_subject(key, h, m_next_id++);
+				++m_subject_count;
+				m_key_bytes += key.size();
+			}
+			return subjects()[i].id.load(std::memory_order_relaxed);
+		}
+		grant_record* find_grant(const std::uint64_t uuid) const noexcept {
+			const size_t i = details::find_grant(get_layout(), uuid);
+			if(i == details::npos || grants()[i].subject.load(std::memory_order_relaxed) == removed) {
+				return nullptr;
+			}
+			return grants() + i;
+		}
+		void remove_grant(grant_record& g) noexcept {
+			g.subject.store(removed, std::memory_order_relaxed);
+			--m_grant_count;
+		}
+		void remove_subject(std::string_view key) noexcept {
+			const details::layout l = get_layout();
+			const size_t i = details::find_subject(l, key, details::hash(key));
+			if(i == details::npos) {
+				return;
+			}
+			subject_record& r = subjects()[i];
+			const std::uint32_t id = r.id.load(std::memory_order_relaxed);
+			r.id.store(removed, std::memory_order_relaxed);
+			--m_subject_count;
+			m_key_bytes -= key.size();
+			// Scans the grant table, the segment keeps no grants per subject.
+			grant_record* records = grants();
+			for(size_t g = 0; g < l.grant_capacity && m_grant_count; ++g) {
+				if(records[g].uuid.load(std::memory_order_relaxed) != 0 && records[g].subject.load(std::memory_order_relaxed) == id) {
+					remove_grant(records[g]);
+				}
+			}
+		}
+		void begin() noexcept {
+			if(m_depth++ == 0) {
+				header* h = get_header();
+				h->sequence.store(h->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+			}
+		}
+		void end() noexcept {
+			if(--m_depth == 0) {
+				header* h = get_header();
+				h->subject_count.store(m_subject_count, std::memory_order_relaxed);
+				h->grant_count.store(m_grant_count, std::memory_order_relaxed);
+				h->sequence.store(h->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+		}
+		static void malformed() {
+			libs::exception::raise("Error: Invalid shared record: malformed record");
+		}
+	public:
+		/**
+		 * @brief Makes the updates within its scope a single one, the readers see either none or all of them.
+		 */
+		class update {
+			private:
+				writer* m_writer;
+			public:
+				/**
+				 * Begins the update
+				 * \param w the writer, nullptr makes the update a no-op
+				 */
+				explicit update(writer* w) noexcept: m_writer(w) {
+					if(m_writer) {
+						m_writer->begin();
+					}
+				}
+				/**
+				 * The copy constructor deleted
+				 */
+				update(const update&) = delete;
+				/**
+				 * The assignement operator deleted
+				 */
+				update& operator=(const update&) = delete;
+				/**
+				 * Publishes the update
+				 */
+				~update() {
+					if(m_writer) {
+						m_writer->end();
+					}
+				}
+		};
+		/**
+		 * Creates the shared memory segment, the stale one of the same name is replaced
+		 * \param name the name of the POSIX shared memory object, e.g. `/acl`
+		 * \param subjects the initial capacity of the subject table
+		 * \param grants the initial capacity of the grant table
+		 * \param key_bytes the initial size of the arena of the subject keys
+		 */
+		explicit writer(const std::string& name, size_t subjects = 1024, size_t grants = 4096, size_t key_bytes = 64 * 1024):
+			m_segment(name, true) {
+			m_segment.resize(sizeof(header));
+			new (get_header()) header{};
+			rebuild(round_up(subjects), round_up(grants), (key_bytes + 7) / 8 * 8);
+			header* h = get_header();
+			h->version = format_version;
+			h->byte_order = snapshot::byte_order_mark;
+			std::atomic_thread_fence(std::memory_order_release);
+			std::memcpy(h->magic, segment_magic, sizeof(segment_magic));
+		}
+		/**
+		 * The copy constructor deleted
+		 */
+		writer(const writer&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		writer& operator=(const writer&) = delete;
+		/**
+		 * Removes all the subjects and the grants
+		 * @returns `void`
+		 */
+		void clear() {
+			update u(this);
+			const header* h = get_header();
+			m_subject_count = 0;
+			m_grant_count = 0;
+			m_key_bytes = 0;
+			rebuild(h->subject_capacity.load(std::memory_order_relaxed), h->grant_capacity.load(std::memory_order_relaxed),
+					h->arena_size.load(std::memory_order_relaxed));
+		}
+		/**
+		 * Adds the subject without any grants
+		 * \param key the serialized id of the subject
+		 * @returns `void`
+		 */
+		void add_subject(std::string_view key) {
+			update u(this);
+			intern(key);
+		}
+		/**
+		 * Applies the journaled mutation, the records of the resources and the role memberships are skipped
+		 * \param o the mutation
+		 * \param data the payload of the journal record
+		 * @returns `void`
+		 */
+		void apply(const journal::op o, std::string_view data) {
+			update u(this);
+			journal::payload in(data);
+			std::uint64_t uuid = 0;
+			std::uint8_t rights = 0;
+			std::string_view key;
+			switch(o) {
+				case journal::op::add: {
+					if(!in.get(uuid) || !in.get(rights) || !in.get_bytes(key) || uuid == 0) {
+						malformed();
+					}
+					const std::uint32_t id = intern(key);
+					if(find_grant(uuid)) {
+						return;
+					}
+					reserve(0, 0, 1);
+					grant_record& g = grants()[insert_grant(uuid)];
+					g.subject.store(id, std::memory_order_relaxed);
+					g.rights.store(rights, std::memory_order_relaxed);
+					g.expiring.store(0, std::memory_order_relaxed);
+					g.expires_grant.store(0, std::memory_order_relaxed);
+					g.expires.store(0, std::memory_order_relaxed);
+					++m_grant_count;
+					return;
+				}
+				case journal::op::remove_subject:
+					if(!in.get_bytes(key)) {
+						malformed();
+					}
+					remove_subject(key);
+					return;
+				case journal::op::pop:
+				case journal::op::add_member:
+				case journal::op::remove_member:
+					return;
+				default:
+					break;
+			}
+			if(!in.get(uuid) || !in.get(rights)) {
+				malformed();
+			}
+			grant_record* g = find_grant(uuid);
+			if(!g) {
+				return;
+			}
+			std::uint8_t grant = 0;
+			std::int64_t expires = 0;
+			switch(o) {
+				case journal::op::expire:
+					if(!in.get(grant) || !in.get(expires)) {
+						malformed();
+					}
+					g->expiring.store(rights, std::memory_order_relaxed);
+					g->expires_grant.store(grant, std::memory_order_relaxed);
+					g->expires.store(expires, std::memory_order_relaxed);
+					break;
+				case journal::op::allow:
+					g->rights.store(g->rights.load(std::memory_order_relaxed) | rights, std::memory_order_relaxed);
+					g->expiring.store(g->expiring.load(std::memory_order_relaxed) & ~rights, std::memory_order_relaxed);
+					break;
+				case journal::op::forbid:
+					g->rights.store(g->rights.load(std::memory_order_relaxed) & ~rights, std::memory_order_relaxed);
+					break;
+				case journal::op::remove_grant:
+					remove_grant(*g);
+					break;
+				default:
+					malformed();
+			}
+		}
+		/**
+		 * Gets the name of the shared memory object
+		 * @returns `const std::string&`
+		 */
+		const std::string& name() const noexcept {
+			return m_segment.name();
+		}
+		/**
+		 * Gets the number of the updates published so far
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t version() const noexcept {
+			return get_header()->sequence.load(std::memory_order_relaxed) / 2;
+		}
+		/**
+		 * Gets the size of the segment
+		 * @returns `size_t`
+		 */
+		size_t segment_size() const noexcept {
+			return m_segment.size();
+		}
+		/**
+		 * Gets the number of the subjects
+		 * @returns `size_t`
+		 */
+		size_t subject_count() const noexcept {
+			return m_subject_count;
+		}
+		/**
+		 * Gets the number of the grants
+		 * @returns `size_t`
+		 */
+		size_t grant_count() const noexcept {
+			return m_grant_count;
+		}
+};
+
+/**
+ * @brief Queries the acl maintained by `writer` in another process, the segment is mapped read-only.
+ *
+ * A lookup reads the tables in place and is retried if the writer has updated the segment meanwhile,
+ * so the reader sees every update whole and never takes a lock. The grants apply to their owning
+ * subjects only, the role memberships are not shared. If the writer has been stuck in the middle of an
+ * update for too long, e.g. it has died, the checks fail closed. A reader is used by one thread at a time.
+ * \tparam S the type of data stored in subject, serializable
+ */
+template <typename S>
+class reader {
+	static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+	private:
+		// The yields a reader waits for the writer stuck in the middle of an update.
+		static constexpr size_t stall_limit = 1u << 20;
+		details::segment m_segment;
+		std::string m_key;
+		const header* get_header() const noexcept {
+			return reinterpret_cast<const header*>(m_segment.data());
+		}
+		const std::string& key_of(const subjects::subject<S>& sub) {
+			m_key.clear();
+			serialization::serializer<S>::write(m_key, sub.get_id());
+			return m_key;
+		}
+		static std::int64_t now() noexcept {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		}
+		// Runs f(layout) until it has read a stable version, false if the writer has stalled.
+		template <typename F>
+		bool read(F f) noexcept {
+			std::uint64_t stalled_at = 1;
+			size_t waits = 0;
+			for(;;) {
+				const header* h = get_header();
+				const std::uint64_t sequence = h->sequence.load(std::memory_order_acquire);
+				if(sequence & 1) {
+					waits = sequence == stalled_at ? waits + 1 : 0;
+					stalled_at = sequence;
+					if(waits > stall_limit) {
+						return false;
+					}
+					std::this_thread::yield();
+					continue;
+				}
+				details::layout l;
+				const bool resolved = details::resolve(m_segment.data(), m_segment.size(), l);
+				const bool result = resolved && f(l);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if(h->sequence.load(std::memory_order_relaxed) != sequence) {
+					continue;
+				}
+				if(resolved) {
+					return result;
+				}
+				// The segment has grown past the mapping, it is mapped again.
+				if(l.size <= m_segment.size() || !m_segment.map()) {
+					return false;
+				}
+			}
+		}
+		enums::rights effective_rights(const grant_record& g, const std::int64_t at) const noexcept {
+			const enums::rights granted = static_cast<enums::rights>(g.rights.load(std::memory_order_relaxed));
+			const std::int64_t expires = g.expires.load(std::memory_order_relaxed);
+			if(expires == 0 || expires > at) {
+				return granted;
+			}
+			return g.expires_grant.load(std::memory_order_relaxed) ? enums::rights::none :
+				granted & ~static_cast<enums::rights>(g.expiring.load(std::memory_order_relaxed));
+		}
+	public:
+		/**
+		 * Maps the segment created by the writer
+		 * \param name the name of the POSIX shared memory object
+		 */
+		explicit reader(const std::string& name): m_segment(name, false) {
+			if(!m_segment.map() || m_segment.size() < sizeof(header)) {
+				libs::exception::raise("Error: Invalid shared memory: truncated header");
+			}
+			const header* h = get_header();
+			if(std::memcmp(h->magic, segment_magic, sizeof(segment_magic)) != 0) {
+				libs::exception::raise("Error: Invalid shared memory: bad magic");
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(h->version != format_version || h->byte_order != snapshot::byte_order_mark) {
+				libs::exception::raise("Error: Invalid shared memory: unsupported version");
+			}
+		}
+		/**
+		 * Checks whether the specified subject exists.
+		 * \param sub the subject
+		 * @returns `bool`
+		 */
+		bool has_subject(const subjects::subject<S>& sub) {
+			const std::string& key = key_of(sub);
+			const std::uint64_t h = details::hash(key);
+			return read([&](const details::layout& l) {
+				return details::find_subject(l, key, h) != details::npos;
+			});
+		}
+		/**
+		 * Checks whether the specified resource exists within the specified subject.
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * @returns `bool`
+		 */
+		bool has_resource(const subjects::subject<S>& sub, const size_t uuid) {
+			const std::string& key = key_of(sub);
+			const std::uint64_t h = details::hash(key);
+			return read([&](const details::layout& l) {
+				const size_t g = details::find_grant(l, uuid);
+				const size_t s = g == details::npos ? details::npos : details::find_subject(l, key, h);
+				return s != details::npos && l.grants[g].subject.load(std::memory_order_relaxed) == l.subjects[s].id.load(std::memory_order_relaxed);
+			});
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject
+		 * \param sub the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool` returns true if allowed, false vice versa.
+		 */
+		bool is_allowed(const subjects::subject<S>& sub, const size_t uuid, enums::rights required = enums::rights::none) {
+			const std::string& key = key_of(sub);
+			const std::uint64_t h = details::hash(key);
+			const std::int64_t at = now();
+			return read([&](const details::layout& l) {
+				const size_t g = details::find_grant(l, uuid);
+				if(g == details::npos || !enums::access_level(effective_rights(l.grants[g], at)).permits(required)) {
+					return false;
+				}
+				const size_t s = details::find_subject(l, key, h);
+				return s != details::npos && l.grants[g].subject.load(std::memory_order_relaxed) == l.subjects[s].id.load(std::memory_order_relaxed);
+			});
+		}
+		/**
+		 * Checks whether or not the resource is allowed within its owning subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool`
+		 */
+		bool is_allowed(const size_t uuid, enums::rights required = enums::rights::none) noexcept {
+			const std::int64_t at = now();
+			return read([&](const details::layout& l) {
+				const size_t g = details::find_grant(l, uuid);
+				return g != details::npos && l.grants[g].subject.load(std::memory_order_relaxed) != removed &&
+					enums::access_level(effective_rights(l.grants[g], at)).permits(required);
+			});
+		}
+		/**
+		 * Gets the number of the updates the writer has published so far
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t version() const noexcept {
+			return get_header()->sequence.load(std::memory_order_acquire) / 2;
+		}
+		/**
+		 * Gets the number of the subjects
+		 * @returns `size_t`
+		 */
+		size_t subject_count() noexcept {
+			size_t count = 0;
+			read([&](const details::layout&) {
+				count = get_header()->subject_count.load(std::memory_order_relaxed);
+				return true;
+			});
+			return count;
+		}
+		/**
+		 * Gets the number of the grants
+		 * @returns `size_t`
+		 */
+		size_t grant_count() noexcept {
+			size_t count = 0;
+			read([&](const details::layout&) {
+				count = get_header()->grant_count.load(std::memory_order_relaxed);
+				return true;
+			});
+			return count;
+		}
+};
+}
+}
+
+#endif // __SHARED_ACL_HPP__
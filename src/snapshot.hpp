@@ -0,0 +1,795 @@
+#ifndef __SNAPSHOT_HPP__
+#define __SNAPSHOT_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ACL_SNAPSHOT_MMAP 1
+#endif
+
+#include "access_level.hpp"
+#include "exception.hpp"
+#include "serializer.hpp"
+
+/// file: snapshot.hpp
+
+namespace libs {
+	namespace snapshot {
+
+/// The current version of the snapshot format, the older files, written without memberships or expiries, are still read.
+constexpr std::uint32_t format_version = 3;
+/// Marks the native byte order the snapshot has been written in.
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+/// The offset which marks a grant saved without its resource.
+constexpr std::uint64_t no_resource = ~std::uint64_t(0);
+/// The largest next uuid a snapshot is read with, the acl indexes its grants by uuid.
+constexpr std::uint64_t max_next_uuid = std::uint64_t(1) << 32;
+
+/**
+ * @brief The header at the beginning of the snapshot file.
+ *
+ * The header is followed by the subject records sorted by their key bytes, the grant records
+ * sorted by uuid, the role membership records sorted by member, the expiry records sorted by uuid
+ * and the blob of the key and resource bytes, every section is 8 bytes aligned. The checksum covers
+ * everything after the header. The version 1 header ends at `checksum`, its files have no membership
+ * section, the version 2 header ends at `expiry_count`, its files have no expiry section.
+ */
+struct header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint64_t subject_count;
+	std::uint64_t entry_count;
+	std::uint64_t next_uuid;
+	std::uint64_t subjects_offset;
+	std::uint64_t entries_offset;
+	std::uint64_t blob_offset;
+	std::uint64_t file_size;
+	std::uint64_t checksum;
+	std::uint64_t membership_count;
+	std::uint64_t memberships_offset;
+	std::uint64_t expiry_count;
+	std::uint64_t expiries_offset;
+};
+
+/// The size of the version 1 header.
+constexpr size_t header_v1_size = offsetof(header, membership_count);
+/// The size of the version 2 header.
+constexpr size_t header_v2_size = offsetof(header, expiry_count);
+
+/**
+ * @brief A subject record, its key is the serialized id.
+ */
+struct subject_record {
+	std::uint64_t key_offset;
+	std::uint32_t key_size;
+	std::uint32_t reserved;
+};
+
+/**
+ * @brief A grant record.
+ */
+struct entry_record {
+	std::uint64_t uuid;
+	std::uint64_t resource_offset;
+	std::uint32_t resource_size;
+	std::uint32_t subject;
+	std::uint8_t rights;
+	std::uint8_t reserved[7];
+};
+
+/**
+ * @brief A role membership record, both are the indices of the subject records.
+ */
+struct membership_record {
+	std::uint32_t member;
+	std::uint32_t role;
+};
+
+/**
+ * @brief An expiry of a grant, the time is in nanoseconds since the epoch of the system clock.
+ */
+struct expiry_record {
+	std::uint64_t uuid;
+	std::int64_t expires;
+	std::uint8_t expiring;
+	std::uint8_t grant;
+	std::uint8_t reserved[6];
+};
+
+static_assert(sizeof(header) % 8 == 0 && sizeof(subject_record) % 8 == 0 && sizeof(entry_record) % 8 == 0 &&
+		header_v1_size % 8 == 0 && header_v2_size % 8 == 0 && sizeof(membership_record) % 8 == 0 &&
+		sizeof(expiry_record) % 8 == 0,
+		"The snapshot records must keep the sections 8 bytes aligned");
+
+constexpr char file_magic[8] = {'A', 'C', 'L', 'S', 'N', 'A', 'P', '\0'};
+
+/**
+ * Computes the FNV-1a checksum of the bytes
+ * \param data the bytes
+ * \param size the number of the bytes
+ * \param hash the checksum of the preceding bytes, if any
+ * @returns `std::uint64_t`
+ */
+inline std::uint64_t checksum(const char* data, size_t size, std::uint64_t hash = 0xcbf29ce484222325ull) noexcept {
+	for(size_t i = 0; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/**
+ * Compares two keys in the order the subject records are sorted in, i.e. by size then by bytes
+ * @returns `int` negative, zero or positive like `memcmp`
+ */
+inline int compare_keys(std::string_view lhs, std::string_view rhs) noexcept {
+	if(lhs.size() != rhs.size()) {
+		return lhs.size() < rhs.size() ? -1 : 1;
+	}
+	return lhs.size() ? std::memcmp(lhs.data(), rhs.data(), lhs.size()) : 0;
+}
+
+/**
+ * Syncs the directory of the file, so the file renamed into it survives a crash
+ * \param path the path of the file
+ * @returns `bool` false if the directory could not be synced
+ */
+inline bool sync_directory(const std::string& path) {
+#ifdef ACL_SNAPSHOT_MMAP
+	const size_t slash = path.find_last_of('/');
+	const std::string dir = slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : path.substr(0, slash);
+	const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if(fd < 0) {
+		return false;
+	}
+	const bool synced = ::fsync(fd) == 0;
+	::close(fd);
+	return synced;
+#else
+	(void)path;
+	return true;
+#endif
+}
+
+/**
+ * @brief Collects the subjects and grants and writes them into a snapshot file.
+ */
+class writer {
+	private:
+		struct pending_entry {
+			std::uint64_t uuid;
+			std::uint32_t subject;
+			std::uint8_t rights;
+			std::uint64_t resource_offset;
+			std::uint32_t resource_size;
+		};
+		std::vector<std::string> m_keys;
+		std::vector<pending_entry> m_entries;
+		std::vector<membership_record> m_memberships;
+		std::vector<expiry_record> m_expiries;
+		std::string m_resources;
+		std::uint64_t m_next_uuid{1};
+		static void pad(std::string& out) {
+			out.append((8 - out.size() % 8) % 8, '\0');
+		}
+	public:
+		/**
+		 * Adds a subject
+		 * \param key the serialized id of the subject
+		 * @returns `std::uint32_t` the index of the subject within the writer
+		 */
+		std::uint32_t add_subject(std::string key) {
+			m_keys.push_back(std::move(key));
+			return static_cast<std::uint32_t>(m_keys.size() - 1);
+		}
+		/**
+		 * Adds a grant
+		 * \param uuid the uuid of the resource
+		 * \param subject the index returned by `add_subject`
+		 * \param rights the granted rights
+		 * \param resource the serialized resource or nullptr if the resource is not saved
+		 * @returns `void`
+		 */
+		void add_entry(std::uint64_t uuid, std::uint32_t subject, enums::rights rights, const std::string* resource) {
+			pending_entry e{uuid, subject, static_cast<std::uint8_t>(rights), no_resource, 0};
+			if(resource) {
+				e.resource_offset = m_resources.size();
+				e.resource_size = static_cast<std::uint32_t>(resource->size());
+				m_resources.append(*resource);
+			}
+			m_entries.push_back(e);
+		}
+		/**
+		 * Adds a role membership
+		 * \param role the index of the role returned by `add_subject`
+		 * \param member the index of the member returned by `add_subject`
+		 * @returns `void`
+		 */
+		void add_membership(std::uint32_t role, std::uint32_t member) {
+			m_memberships.push_back(membership_record{member, role});
+		}
+		/**
+		 * Adds an expiry of a grant
+		 * \param uuid the uuid of the resource
+		 * \param expires the expiry time in nanoseconds since the epoch of the system clock
+		 * \param expiring the rights which lapse at the expiry
+		 * \param grant whether the whole grant expires
+		 * @returns `void`
+		 */
+		void add_expiry(std::uint64_t uuid, std::int64_t expires, enums::rights expiring, bool grant) {
+			expiry_record e;
+			std::memset(&e, 0, sizeof(e));
+			e.uuid = uuid;
+			e.expires = expires;
+			e.expiring = static_cast<std::uint8_t>(expiring);
+			e.grant = grant;
+			m_expiries.push_back(e);
+		}
+		/**
+		 * Sets the uuid the acl hands out next
+		 * \param uuid the next uuid
+		 * @returns `void`
+		 */
+		void set_next_uuid(std::uint64_t uuid) noexcept {
+			m_next_uuid = uuid;
+		}
+		/**
+		 * Writes the snapshot file
+		 * \param path the path of the file, it is replaced by the renamed `path + ".tmp"` once that is synced
+		 * @returns `void`
+		 */
+		void write(const std::string& path) {
+			std::vector<std::uint32_t> order(m_keys.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
+				return compare_keys(m_keys[lhs], m_keys[rhs]) < 0;
+			});
+			std::vector<std::uint32_t> position(m_keys.size());
+			for(std::uint32_t i = 0; i < order.size(); ++i) {
+				position[order[i]] = i;
+			}
+			std::sort(m_entries.begin(), m_entries.end(), [](const pending_entry& lhs, const pending_entry& rhs) {
+				return lhs.uuid < rhs.uuid;
+			});
+
+			for(membership_record& m : m_memberships) {
+				m = membership_record{position[m.member], position[m.role]};
+			}
+			std::sort(m_memberships.begin(), m_memberships.end(), [](const membership_record& lhs, const membership_record& rhs) {
+				return lhs.member != rhs.member ? lhs.member < rhs.member : lhs.role < rhs.role;
+			});
+			std::sort(m_expiries.begin(), m_expiries.end(), [](const expiry_record& lhs, const expiry_record& rhs) {
+				return lhs.uuid < rhs.uuid;
+			});
+
+			std::string blob;
+			std::vector<subject_record> subjects(order.size());
+			for(std::uint32_t i = 0; i < order.size(); ++i) {
+				const std::string& key = m_keys[order[i]];
+				subjects[i] = subject_record{blob.size(), static_cast<std::uint32_t>(key.size()), 0};
+				blob.append(key);
+			}
+			const std::uint64_t resources_base = blob.size();
+			blob.append(m_resources);
+			pad(blob);
+			std::vector<entry_record> entries(m_entries.size());
+			for(size_t i = 0; i < m_entries.size(); ++i) {
+				const pending_entry& e = m_entries[i];
+				entry_record& r = entries[i];
+				std::memset(&r, 0, sizeof(r));
+				r.uuid = e.uuid;
+				r.subject = position[e.subject];
+				r.rights = e.rights;
+				r.resource_offset = e.resource_offset == no_resource ? no_resource : resources_base + e.resource_offset;
+				r.resource_size = e.resource_size;
+			}
+
+			header h;
+			std::memset(&h, 0, sizeof(h));
+			std::memcpy(h.magic, file_magic, sizeof(h.magic));
+			h.version = format_version;
+			h.byte_order = byte_order_mark;
+			h.subject_count = subjects.size();
+			h.entry_count = entries.size();
+			h.next_uuid = m_next_uuid;
+			h.subjects_offset = sizeof(header);
+			h.entries_offset = h.subjects_offset + subjects.size() * sizeof(subject_record);
+			h.membership_count = m_memberships.size();
+			h.memberships_offset = h.entries_offset + entries.size() * sizeof(entry_record);
+			h.expiry_count = m_expiries.size();
+			h.expiries_offset = h.memberships_offset + m_memberships.size() * sizeof(membership_record);
+			h.blob_offset = h.expiries_offset + m_expiries.size() * sizeof(expiry_record);
+			h.file_size = h.blob_offset + blob.size();
+			const char* subjects_data = reinterpret_cast<const char*>(subjects.data());
+			const char* entries_data = reinterpret_cast<const char*>(entries.data());
+			const char* memberships_data = reinterpret_cast<const char*>(m_memberships.data());
+			const char* expiries_data = reinterpret_cast<const char*>(m_expiries.data());
+			h.checksum = checksum(subjects_data, subjects.size() * sizeof(subject_record));
+			h.checksum = checksum(entries_data, entries.size() * sizeof(entry_record), h.checksum);
+			h.checksum = checksum(memberships_data, m_memberships.size() * sizeof(membership_record), h.checksum);
+			h.checksum = checksum(expiries_data, m_expiries.size() * sizeof(expiry_record), h.checksum);
+			h.checksum = checksum(blob.data(), blob.size(), h.checksum);
+
+			// Written aside and renamed over the target, so a crash leaves either the old or the new snapshot
+			// and the views mapping the old file keep reading it.
+			const std::string temp = path + ".tmp";
+			std::FILE* out = std::fopen(temp.c_str(), "wb");
+			bool written = out != nullptr;
+			if(out) {
+				const std::string_view parts[] = {
+					std::string_view(reinterpret_cast<const char*>(&h), sizeof(h)),
+					std::string_view(subjects_data, subjects.size() * sizeof(subject_record)),
+					std::string_view(entries_data, entries.size() * sizeof(entry_record)),
+					std::string_view(memberships_data, m_memberships.size() * sizeof(membership_record)),
+					std::string_view(expiries_data, m_expiries.size() * sizeof(expiry_record)),
+					std::string_view(blob)
+				};
+				for(const std::string_view part : parts) {
+					written = written && (part.empty() || std::fwrite(part.data(), 1, part.size(), out) == part.size());
+				}
+				written = std::fflush(out) == 0 && written;
+#ifdef ACL_SNAPSHOT_MMAP
+				written = written && ::fsync(::fileno(out)) == 0;
+#endif
+				written = std::fclose(out) == 0 && written;
+			}
+			if(!written || std::rename(temp.c_str(), path.c_str()) != 0 || !sync_directory(path)) {
+				std::remove(temp.c_str());
+				std::string msg = std::string("Error: Could not write the snapshot: ") + path;
+				libs::exception::raise(msg.c_str());
+			}
+		}
+};
+
+/**
+ * @brief Maps a file read-only into the memory, reads it into a buffer where mmap is unavailable.
+ */
+class mapped_file {
+	private:
+		const char* m_data{nullptr};
+		size_t m_size{};
+		std::string m_buffer;
+	public:
+		/**
+		 * The constructor with the path of the file
+		 * \param path the path of the file
+		 */
+		explicit mapped_file(const std::string& path) {
+#ifdef ACL_SNAPSHOT_MMAP
+			int fd = ::open(path.c_str(), O_RDONLY);
+			struct stat st;
+			if(fd >= 0 && ::fstat(fd, &st) == 0) {
+				m_size = static_cast<size_t>(st.st_size);
+				void* addr = m_size ? ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+				::close(fd);
+				if(addr != MAP_FAILED) {
+					m_data = static_cast<const char*>(addr);
+					return;
+				}
+			} else if(fd >= 0) {
+				::close(fd);
+			}
+			m_size = 0;
+#endif
+			std::ifstream in(path, std::ios::binary);
+			if(!in) {
+				std::string msg = std::string("Error: Could not open the file: ") + path;
+				libs::exception::raise(msg.c_str());
+			}
+			m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+		}
+		/**
+		 * The copy constructor deleted
+		 */
+		mapped_file(const mapped_file&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		mapped_file& operator=(const mapped_file&) = delete;
+		~mapped_file() {
+#ifdef ACL_SNAPSHOT_MMAP
+			if(m_data && m_buffer.empty()) {
+				::munmap(const_cast<char*>(m_data), m_size);
+			}
+#endif
+		}
+		const char* data() const noexcept {
+			return m_data;
+		}
+		size_t size() const noexcept {
+			return m_size;
+		}
+};
+
+/**
+ * @brief Queries a snapshot file in place, read-only.
+ *
+ * The subjects are found by a binary search over their serialized ids, the grants by a binary
+ * search over their uuids, nothing is copied out of the mapping.
+ * \tparam S the type of data stored in subject
+ */
+template <typename S>
+class view {
+	static_assert(serialization::is_serializable<S>, "The subject type must have a serializer");
+	private:
+		mapped_file m_file;
+		const header* m_header{nullptr};
+		const subject_record* m_subjects{nullptr};
+		const entry_record* m_entries{nullptr};
+		const membership_record* m_memberships{nullptr};
+		size_t m_membership_count{};
+		const expiry_record* m_expiries{nullptr};
+		size_t m_expiry_count{};
+		const char* m_blob{nullptr};
+		static void fail(const char* what) {
+			std::string msg = std::string("Error: Invalid snapshot: ") + what;
+			libs::exception::raise(msg.c_str());
+		}
+		std::string_view key(const subject_record& r) const noexcept {
+			return std::string_view(m_blob + r.key_offset, r.key_size);
+		}
+		// Gets the offset past the records of the section, fails unless all of them fit in the file.
+		static std::uint64_t section_end(const std::uint64_t offset, const std::uint64_t count, const size_t record,
+				const std::uint64_t size) {
+			if(offset > size || count > (size - offset) / record) {
+				fail("inconsistent layout");
+			}
+			return offset + count * record;
+		}
+		// Finds the subject record of the serialized id, compared in place with the mapped keys.
+		std::uint32_t find_key(const std::string_view bytes) const noexcept {
+			const subject_record* first = m_subjects;
+			const subject_record* last = m_subjects + m_header->subject_count;
+			const subject_record* it = std::lower_bound(first, last, bytes, [this](const subject_record& r, std::string_view k) {
+				return compare_keys(key(r), k) < 0;
+			});
+			return it != last && compare_keys(key(*it), bytes) == 0 ? static_cast<std::uint32_t>(it - first) : npos;
+		}
+		// Gets the first membership record of the member, the records of a member are adjacent.
+		const membership_record* first_role(const std::uint32_t member) const noexcept {
+			return std::lower_bound(m_memberships, m_memberships + m_membership_count, member,
+					[](const membership_record& m, std::uint32_t s) {
+				return m.member < s;
+			});
+		}
+		// Walks the role graphs too large for the inline walk of `is_member`.
+		bool is_member_wide(const std::uint32_t member, const std::uint32_t role) const {
+			std::vector<std::uint32_t> pending{member};
+			std::vector<bool> seen(m_header->subject_count);
+			const membership_record* last = m_memberships + m_membership_count;
+			while(!pending.empty()) {
+				const std::uint32_t current = pending.back();
+				pending.pop_back();
+				for(const membership_record* it = first_role(current); it != last && it->member == current; ++it) {
+					if(it->role == role) {
+						return true;
+					}
+					if(!seen[it->role]) {
+						seen[it->role] = true;
+						pending.push_back(it->role);
+					}
+				}
+			}
+			return false;
+		}
+	public:
+		/// The index value which marks a missing subject.
+		static constexpr std::uint32_t npos = ~std::uint32_t(0);
+		/**
+		 * Opens and validates the snapshot file
+		 * \param path the path of the file
+		 * \param verify whether to verify the checksum, it reads the whole file
+		 */
+		explicit view(const std::string& path, bool verify = true): m_file(path) {
+			const char* base = m_file.data();
+			if(m_file.size() < header_v1_size) {
+				fail("truncated header");
+			}
+			m_header = reinterpret_cast<const header*>(base);
+			if(std::memcmp(m_header->magic, file_magic, sizeof(file_magic)) != 0) {
+				fail("bad magic");
+			}
+			if(m_header->version < 1 || m_header->version > format_version) {
+				fail("unsupported version");
+			}
+			if(m_header->byte_order != byte_order_mark) {
+				fail("foreign byte order");
+			}
+			// The fields past the version 1 header are read only from the newer files.
+			const size_t header_size = m_header->version == 1 ? header_v1_size :
+				m_header->version == 2 ? header_v2_size : sizeof(header);
+			if(m_file.size() < header_size) {
+				fail("truncated header");
+			}
+			const std::uint64_t size = m_file.size();
+			if(m_header->file_size != size || m_header->subjects_offset != header_size) {
+				fail("inconsistent layout");
+			}
+			// Every section follows the previous one, the counts are checked against the room left in the file.
+			const std::uint64_t entries_offset = section_end(header_size, m_header->subject_count, sizeof(subject_record), size);
+			if(m_header->entries_offset != entries_offset) {
+				fail("inconsistent layout");
+			}
+			const std::uint64_t memberships_offset = section_end(entries_offset, m_header->entry_count, sizeof(entry_record), size);
+			if(m_header->version >= 2) {
+				if(m_header->memberships_offset != memberships_offset) {
+					fail("inconsistent layout");
+				}
+				m_membership_count = m_header->membership_count;
+			}
+			const std::uint64_t expiries_offset = section_end(memberships_offset, m_membership_count, sizeof(membership_record), size);
+			if(m_header->version >= 3) {
+				if(m_header->expiries_offset != expiries_offset) {
+					fail("inconsistent layout");
+				}
+				m_expiry_count = m_header->expiry_count;
+			}
+			if(m_header->blob_offset != section_end(expiries_offset, m_expiry_count, sizeof(expiry_record), size)) {
+				fail("inconsistent layout");
+			}
+			if(verify && checksum(base + header_size, m_file.size() - header_size) != m_header->checksum) {
+				fail("checksum mismatch");
+			}
+			m_subjects = reinterpret_cast<const subject_record*>(base + m_header->subjects_offset);
+			m_entries = reinterpret_cast<const entry_record*>(base + m_header->entries_offset);
+			m_memberships = reinterpret_cast<const membership_record*>(base + memberships_offset);
+			m_expiries = reinterpret_cast<const expiry_record*>(base + expiries_offset);
+			m_blob = base + m_header->blob_offset;
+			const size_t blob_size = m_file.size() - m_header->blob_offset;
+			for(std::uint64_t i = 0; i < m_header->subject_count; ++i) {
+				if(m_subjects[i].key_offset > blob_size || m_subjects[i].key_size > blob_size - m_subjects[i].key_offset) {
+					fail("subject out of bounds");
+				}
+			}
+			if(m_header->next_uuid == 0 || m_header->next_uuid > max_next_uuid) {
+				fail("next uuid out of bounds");
+			}
+			// The grants are searched by uuid, so the uuids must strictly increase and none could be handed out again.
+			std::uint64_t previous = 0;
+			for(std::uint64_t i = 0; i < m_header->entry_count; ++i) {
+				const entry_record& e = m_entries[i];
+				if(e.uuid <= previous || e.uuid >= m_header->next_uuid) {
+					fail("invalid uuid");
+				}
+				previous = e.uuid;
+				if(e.subject >= m_header->subject_count ||
+						(e.resource_offset != no_resource &&
+							(e.resource_offset > blob_size || e.resource_size > blob_size - e.resource_offset))) {
+					fail("entry out of bounds");
+				}
+			}
+			for(size_t i = 0; i < m_membership_count; ++i) {
+				if(m_memberships[i].member >= m_header->subject_count || m_memberships[i].role >= m_header->subject_count) {
+					fail("membership out of bounds");
+				}
+			}
+		}
+		/**
+		 * Finds the subject record
+		 * \param id the id of the subject
+		 * @returns `std::uint32_t` the index of the subject or `npos`
+		 */
+		std::uint32_t find_subject(const S& id) const {
+			if constexpr(serialization::has_bytes<S>::value) {
+				return find_key(serialization::serializer<S>::bytes(id));
+			} else {
+				// Reused by the lookups of the thread, only the custom serializers need a copy.
+				thread_local std::string bytes;
+				bytes.clear();
+				serialization::serializer<S>::write(bytes, id);
+				return find_key(bytes);
+			}
+		}
+		/**
+		 * Finds the grant record
+		 * \param uuid the uuid of the resource
+		 * @returns `const entry_record*` the record or nullptr
+		 */
+		const entry_record* find_entry(const size_t uuid) const noexcept {
+			const entry_record* first = m_entries;
+			const entry_record* last = m_entries + m_header->entry_count;
+			const entry_record* it = std::lower_bound(first, last, uuid, [](const entry_record& e, size_t u) {
+				return e.uuid < u;
+			});
+			return it != last && it->uuid == uuid ? it : nullptr;
+		}
+		/**
+		 * Finds the expiry record
+		 * \param uuid the uuid of the resource
+		 * @returns `const expiry_record*` the record or nullptr if the grant does not expire
+		 */
+		const expiry_record* find_expiry(const size_t uuid) const noexcept {
+			const expiry_record* first = m_expiries;
+			const expiry_record* last = m_expiries + m_expiry_count;
+			const expiry_record* it = std::lower_bound(first, last, uuid, [](const expiry_record& e, size_t u) {
+				return e.uuid < u;
+			});
+			return it != last && it->uuid == uuid ? it : nullptr;
+		}
+		/**
+		 * Gets the rights of the grant in effect now, the expired ones are forbidden
+		 * \param e the grant record
+		 * @returns `enums::rights`
+		 */
+		enums::rights effective_rights(const entry_record& e) const noexcept {
+			const enums::rights granted = static_cast<enums::rights>(e.rights);
+			if(m_expiry_count == 0) {
+				return granted;
+			}
+			const expiry_record* x = find_expiry(e.uuid);
+			if(!x || x->expires > std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::system_clock::now().time_since_epoch()).count()) {
+				return granted;
+			}
+			return x->grant ? enums::rights::none : granted & ~static_cast<enums::rights>(x->expiring);
+		}
+		/**
+		 * Checks whether the subject belongs to the role, directly or through the nested roles
+		 * \param member the index of the subject
+		 * \param role the index of the role
+		 * @returns `bool`
+		 */
+		bool is_member(const std::uint32_t member, const std::uint32_t role) const {
+			// Walks the memberships sorted by member, the snapshot keeps no precomputed closures.
+			if(member == npos || role == npos || m_membership_count == 0) {
+				return false;
+			}
+			// The roles walked so far are both the queue and the visited set, kept inline for the usual shallow roles.
+			constexpr size_t inline_roles = 32;
+			std::uint32_t walked[inline_roles];
+			size_t count = 0;
+			walked[count++] = member;
+			const membership_record* last = m_memberships + m_membership_count;
+			for(size_t i = 0; i < count; ++i) {
+				const std::uint32_t current = walked[i];
+				for(const membership_record* it = first_role(current); it != last && it->member == current; ++it) {
+					if(it->role == role) {
+						return true;
+					}
+					if(std::find(walked, walked + count, it->role) == walked + count) {
+						if(count == inline_roles) {
+							return is_member_wide(member, role);
+						}
+						walked[count++] = it->role;
+					}
+				}
+			}
+			return false;
+		}
+		/**
+		 * Checks whether the specified subject exists.
+		 * \param id the id of the subject
+		 * @returns `bool`
+		 */
+		bool has_subject(const S& id) const {
+			return find_subject(id) != npos;
+		}
+		/**
+		 * Checks whether the specified resource exists within the specified subject.
+		 * \param id the id of the subject
+		 * \param uuid the uuid of the resource
+		 * @returns `bool`
+		 */
+		bool has_resource(const S& id, const size_t uuid) const {
+			const entry_record* e = find_entry(uuid);
+			return e && e->subject == find_subject(id);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within the specified subject or one of its roles
+		 * \param id the id of the subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool`
+		 */
+		bool is_allowed(const S& id, const size_t uuid, enums::rights required = enums::rights::none) const {
+			const entry_record* e = find_entry(uuid);
+			if(!e || !enums::access_level(effective_rights(*e)).permits(required)) {
+				return false;
+			}
+			const std::uint32_t subject = find_subject(id);
+			return e->subject == subject || is_member(subject, e->subject);
+		}
+		/**
+		 * Checks whether or not the resource is allowed within its owning subject
+		 * \param uuid the uuid of the resource
+		 * \param required the rights to check, by default any granted right is enough
+		 * @returns `bool`
+		 */
+		bool is_allowed(const size_t uuid, enums::rights required = enums::rights::none) const noexcept {
+			const entry_record* e = find_entry(uuid);
+			return e && enums::access_level(effective_rights(*e)).permits(required);
+		}
+		/**
+		 * Gets the serialized id of the subject
+		 * \param index the index of the subject
+		 * @returns `std::string_view`
+		 */
+		std::string_view subject_key(const std::uint32_t index) const noexcept {
+			return key(m_subjects[index]);
+		}
+		/**
+		 * Gets the serialized resource of the grant
+		 * \param e the grant record
+		 * @returns `std::string_view` empty if the resource has not been saved
+		 */
+		std::string_view resource_bytes(const entry_record& e) const noexcept {
+			return e.resource_offset == no_resource ? std::string_view() : std::string_view(m_blob + e.resource_offset, e.resource_size);
+		}
+		/**
+		 * Gets the grant records sorted by uuid
+		 * @returns `const entry_record*`
+		 */
+		const entry_record* entries() const noexcept {
+			return m_entries;
+		}
+		/**
+		 * Gets the role membership records sorted by member
+		 * @returns `const membership_record*`
+		 */
+		const membership_record* memberships() const noexcept {
+			return m_memberships;
+		}
+		/**
+		 * Gets the number of the role memberships
+		 * @returns `size_t`
+		 */
+		size_t membership_count() const noexcept {
+			return m_membership_count;
+		}
+		/**
+		 * Gets the expiry records sorted by uuid
+		 * @returns `const expiry_record*`
+		 */
+		const expiry_record* expiries() const noexcept {
+			return m_expiries;
+		}
+		/**
+		 * Gets the number of the expiring grants
+		 * @returns `size_t`
+		 */
+		size_t expiry_count() const noexcept {
+			return m_expiry_count;
+		}
+		/**
+		 * Gets the number of the subjects
+		 * @returns `size_t`
+		 */
+		size_t subject_count() const noexcept {
+			return m_header->subject_count;
+		}
+		/**
+		 * Gets the number of the grants
+		 * @returns `size_t`
+		 */
+		size_t entry_count() const noexcept {
+			return m_header->entry_count;
+		}
+		/**
+		 * Gets the uuid the saved acl would have handed out next
+		 * @returns `size_t`
+		 */
+		size_t next_uuid() const noexcept {
+			return m_header->next_uuid;
+		}
+};
+}
+}
+
+#endif // __SNAPSHOT_HPP__
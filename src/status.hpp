@@ -0,0 +1,127 @@
+#ifndef __STATUS_HPP__
+#define __STATUS_HPP__
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/// file: status.hpp
+
+namespace libs {
+	namespace status {
+
+/**
+ * @brief Enumerates the errors reported by the `try_*` calls instead of raising them.
+ */
+enum class code : std::uint8_t {
+	ok,
+	// The subject holds no id.
+	invalid_subject,
+	// The subject has never been added or has been removed.
+	unknown_subject,
+	// The resource does not exist within the subject.
+	unknown_resource,
+	// The resource to add is null.
+	invalid_resource,
+	// The access level specifier could not be parsed.
+	invalid_access_level,
+	// The role membership would make a cycle of roles.
+	role_cycle,
+	// An allocation failed.
+	out_of_memory,
+	// The attached journal or shared segment could not be written.
+	io_error
+};
+
+/**
+ * Gets the message of the code
+ * \param c the code
+ * @returns `const char*` a static string
+ */
+constexpr const char* message(const code c) noexcept {
+	switch(c) {
+		case code::ok:
+			return "Ok";
+		case code::invalid_subject:
+			return "Error: Invalid subject";
+		case code::unknown_subject:
+			return "Error: Unknown subject";
+		case code::unknown_resource:
+			return "Error: Unknown resource";
+		case code::invalid_resource:
+			return "Error: Invalid resource";
+		case code::invalid_access_level:
+			return "Error: Invalid access level specifier";
+		case code::role_cycle:
+			return "Error: The membership would make a cycle of roles";
+		case code::out_of_memory:
+			return "Error: Out of memory";
+		case code::io_error:
+			return "Error: Could not write the journal or the shared segment";
+	}
+	return "Error: Unknown error";
+}
+
+/**
+ * @brief Holds either the value or the error code, in the manner of `std::expected`.
+ * \tparam T the type of the value, default constructible
+ */
+template <typename T>
+class result {
+	private:
+		T m_value{};
+		code m_code{code::ok};
+	public:
+		/**
+		 * The constructor with the value
+		 * \param value the value
+		 */
+		constexpr result(T value) noexcept(std::is_nothrow_move_constructible<T>::value): m_value(std::move(value)) {}
+		/**
+		 * The constructor with the error
+		 * \param c the error code, not `code::ok`
+		 */
+		constexpr result(const code c) noexcept: m_code(c) {}
+		/**
+		 * Checks whether the result holds the value
+		 * @returns `bool`
+		 */
+		constexpr bool has_value() const noexcept {
+			return m_code == code::ok;
+		}
+		constexpr explicit operator bool() const noexcept {
+			return has_value();
+		}
+		/**
+		 * Gets the value, valid only if the result holds one
+		 * @returns `T&`
+		 */
+		constexpr T& value() & noexcept {
+			return m_value;
+		}
+		constexpr const T& value() const & noexcept {
+			return m_value;
+		}
+		constexpr T&& value() && noexcept {
+			return std::move(m_value);
+		}
+		/**
+		 * Gets the value or the fallback if the result holds the error
+		 * \param fallback the fallback value
+		 * @returns `T`
+		 */
+		constexpr T value_or(T fallback) const & {
+			return has_value() ? m_value : fallback;
+		}
+		/**
+		 * Gets the error code
+		 * @returns `code` `code::ok` if the result holds the value
+		 */
+		constexpr code error() const noexcept {
+			return m_code;
+		}
+};
+}
+}
+
+#endif // __STATUS_HPP__
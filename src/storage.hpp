@@ -0,0 +1,394 @@
+#ifndef __STORAGE_HPP__
+#define __STORAGE_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "access_level.hpp"
+#include "resource.hpp"
+
+/// file: storage.hpp
+
+namespace libs {
+	namespace storage {
+
+/// The index value which marks a missing slot or the end of a slot list.
+constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+/**
+ * Hints the cpu to fetch the cache line of the address for a read
+ * \param ptr the address
+ * @returns `void`
+ */
+inline void prefetch(const void* ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(ptr, 0, 3);
+#else
+	(void)ptr;
+#endif
+}
+
+/**
+ * @brief Keeps the list of slots owned by a single subject.
+ */
+struct subject_slots {
+	std::uint32_t head{npos};
+	std::uint32_t count{};
+	bool present{};
+};
+
+/**
+ * @brief A single grant, i.e. the resource of a subject along with its access level.
+ *
+ * The fields a check reads come first, the small resources are kept in place right after them.
+ * \tparam R the type of data stored in resource
+ */
+template <typename R>
+struct slot {
+	size_t uuid{};
+	std::uint32_t subject{npos};
+	enums::access_level access;
+	// The rights which lapse at the expiry, unless the whole grant does.
+	enums::rights expiring{};
+	bool expires_grant{};
+	// The expiry time in nanoseconds since the epoch of the system clock, 0 if the grant does not expire.
+	std::int64_t expires{};
+	resources::payload<R> resource;
+	// Bumped on release, so the expiry timers scheduled for the earlier grants of the slot are told apart.
+	std::uint32_t generation{};
+	std::uint32_t prev{npos};
+	std::uint32_t next{npos};
+};
+
+/**
+ * @brief Stores the grants in a contiguous slot array, found by the resource uuid.
+ *
+ * The uuids are mapped to the slots by an open addressing table with linear probing, which is resized
+ * between an eighth and a half full, so it follows the live grants rather than the uuids ever handed out.
+ * Released slots are chained into a free list and reused, their generation is bumped on release.
+ * \tparam R the type of data stored in resource
+ */
+template <typename R>
+class grant_store {
+	private:
+		// An entry of the uuid index, the uuid 0 marks the empty one.
+		struct index_entry {
+			size_t uuid{};
+			std::uint32_t slot{npos};
+		};
+		static constexpr size_t min_buckets = 16;
+		std::pmr::vector<slot<R>> m_slots;
+		std::pmr::vector<index_entry> m_index;
+		unsigned m_shift{};
+		std::uint32_t m_free{npos};
+		size_t m_size{};
+		size_t home(const size_t uuid) const noexcept {
+			// Fibonacci hashing, the consecutive uuids land far apart while the high bits pick the bucket.
+			return static_cast<size_t>((static_cast<std::uint64_t>(uuid) * 0x9e3779b97f4a7c15ull) >> m_shift);
+		}
+		size_t position(const size_t uuid) const noexcept {
+			const size_t mask = m_index.size() - 1;
+			for(size_t i = home(uuid); ; i = (i + 1) & mask) {
+				if(m_index[i].uuid == uuid || m_index[i].uuid == 0) {
+					return i;
+				}
+			}
+		}
+		// The index must have room for the uuid.
+		void insert_index(const size_t uuid, const std::uint32_t index) noexcept {
+			m_index[position(uuid)] = index_entry{uuid, index};
+		}
+		void erase_index(const size_t uuid) noexcept {
+			// Shifts the later entries of the probe run back, so the index needs no tombstones.
+			const size_t mask = m_index.size() - 1;
+			size_t i = position(uuid);
+			if(m_index[i].uuid == 0) {
+				return;
+			}
+			for(size_t j = (i + 1) & mask; m_index[j].uuid != 0; j = (j + 1) & mask) {
+				const size_t k = home(m_index[j].uuid);
+				if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+					continue;
+				}
+				m_index[i] = m_index[j];
+				i = j;
+			}
+			m_index[i] = index_entry{};
+		}
+		void rehash(const size_t buckets) {
+			std::pmr::vector<index_entry> index(buckets, m_index.get_allocator());
+			std::swap(m_index, index);
+			m_shift = 64;
+			for(size_t b = buckets; b > 1; b >>= 1) {
+				--m_shift;
+			}
+			for(const index_entry& e : index) {
+				if(e.uuid != 0) {
+					insert_index(e.uuid, e.slot);
+				}
+			}
+		}
+		// Resizes the index for the number of the uuids unless it would be between an eighth and a half full.
+		void fit_index(const size_t count) {
+			const size_t buckets = m_index.size();
+			if(2 * count <= buckets && (8 * count >= buckets || buckets == min_buckets)) {
+				return;
+			}
+			size_t target = min_buckets;
+			while(target < 4 * count) {
+				target *= 2;
+			}
+			rehash(target);
+		}
+	public:
+		/**
+		 * The constructor with the memory resource of the store
+		 * \param mr the memory resource, by default the default one
+		 */
+		explicit grant_store(std::pmr::memory_resource* mr = std::pmr::get_default_resource()):
+			m_slots(mr), m_index(mr) {
+			rehash(min_buckets);
+		}
+		/**
+		 * Finds the slot of the specified uuid
+		 * \param uuid the uuid of the resource
+		 * @returns `slot<R>*` the slot or nullptr if the uuid is not stored
+		 */
+		slot<R>* find(const size_t uuid) noexcept {
+			if(uuid == 0) {
+				return nullptr;
+			}
+			const index_entry& e = m_index[position(uuid)];
+			return e.uuid == 0 ? nullptr : &m_slots[e.slot];
+		}
+		/**
+		 * Finds the slot of the specified uuid
+		 * \param uuid the uuid of the resource
+		 * @returns `const slot<R>*` the slot or nullptr if the uuid is not stored
+		 */
+		const slot<R>* find(const size_t uuid) const noexcept {
+			return const_cast<grant_store*>(this)->find(uuid);
+		}
+		/**
+		 * Prefetches the index entry of the uuid
+		 * \param uuid the uuid of the resource
+		 * @returns `void`
+		 */
+		void prefetch_index(const size_t uuid) const noexcept {
+			prefetch(&m_index[home(uuid)]);
+		}
+		/**
+		 * Prefetches the slot of the uuid, pays off once the index entry is in the cache
+		 * \param uuid the uuid of the resource
+		 * @returns `void`
+		 */
+		void prefetch_slot(const size_t uuid) const noexcept {
+			if(const slot<R>* s = find(uuid)) {
+				prefetch(s);
+			}
+		}
+		/**
+		 * Acquires a slot for the uuid and links it to the subject's list
+		 * \param uuid the uuid of the resource
+		 * \param owner the subject's list
+		 * \param subject the index of the subject
+		 * @returns `slot<R>&` the acquired slot
+		 */
+		slot<R>& acquire(const size_t uuid, subject_slots& owner, const std::uint32_t subject) {
+			// Acquires a slot in O(1) - amortized. The index makes room first, so a failure leaves the slots as they were.
+			fit_index(m_size + 1);
+			std::uint32_t index = m_free;
+			if(index != npos) {
+				m_free = m_slots[index].next;
+			} else {
+				index = static_cast<std::uint32_t>(m_slots.size());
+				m_slots.emplace_back();
+			}
+			insert_index(uuid, index);
+			slot<R>& s = assign(index, uuid, subject);
+			link(index, owner);
+			++m_size;
+			return s;
+		}
+		/**
+		 * Appends the unlinked slots for a contiguous block of uuids, the free slots are left for the later adds.
+		 * The uuids are indexed at once, the slots are filled by `assign` and linked by `link`, all of them count as stored.
+		 * \param first_uuid the first uuid of the block
+		 * \param count the number of the uuids
+		 * @returns `std::uint32_t` the index of the slot of the first uuid
+		 */
+		std::uint32_t extend(const size_t first_uuid, const size_t count) {
+			fit_index(m_size + count);
+			const std::uint32_t first = static_cast<std::uint32_t>(m_slots.size());
+			m_slots.resize(m_slots.size() + count);
+			for(size_t i = 0; i < count; ++i) {
+				insert_index(first_uuid + i, static_cast<std::uint32_t>(first + i));
+			}
+			m_size += count;
+			return first;
+		}
+		/**
+		 * Assigns the indexed slot to the uuid, the distinct slots could be assigned concurrently
+		 * \param index the index of the slot returned by `extend` plus its offset in the block
+		 * \param uuid the uuid of the resource
+		 * \param subject the index of the subject
+		 * @returns `slot<R>&` the slot
+		 */
+		slot<R>& assign(const std::uint32_t index, const size_t uuid, const std::uint32_t subject) noexcept {
+			slot<R>& s = m_slots[index];
+			s.uuid = uuid;
+			s.subject = subject;
+			return s;
+		}
+		/**
+		 * Links the assigned slot to the subject's list
+		 * \param index the index of the slot
+		 * \param owner the subject's list
+		 * @returns `void`
+		 */
+		void link(const std::uint32_t index, subject_slots& owner) noexcept {
+			slot<R>& s = m_slots[index];
+			s.prev = npos;
+			s.next = owner.head;
+			if(owner.head != npos) {
+				m_slots[owner.head].prev = index;
+			}
+			owner.head = index;
+			++owner.count;
+		}
+		/**
+		 * Unlinks the slot from the subject's list and releases it for reuse
+		 * \param s the slot
+		 * \param owner the subject's list
+		 * @returns `resources::payload<R>` the data of the resource held by the slot
+		 */
+		resources::payload<R> release(slot<R>& s, subject_slots& owner) noexcept {
+			// Releases the slot in O(1).
+			const std::uint32_t index = static_cast<std::uint32_t>(&s - m_slots.data());
+			if(s.prev != npos) {
+				m_slots[s.prev].next = s.next;
+			} else {
+				owner.head = s.next;
+			}
+			if(s.next != npos) {
+				m_slots[s.next].prev = s.prev;
+			}
+			--owner.count;
+			--m_size;
+			erase_index(s.uuid);
+			resources::payload<R> res = std::move(s.resource);
+			s.uuid = 0;
+			s.subject = npos;
+			s.prev = npos;
+			s.access = enums::access_level();
+			s.expires = 0;
+			s.expiring = enums::rights::none;
+			s.expires_grant = false;
+			++s.generation;
+			s.next = m_free;
+			m_free = index;
+			return res;
+		}
+		/**
+		 * Releases all the slots of the subject's list
+		 * \param owner the subject's list
+		 * @returns `void`
+		 */
+		void release_all(subject_slots& owner) noexcept {
+			while(owner.head != npos) {
+				release(m_slots[owner.head], owner);
+			}
+		}
+		/**
+		 * Reserves the room for the grants
+		 * \param grants the number of the grants
+		 * @returns `void`
+		 */
+		void reserve(const size_t grants) {
+			m_slots.reserve(grants);
+			fit_index(m_size + grants);
+		}
+		/**
+		 * Calls the function for every stored grant in the ascending order of the uuids
+		 * \param f the function taking `const slot<R>&`
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each(F f) const {
+			std::vector<std::pair<size_t, std::uint32_t>> order;
+			order.reserve(m_size);
+			for(const index_entry& e : m_index) {
+				if(e.uuid != 0) {
+					order.emplace_back(e.uuid, e.slot);
+				}
+			}
+			std::sort(order.begin(), order.end());
+			for(const std::pair<size_t, std::uint32_t>& o : order) {
+				f(m_slots[o.second]);
+			}
+		}
+		/**
+		 * Calls the function for every stored grant among the slots [from, to) in the order of the slot array,
+		 * i.e. sequentially through the memory, the released slots are skipped
+		 * \param from the first index of the slots
+		 * \param to the index past the last slot, at most `slot_count()`
+		 * \param f the function taking `const slot<R>&`
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each_slot(const size_t from, const size_t to, F f) const {
+			for(size_t i = from; i < to; ++i) {
+				if(m_slots[i].uuid != 0) {
+					f(m_slots[i]);
+				}
+			}
+		}
+		/**
+		 * Calls the function for every grant of the subject's list, the latest added first
+		 * \param owner the subject's list
+		 * \param f the function taking `const slot<R>&`
+		 * @returns `void`
+		 */
+		template <typename F>
+		void for_each_owned(const subject_slots& owner, F f) const {
+			for(std::uint32_t i = owner.head; i != npos; i = m_slots[i].next) {
+				f(m_slots[i]);
+			}
+		}
+		/**
+		 * Gets the number of the slots, the released ones included
+		 * @returns `size_t`
+		 */
+		size_t slot_count() const noexcept {
+			return m_slots.size();
+		}
+		/**
+		 * Gets the number of the slots allocated for the grants
+		 * @returns `size_t`
+		 */
+		size_t capacity() const noexcept {
+			return m_slots.capacity();
+		}
+		/**
+		 * Gets the number of the buckets of the uuid index
+		 * @returns `size_t`
+		 */
+		size_t index_size() const noexcept {
+			return m_index.size();
+		}
+		/**
+		 * Gets the number of stored grants
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_size;
+		}
+};
+}
+}
+
+#endif // __STORAGE_HPP__
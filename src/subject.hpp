@@ -2,6 +2,7 @@
 #define __SUBJECT_HPP__
 
 #include <memory>
+#include <type_traits>
 #include <typeinfo>
 
 #include "exception.hpp"
@@ -11,18 +12,64 @@
 namespace libs {
 	namespace subjects {
 
+namespace details {
+	// Keeps the id on the heap, so moving the subject never copies it.
+	template <typename T, bool = std::is_integral<T>::value>
+	class id_holder {
+		private:
+			std::unique_ptr<T> m_id;
+		public:
+			id_holder() = default;
+			explicit id_holder(const T& id): m_id(std::make_unique<T>(id)) {}
+			void reset(const T& id) {
+				m_id = std::make_unique<T>(id);
+			}
+			const T* get() const noexcept {
+				return m_id.get();
+			}
+	};
+	// Keeps the integral id in place, the moved-from holder is left empty like the pointer one.
+	template <typename T>
+	class id_holder<T, true> {
+		private:
+			T m_id{};
+			bool m_valid{false};
+		public:
+			id_holder() = default;
+			explicit id_holder(const T& id) noexcept: m_id(id), m_valid(true) {}
+			id_holder(id_holder&& rhs) noexcept: m_id(rhs.m_id), m_valid(rhs.m_valid) {
+				rhs.m_valid = false;
+			}
+			id_holder& operator=(id_holder&& rhs) noexcept {
+				m_id = rhs.m_id;
+				m_valid = rhs.m_valid;
+				rhs.m_valid = false;
+				return *this;
+			}
+			void reset(const T& id) noexcept {
+				m_id = id;
+				m_valid = true;
+			}
+			const T* get() const noexcept {
+				return m_valid ? &m_id : nullptr;
+			}
+	};
+}
+
 template <typename T> class subject;
 template <typename U>
 bool operator==(subject<U>& lhs, subject<U>& rhs);
 
 /**
  * @brief Defines the subject.
+ *
+ * The integral ids are kept in place, the others on the heap.
  * \tparam T the type of raw data stored in subject
  */
 template <typename T>
 class subject {
 	private:
-		std::unique_ptr<T> m_id;
+		details::id_holder<T> m_id;
 		friend bool operator== <T>(subject<T>&, subject<T>&);
 		bool is_equal(subject<T>& rhs) {
 			return operator==(rhs);
@@ -51,13 +98,14 @@ class subject {
 		 */		 
 		subject& operator=(subject&& sbj) { 
 			m_id = std::move(sbj.m_id); 
+			return *this;
 		}
 		/**
 		 * The constructor with an argument
 		 * \tparam id the unique identificator of the subject
 		 */		 
 		subject(const T& id): 
-			m_id(std::move(std::make_unique<T>(id))) {
+			m_id(id) {
 		}
 		/**
 		 * Sets a unique udentificator for the subject
@@ -65,30 +113,44 @@ class subject {
 		 * @returns `void` 
 		 */		 
 		void set_id(const T& id) {
-			m_id = std::move(std::make_unique<T>(id));
+			m_id.reset(id);
 		}
 		/**
 		 * Gets the unique udentificator for the subject
-		 * @returns `T` the template type of an id 
+		 * @returns `const T&` the template type of an id, valid as long as the subject is
 		 */		 
-		T get_id() const {
-			if(m_id) {
-				return *m_id.get();
+		const T& get_id() const {
+			if(const T* id = m_id.get()) {
+				return *id;
 			}
-			throw libs::exception::custom_exception("Error: Invalid subject");
+			libs::exception::raise("Error: Invalid subject");
+		}
+		/**
+		 * Gets the unique udentificator for the subject without raising
+		 * @returns `const T*` the id or nullptr if the subject holds none
+		 */
+		const T* try_get_id() const noexcept {
+			return m_id.get();
+		}
+		/**
+		 * Checks whether the subject holds an id
+		 * @returns `bool`
+		 */		 
+		bool is_valid() const noexcept {
+			return m_id.get() != nullptr;
 		}
 		/**
 		 * The less than operator required to make the subject instance a key
 		 * @returns `bool` 
 		 */		 
-		bool operator<(const subject<T>& rhs) {
+		bool operator<(const subject<T>& rhs) const {
 			return *m_id.get() < *(rhs.m_id.get());
 		}
 		/**
 		 * The equal operator required to make the subject instance a key
 		 * @returns `bool` 
 		 */		 
-		bool operator==(const subject<T>& rhs) {
+		bool operator==(const subject<T>& rhs) const {
 			return *m_id.get() == *(rhs.m_id.get());
 		}
 };
@@ -0,0 +1,391 @@
+#ifndef __SUBJECT_TABLE_HPP__
+#define __SUBJECT_TABLE_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "exception.hpp"
+
+/// file: subject_table.hpp
+
+namespace libs {
+	namespace subjects {
+
+/**
+ * @brief A small integer handle of an interned subject id.
+ */
+struct subject_handle {
+	static constexpr std::uint32_t invalid = ~std::uint32_t(0);
+	std::uint32_t value{invalid};
+	/**
+	 * Checks whether the handle refers to an interned id
+	 * @returns `bool`
+	 */
+	constexpr bool is_valid() const noexcept {
+		return value != invalid;
+	}
+	constexpr bool operator==(const subject_handle& rhs) const noexcept {
+		return value == rhs.value;
+	}
+	constexpr bool operator!=(const subject_handle& rhs) const noexcept {
+		return value != rhs.value;
+	}
+};
+
+/**
+ * @brief Defines the type used to look up an id without constructing it.
+ * \tparam T the type of the subject id
+ */
+template <typename T>
+struct key_traits {
+	using view_type = T;
+	static const T& view(const T& id) noexcept {
+		return id;
+	}
+};
+
+/**
+ * @brief Looks up `std::string` ids by `std::string_view`.
+ */
+template <>
+struct key_traits<std::string> {
+	using view_type = std::string_view;
+	static std::string_view view(const std::string& id) noexcept {
+		return id;
+	}
+};
+
+/**
+ * @brief Interns subject ids, i.e. maps every distinct id to a handle once.
+ *
+ * The handles are dense and stable for the lifetime of the table, the ids are never released.
+ * \tparam T the type of the subject id
+ */
+template <typename T, typename = void>
+class subject_table {
+	public:
+		using view_type = typename key_traits<T>::view_type;
+	private:
+		// The deque keeps the addresses of the ids stable, so the keys may view them.
+		std::pmr::deque<T> m_ids;
+		std::pmr::unordered_map<view_type, std::uint32_t> m_handles;
+	public:
+		/**
+		 * The constructor with the memory resource of the table
+		 * \param mr the memory resource, by default the default one
+		 */
+		explicit subject_table(std::pmr::memory_resource* mr = std::pmr::get_default_resource()):
+			m_ids(mr), m_handles(mr) {}
+		/**
+		 * The copy constructor deleted, the keys view the owned ids
+		 */
+		subject_table(const subject_table&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		subject_table& operator=(const subject_table&) = delete;
+		/**
+		 * Interns the id
+		 * \param id the id of the subject
+		 * @returns `subject_handle` the existing handle of the id or a newly assigned one
+		 */
+		subject_handle intern(const T& id) {
+			// Interns the id in O(1) - averrage.
+			auto it = m_handles.find(key_traits<T>::view(id));
+			if(it != m_handles.end()) {
+				return subject_handle{it->second};
+			}
+			const std::uint32_t handle = static_cast<std::uint32_t>(m_ids.size());
+			m_ids.push_back(id);
+			// The id is taken back if the map fails to take it, so the table stays consistent.
+#if ACL_EXCEPTIONS
+			try {
+				m_handles.emplace(key_traits<T>::view(m_ids.back()), handle);
+			} catch(...) {
+				m_ids.pop_back();
+				throw;
+			}
+#else
+			m_handles.emplace(key_traits<T>::view(m_ids.back()), handle);
+#endif
+			return subject_handle{handle};
+		}
+		/**
+		 * Reserves the room for the ids, so interning them does not rehash
+		 * \param count the number of the ids
+		 * @returns `void`
+		 */
+		void reserve(const size_t count) {
+			m_handles.reserve(count);
+		}
+		/**
+		 * Finds the handle of the id
+		 * \param id the id or its view
+		 * @returns `subject_handle` the handle, invalid if the id has never been interned
+		 */
+		subject_handle find(const view_type& id) const noexcept {
+			// Finds the handle in O(1) - averrage.
+			auto it = m_handles.find(id);
+			return it == m_handles.end() ? subject_handle{} : subject_handle{it->second};
+		}
+		/**
+		 * Gets the id of the handle
+		 * \param handle a valid handle of this table
+		 * @returns `const T&`
+		 */
+		const T& get_id(const subject_handle handle) const {
+			return m_ids[handle.value];
+		}
+		/**
+		 * Gets the number of the buckets of the id map
+		 * @returns `size_t`
+		 */
+		size_t bucket_count() const noexcept {
+			return m_handles.bucket_count();
+		}
+		/**
+		 * Gets the load factor of the id map
+		 * @returns `float`
+		 */
+		float load_factor() const noexcept {
+			return m_handles.load_factor();
+		}
+		/**
+		 * Gets the number of the interned ids
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_ids.size();
+		}
+};
+
+/**
+ * @brief Interns the integral subject ids, selected for the user and the tenant ids.
+ *
+ * The ids below `direct_limit` are mapped through an array indexed by the id itself, so a lookup
+ * is a bounds check and a load. The array grows with the largest such id interned, the other ids
+ * fall back to the hash map. The handles are dense and stable for the lifetime of the table.
+ * \tparam T the integral type of the subject id
+ */
+template <typename T>
+class subject_table<T, std::enable_if_t<std::is_integral<T>::value>> {
+	public:
+		using view_type = T;
+		// The ids the array is indexed by, it takes 4 bytes per id up to the largest one.
+		static constexpr std::uint64_t direct_limit = std::uint64_t(1) << 22;
+	private:
+		std::pmr::vector<T> m_ids;
+		std::pmr::vector<std::uint32_t> m_direct;
+		std::pmr::unordered_map<T, std::uint32_t> m_handles;
+		static bool is_direct(const T id) noexcept {
+			if constexpr(std::is_signed<T>::value) {
+				if(id < 0) {
+					return false;
+				}
+			}
+			return static_cast<std::uint64_t>(id) < direct_limit;
+		}
+	public:
+		/**
+		 * The constructor with the memory resource of the table
+		 * \param mr the memory resource, by default the default one
+		 */
+		explicit subject_table(std::pmr::memory_resource* mr = std::pmr::get_default_resource()):
+			m_ids(mr), m_direct(mr), m_handles(mr) {}
+		/**
+		 * The copy constructor deleted
+		 */
+		subject_table(const subject_table&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		subject_table& operator=(const subject_table&) = delete;
+		/**
+		 * Interns the id
+		 * \param id the id of the subject
+		 * @returns `subject_handle` the existing handle of the id or a newly assigned one
+		 */
+		subject_handle intern(const T id) {
+			// Interns the id in O(1), amortized by the growth of the array.
+			const subject_handle found = find(id);
+			if(found.is_valid()) {
+				return found;
+			}
+			const std::uint32_t handle = static_cast<std::uint32_t>(m_ids.size());
+			// Everything which allocates goes first, so the id is interned whole or not at all.
+			if(m_ids.size() == m_ids.capacity()) {
+				m_ids.reserve(std::max<size_t>(16, 2 * m_ids.size()));
+			}
+			if(is_direct(id)) {
+				const size_t index = static_cast<size_t>(id);
+				if(index >= m_direct.size()) {
+					m_direct.resize(std::max(index + 1, 2 * m_direct.size()), subject_handle::invalid);
+				}
+				m_direct[index] = handle;
+			} else {
+				m_handles.emplace(id, handle);
+			}
+			m_ids.push_back(id);
+			return subject_handle{handle};
+		}
+		/**
+		 * Reserves the room for the ids, so interning them does not reallocate
+		 * \param count the number of the ids
+		 * @returns `void`
+		 */
+		void reserve(const size_t count) {
+			m_ids.reserve(count);
+		}
+		/**
+		 * Finds the handle of the id
+		 * \param id the id
+		 * @returns `subject_handle` the handle, invalid if the id has never been interned
+		 */
+		subject_handle find(const T id) const noexcept {
+			if(is_direct(id)) {
+				const size_t index = static_cast<size_t>(id);
+				return index < m_direct.size() ? subject_handle{m_direct[index]} : subject_handle{};
+			}
+			auto it = m_handles.find(id);
+			return it == m_handles.end() ? subject_handle{} : subject_handle{it->second};
+		}
+		/**
+		 * Gets the id of the handle
+		 * \param handle a valid handle of this table
+		 * @returns `const T&`
+		 */
+		const T& get_id(const subject_handle handle) const {
+			return m_ids[handle.value];
+		}
+		/**
+		 * Gets the number of the buckets of the id map, the array counted as its entries
+		 * @returns `size_t`
+		 */
+		size_t bucket_count() const noexcept {
+			return m_direct.size() + m_handles.bucket_count();
+		}
+		/**
+		 * Gets the load factor of the id map
+		 * @returns `float`
+		 */
+		float load_factor() const noexcept {
+			const size_t buckets = bucket_count();
+			return buckets ? static_cast<float>(m_ids.size()) / static_cast<float>(buckets) : 0.0f;
+		}
+		/**
+		 * Gets the number of the interned ids
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_ids.size();
+		}
+};
+
+/**
+ * @brief Numbers the distinct ids of a batch densely in the order they first appear.
+ *
+ * The ids are not copied, the batch keeps them alive. The flat open addressing table keeps the hash and
+ * the view of the id along with the local id, so a probe touches a single bucket besides the probed id.
+ * \tparam T the type of the subject id
+ */
+template <typename T>
+class batch_ids {
+	public:
+		using view_type = typename key_traits<T>::view_type;
+	private:
+		struct bucket {
+			size_t hash;
+			view_type key;
+			std::uint32_t id;
+		};
+		static constexpr std::uint32_t empty = ~std::uint32_t(0);
+		std::vector<bucket> m_buckets;
+		std::vector<view_type> m_ids;
+		void grow() {
+			std::vector<bucket> buckets(m_buckets.empty() ? 1024 : m_buckets.size() * 2, bucket{0, view_type(), empty});
+			const size_t mask = buckets.size() - 1;
+			for(const bucket& b : m_buckets) {
+				if(b.id != empty) {
+					size_t i = b.hash & mask;
+					while(buckets[i].id != empty) {
+						i = (i + 1) & mask;
+					}
+					buckets[i] = b;
+				}
+			}
+			m_buckets.swap(buckets);
+		}
+	public:
+		/**
+		 * Hashes the id
+		 * \param id the view of the id
+		 * @returns `size_t`
+		 */
+		static size_t hash(const view_type& id) noexcept {
+			return std::hash<view_type>()(id);
+		}
+		/**
+		 * Prefetches the bucket of the hash, so the ids could be hashed ahead of adding them
+		 * \param hash the hash of the id
+		 * @returns `void`
+		 */
+		void prefetch(const size_t hash) const noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+			if(!m_buckets.empty()) {
+				__builtin_prefetch(&m_buckets[hash & (m_buckets.size() - 1)], 0, 3);
+			}
+#else
+			(void)hash;
+#endif
+		}
+		/**
+		 * Numbers the id
+		 * \param id the view of the id, it has to outlive the batch
+		 * @returns `std::uint32_t` the local id, the new ids get the next one
+		 */
+		std::uint32_t add(const view_type& id) {
+			return add(id, hash(id));
+		}
+		/**
+		 * Numbers the id hashed ahead
+		 * \param id the view of the id, it has to outlive the batch
+		 * \param hash the hash of the id
+		 * @returns `std::uint32_t` the local id, the new ids get the next one
+		 */
+		std::uint32_t add(const view_type& id, const size_t hash) {
+			// Numbers the id in O(1) - averrage.
+			if(2 * (m_ids.size() + 1) > m_buckets.size()) {
+				grow();
+			}
+			const size_t mask = m_buckets.size() - 1;
+			for(size_t i = hash & mask;; i = (i + 1) & mask) {
+				bucket& b = m_buckets[i];
+				if(b.id == empty) {
+					b = bucket{hash, id, static_cast<std::uint32_t>(m_ids.size())};
+					m_ids.push_back(id);
+					return b.id;
+				}
+				if(b.hash == hash && b.key == id) {
+					return b.id;
+				}
+			}
+		}
+		/**
+		 * Gets the distinct ids in the order of their local ids
+		 * @returns `const std::vector<view_type>&`
+		 */
+		const std::vector<view_type>& ids() const noexcept {
+			return m_ids;
+		}
+};
+}
+}
+
+#endif // __SUBJECT_TABLE_HPP__
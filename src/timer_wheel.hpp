@@ -0,0 +1,175 @@
+#ifndef __TIMER_WHEEL_HPP__
+#define __TIMER_WHEEL_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/// file: timer_wheel.hpp
+
+namespace libs {
+	namespace timers {
+
+/**
+ * @brief A scheduled expiry, the key and the generation identify what expires.
+ */
+struct timer {
+	std::int64_t deadline;
+	std::uint64_t key;
+	std::uint32_t generation;
+};
+
+/**
+ * @brief A hierarchical timer wheel of 4 levels with 256 buckets each.
+ *
+ * A timer goes to the lowest level whose bucket is reached before its deadline tick and moves down
+ * a level every time its bucket comes around, so every timer is touched at most once per level.
+ * The timers are expired in bounded batches, a batch stops after the budget and the next one resumes
+ * where it has stopped. The deadlines past the top level wait in an overflow list rescanned on its wrap.
+ */
+class timer_wheel {
+	private:
+		static constexpr unsigned bits = 8;
+		static constexpr unsigned levels = 4;
+		static constexpr std::uint64_t buckets = std::uint64_t(1) << bits;
+		std::pmr::vector<std::pmr::vector<timer>> m_wheels;
+		std::pmr::vector<timer> m_overflow;
+		std::int64_t m_resolution;
+		std::uint64_t m_tick;
+		// The occupied buckets of the lowest level, the empty ticks are skipped by them.
+		std::uint64_t m_occupied[buckets / 64]{};
+		size_t m_size{};
+		std::uint64_t to_tick(const std::int64_t time) const noexcept {
+			// Rounds up, so the timer never fires before its deadline.
+			return time <= 0 ? 0 : static_cast<std::uint64_t>((time + m_resolution - 1) / m_resolution);
+		}
+		std::pmr::vector<timer>& bucket(const unsigned level, const std::uint64_t tick) noexcept {
+			return m_wheels[level * buckets + ((tick >> (level * bits)) & (buckets - 1))];
+		}
+		void place(const timer& t) {
+			std::uint64_t tick = to_tick(t.deadline);
+			if(tick < m_tick) {
+				tick = m_tick;
+			}
+			for(unsigned level = 0; level < levels; ++level) {
+				// The first tick at which a bucket of this level comes around.
+				const std::uint64_t first = (m_tick + (std::uint64_t(1) << (level * bits)) - 1) >> (level * bits);
+				if((tick >> (level * bits)) - first < buckets) {
+					bucket(level, tick).push_back(t);
+					if(level == 0) {
+						m_occupied[(tick & (buckets - 1)) / 64] |= std::uint64_t(1) << (tick % 64);
+					}
+					return;
+				}
+			}
+			m_overflow.push_back(t);
+		}
+		// Moves the timers of the bucket one level down, false if the budget runs out first.
+		bool cascade(std::pmr::vector<timer>& from, size_t& budget) {
+			while(!from.empty()) {
+				if(budget == 0) {
+					return false;
+				}
+				const timer t = from.back();
+				from.pop_back();
+				place(t);
+				--budget;
+			}
+			return true;
+		}
+		// Finds the first occupied bucket of the lowest level in [from, to), returns `to` if none.
+		std::uint64_t first_occupied(std::uint64_t from, const std::uint64_t to) const noexcept {
+			while(from < to) {
+				const std::uint64_t word = m_occupied[from / 64] >> (from % 64);
+				if(word) {
+					from += static_cast<std::uint64_t>(__builtin_ctzll(word));
+					return from < to ? from : to;
+				}
+				from = (from / 64 + 1) * 64;
+			}
+			return to;
+		}
+	public:
+		/**
+		 * The constructor with the resolution and the current time
+		 * \param resolution the length of a tick, in the units of the deadlines
+		 * \param now the current time, in the units of the deadlines
+		 * \param mr the memory resource, by default the default one
+		 */
+		timer_wheel(const std::int64_t resolution, const std::int64_t now,
+				std::pmr::memory_resource* mr = std::pmr::get_default_resource()):
+			m_wheels(mr), m_overflow(mr), m_resolution(resolution > 0 ? resolution : 1), m_tick(0) {
+			m_tick = now < 0 ? 0 : static_cast<std::uint64_t>(now / m_resolution);
+			// The buckets get the memory resource of the wheel by the uses-allocator construction.
+			m_wheels.resize(levels * buckets);
+		}
+		/**
+		 * Schedules the timer
+		 * \param t the timer
+		 * @returns `void`
+		 */
+		void schedule(const timer& t) {
+			// Schedules the timer in O(1) - amortized.
+			place(t);
+			++m_size;
+		}
+		/**
+		 * Expires the timers whose deadlines have passed, at most `budget` timers are touched
+		 * \param now the current time, in the units of the deadlines
+		 * \param budget the maximum number of the timers to expire or to move between the levels
+		 * \param f the function called with every expired timer
+		 * @returns `bool` true if all the timers due by now have been expired
+		 */
+		template <typename F>
+		bool advance(const std::int64_t now, size_t budget, F f) {
+			// Expires the timers in O(1) - amortized per timer.
+			const std::uint64_t last = now < 0 ? 0 : static_cast<std::uint64_t>(now / m_resolution);
+			if(m_size == 0 && m_tick <= last) {
+				m_tick = last + 1;
+			}
+			while(m_tick <= last) {
+				if((m_tick & ((std::uint64_t(1) << (levels * bits)) - 1)) == 0 && !m_overflow.empty()) {
+					// The overflow is rare, it is rescanned at once since its timers may stay in it.
+					std::pmr::vector<timer> overflow(m_overflow.get_allocator());
+					overflow.swap(m_overflow);
+					for(const timer& t : overflow) {
+						place(t);
+					}
+				}
+				for(unsigned level = levels - 1; level > 0; --level) {
+					if((m_tick & ((std::uint64_t(1) << (level * bits)) - 1)) == 0 && !cascade(bucket(level, m_tick), budget)) {
+						return false;
+					}
+				}
+				std::pmr::vector<timer>& due = bucket(0, m_tick);
+				while(!due.empty()) {
+					if(budget == 0) {
+						return false;
+					}
+					const timer t = due.back();
+					due.pop_back();
+					--m_size;
+					--budget;
+					f(t);
+				}
+				m_occupied[(m_tick & (buckets - 1)) / 64] &= ~(std::uint64_t(1) << (m_tick % 64));
+				// Skips to the next occupied bucket, but not past the next cascade.
+				const std::uint64_t base = m_tick & ~(buckets - 1);
+				const std::uint64_t end = std::min(last + 1, base + buckets);
+				m_tick = base + first_occupied(m_tick - base + 1, end - base);
+			}
+			return true;
+		}
+		/**
+		 * Gets the number of the scheduled timers, including the superseded ones not expired yet
+		 * @returns `size_t`
+		 */
+		size_t size() const noexcept {
+			return m_size;
+		}
+};
+}
+}
+
+#endif // __TIMER_WHEEL_HPP__
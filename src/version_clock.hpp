@@ -0,0 +1,175 @@
+#ifndef __VERSION_CLOCK_HPP__
+#define __VERSION_CLOCK_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/// file: version_clock.hpp
+
+namespace libs {
+	namespace concurrency {
+
+/**
+ * @brief Orders the commits of the concurrent writers and tracks the versions pinned by the readers.
+ *
+ * A writer draws a version, installs its change stamped with it and commits. The commits become
+ * visible in the version order, so once a version is visible all the changes up to it are installed.
+ * A reader pins the visible version and sees exactly the changes stamped not later than it, the
+ * states superseded before the oldest pinned version could be dropped.
+ */
+class version_clock {
+	private:
+		struct alignas(64) record {
+			std::atomic<std::uint64_t> version{0};
+			std::atomic<bool> in_use{false};
+			record* next{nullptr};
+		};
+		alignas(64) std::atomic<std::uint64_t> m_next{1};
+		alignas(64) std::atomic<std::uint64_t> m_visible{1};
+		std::atomic<record*> m_records{nullptr};
+		record* acquire_record() {
+			for(record* r = m_records.load(std::memory_order_acquire); r; r = r->next) {
+				bool expected = false;
+				if(!r->in_use.load(std::memory_order_relaxed) &&
+						r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					return r;
+				}
+			}
+			record* r = new record();
+			r->in_use.store(true, std::memory_order_relaxed);
+			record* head = m_records.load(std::memory_order_relaxed);
+			do {
+				r->next = head;
+			} while(!m_records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+			return r;
+		}
+	public:
+		/**
+		 * @brief Keeps the version pinned, the states it could read are not dropped meanwhile.
+		 */
+		class pin {
+			private:
+				record* m_record{nullptr};
+				std::uint64_t m_version{};
+			public:
+				/**
+				 * Pins the visible version
+				 * \param clock the clock of the versions
+				 */
+				explicit pin(version_clock& clock): m_record(clock.acquire_record()) {
+					// Republished until it is the visible one, so no writer could miss it while trimming.
+					std::uint64_t version = clock.m_visible.load(std::memory_order_seq_cst);
+					do {
+						m_version = version;
+						m_record->version.store(version, std::memory_order_seq_cst);
+						version = clock.m_visible.load(std::memory_order_seq_cst);
+					} while(version != m_version);
+				}
+				/**
+				 * The copy constructor deleted
+				 */
+				pin(const pin&) = delete;
+				/**
+				 * The assignement operator deleted
+				 */
+				pin& operator=(const pin&) = delete;
+				/**
+				 * The move constructor
+				 * \param other the pin that should be moved.
+				 */
+				pin(pin&& other) noexcept: m_record(other.m_record), m_version(other.m_version) {
+					other.m_record = nullptr;
+				}
+				/**
+				 * Unpins the version
+				 */
+				~pin() {
+					reset();
+				}
+				/**
+				 * Unpins the version ahead of the destruction
+				 * @returns `void`
+				 */
+				void reset() noexcept {
+					if(m_record) {
+						m_record->version.store(0, std::memory_order_release);
+						m_record->in_use.store(false, std::memory_order_release);
+						m_record = nullptr;
+					}
+				}
+				/**
+				 * Gets the pinned version
+				 * @returns `std::uint64_t`
+				 */
+				std::uint64_t version() const noexcept {
+					return m_version;
+				}
+		};
+		/**
+		 * The defaulted constructor
+		 */
+		version_clock() = default;
+		/**
+		 * The copy constructor deleted
+		 */
+		version_clock(const version_clock&) = delete;
+		/**
+		 * The assignement operator deleted
+		 */
+		version_clock& operator=(const version_clock&) = delete;
+		/**
+		 * The destructor, there must be no pins left
+		 */
+		~version_clock() {
+			record* r = m_records.load(std::memory_order_relaxed);
+			while(r) {
+				record* next = r->next;
+				delete r;
+				r = next;
+			}
+		}
+		/**
+		 * Draws the version of the next change, it must be committed without failing in between
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t begin() noexcept {
+			return m_next.fetch_add(1, std::memory_order_acq_rel) + 1;
+		}
+		/**
+		 * Makes the installed change visible, waits for the earlier versions to be committed first
+		 * \param version the version drawn by `begin`
+		 * @returns `void`
+		 */
+		void commit(const std::uint64_t version) noexcept {
+			while(m_visible.load(std::memory_order_acquire) != version - 1) {
+				std::this_thread::yield();
+			}
+			m_visible.store(version, std::memory_order_seq_cst);
+		}
+		/**
+		 * Gets the latest visible version
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t visible() const noexcept {
+			return m_visible.load(std::memory_order_acquire);
+		}
+		/**
+		 * Gets the oldest version a reader could read, the visible one if nothing is pinned
+		 * @returns `std::uint64_t`
+		 */
+		std::uint64_t oldest() const noexcept {
+			std::uint64_t oldest = m_visible.load(std::memory_order_seq_cst);
+			for(record* r = m_records.load(std::memory_order_acquire); r; r = r->next) {
+				const std::uint64_t version = r->version.load(std::memory_order_seq_cst);
+				if(version != 0 && version < oldest) {
+					oldest = version;
+				}
+			}
+			return oldest;
+		}
+};
+}
+}
+
+#endif // __VERSION_CLOCK_HPP__
@@ -0,0 +1,119 @@
+#ifndef __COUNTING_ALLOCATOR_HPP__
+#define __COUNTING_ALLOCATOR_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/// file: counting_allocator.hpp
+///
+/// Replaces the global allocation functions with the ones counting the heap allocations. Every form of
+/// `operator new` and `operator delete` is replaced, the plain, the array, the nothrow and the aligned ones,
+/// so all of them allocate by `malloc` and free by `free` and the sanitizers see them matched.
+/// The replacements are not inline, so the header is included by one translation unit of the program.
+
+// The number of the heap allocations so far.
+static std::atomic<size_t> g_allocations{0};
+
+namespace counting {
+	inline void* allocate(std::size_t size) noexcept {
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+	inline void* allocate(std::size_t size, std::align_val_t alignment) noexcept {
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		const std::size_t align = static_cast<std::size_t>(alignment);
+		void* ptr = nullptr;
+		// The alignment of posix_memalign must be a multiple of the size of a pointer.
+		return posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size ? size : 1) == 0 ? ptr : nullptr;
+	}
+	inline void* checked(void* ptr) {
+		if(!ptr) {
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+}
+
+void* operator new(std::size_t size) {
+	return counting::checked(counting::allocate(size));
+}
+
+void* operator new[](std::size_t size) {
+	return counting::checked(counting::allocate(size));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return counting::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return counting::allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return counting::checked(counting::allocate(size, alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return counting::checked(counting::allocate(size, alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return counting::allocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return counting::allocate(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+	std::free(ptr);
+}
+
+#endif // __COUNTING_ALLOCATOR_HPP__
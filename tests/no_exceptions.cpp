@@ -0,0 +1,41 @@
+/// file: no_exceptions.cpp
+///
+/// Builds the library with the exceptions disabled and checks the `try_*` calls report their errors.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "acl.hpp"
+#include "concurrent_acl.hpp"
+
+#define EXPECT(condition) if(!(condition)) { std::fprintf(stderr, "Failed: %s at line %d\n", #condition, __LINE__); return 1; }
+
+int main() {
+	using status = libs::status::code;
+	libs::acl::acl<std::string, int> obj;
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> role("staff");
+	libs::subjects::subject<std::string> empty;
+	EXPECT(empty.try_get_id() == nullptr);
+	EXPECT(obj.try_add(empty, std::make_unique<libs::resources::resource<int>>(1)).error() == status::invalid_subject);
+	EXPECT(obj.try_add(sub, nullptr).error() == status::invalid_resource);
+	EXPECT(obj.try_add(sub, std::make_unique<libs::resources::resource<int>>(1), "granted").error() == status::invalid_access_level);
+	const libs::status::result<size_t> uuid = obj.try_add(sub, std::make_unique<libs::resources::resource<int>>(1), "read|write");
+	EXPECT(uuid.has_value());
+	EXPECT(obj.is_allowed(sub, uuid.value(), libs::enums::rights::write));
+	EXPECT(obj.try_forbid_access(sub, uuid.value(), libs::enums::rights::write) == status::ok);
+	EXPECT(!obj.is_allowed(sub, uuid.value(), libs::enums::rights::write));
+	EXPECT(obj.try_allow_access(sub, uuid.value() + 1) == status::unknown_resource);
+	EXPECT(obj.try_allow_access(role, uuid.value()) == status::unknown_subject);
+	EXPECT(obj.try_add_member(role, sub).value());
+	EXPECT(obj.try_add_member(sub, role).error() == status::role_cycle);
+	EXPECT(*obj.try_get_id(obj.owner(uuid.value())) == "my_files");
+	EXPECT(obj.try_remove(sub, uuid.value()) == status::ok);
+	EXPECT(obj.try_remove(sub, uuid.value()) == status::unknown_resource);
+	EXPECT(obj.try_remove(sub) == status::ok);
+	EXPECT(obj.try_remove(sub) == status::unknown_subject);
+	EXPECT(!libs::enums::access_level::parse("read|").has_value());
+	EXPECT(libs::enums::access_level::parse("read|exec").value().permits(libs::enums::rights::exec));
+	return 0;
+}
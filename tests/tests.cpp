@@ -2,10 +2,33 @@
 #define BOOST_TEST_MODULE TEST_ACL
 
 #include <boost/test/included/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <memory>
+#include <memory_resource>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include "acl.hpp"
+#include "concurrent_acl.hpp"
+#ifdef ACL_SHARED_MEMORY
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#ifdef ACL_TEST_DAEMON
+#include <unistd.h>
+
+#include "client.hpp"
+#include "server.hpp"
+#endif
+
+// Counts the heap allocations, the tests use it to prove the checks do not allocate.
+#include "counting_allocator.hpp"
 
 struct acl_fixture
 {
@@ -264,3 +287,1544 @@ BOOST_FIXTURE_TEST_CASE(TEST_REMOVE_RESOURCE_FROM_SUBJECT, acl_fixture)
 	BOOST_CHECK_EQUAL(true, has_sub);
 	BOOST_CHECK_EQUAL(false, has_res);
 }
+// Testing granting and revoking the separate rights of a resource
+BOOST_FIXTURE_TEST_CASE(TEST_GRANT_AND_REVOKE_RIGHTS, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	std::unique_ptr<libs::resources::resource<std::unique_ptr<std::fstream>>> res_fsm = std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>();
+	size_t uuid = obj.add(sub, std::move(res_fsm), libs::enums::rights::read);
+
+	obj.allow_access(sub, uuid, libs::enums::rights::write);
+	obj.forbid_access(sub, uuid, libs::enums::rights::read);
+
+	std::unique_ptr<libs::resources::resource<std::unique_ptr<std::fstream>>> uptr = obj.try_pop(sub, uuid);
+	BOOST_CHECK(uptr);
+	bool ret = obj.is_allowed(sub, std::move(uptr), libs::enums::rights::write);
+	BOOST_CHECK_EQUAL(true, ret);
+	uptr = std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>();
+	uptr.get()->set_uuid(uuid);
+	ret = obj.is_allowed(sub, std::move(uptr), libs::enums::rights::read | libs::enums::rights::write);
+	BOOST_CHECK_EQUAL(false, ret);
+}
+// Testing the string access level specifiers parsing
+BOOST_AUTO_TEST_CASE(TEST_ACCESS_LEVEL_PARSING)
+{
+	BOOST_CHECK(libs::enums::access_level("allowed").get_rights() == libs::enums::rights::all);
+	BOOST_CHECK(libs::enums::access_level("forbiden").get_rights() == libs::enums::rights::none);
+	BOOST_CHECK(libs::enums::access_level("read|exec").get_rights() == (libs::enums::rights::read | libs::enums::rights::exec));
+	BOOST_CHECK_EQUAL("allowed", libs::enums::access_level("write").get_access_level());
+	BOOST_CHECK_THROW(libs::enums::access_level("granted"), libs::exception::custom_exception);
+}
+// Testing that released slots are reused without resurrecting the removed grants
+BOOST_FIXTURE_TEST_CASE(TEST_REUSE_RELEASED_SLOTS, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> sub_one("my_files_one");
+	size_t uuid = obj.add(sub, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), "allowed");
+	size_t uuid_one = obj.add(sub_one, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), "allowed");
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub, uuid_one));
+
+	obj.remove(sub, uuid);
+	size_t uuid_sec = obj.add(sub_one, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>());
+	BOOST_CHECK_EQUAL(3, uuid_sec);
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub, uuid));
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub_one, uuid));
+	BOOST_CHECK_EQUAL(true, obj.has_resource(sub_one, uuid_sec));
+	BOOST_CHECK_EQUAL(true, obj.has_subject(sub));
+	BOOST_CHECK_EQUAL(2, obj.size());
+
+	obj.remove(sub_one);
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub_one, uuid_one));
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub_one, uuid_sec));
+	BOOST_CHECK_EQUAL(1, obj.size());
+
+	size_t uuid_third = obj.add(sub_one, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>());
+	BOOST_CHECK_EQUAL(4, uuid_third);
+	BOOST_CHECK_EQUAL(true, obj.has_resource(sub_one, uuid_third));
+	BOOST_CHECK_EQUAL(2, obj.size());
+}
+// Testing that popping by the resource removes the grant
+BOOST_FIXTURE_TEST_CASE(TEST_TRY_POP_BY_RESOURCE_REMOVES_GRANT, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	size_t uuid = obj.add(sub, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), "allowed");
+	std::unique_ptr<libs::resources::resource<std::unique_ptr<std::fstream>>> key = std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>();
+	key.get()->set_uuid(uuid);
+	std::unique_ptr<libs::resources::resource<std::unique_ptr<std::fstream>>> uptr = obj.try_pop(sub, std::move(key));
+	BOOST_CHECK(uptr);
+	BOOST_CHECK_EQUAL(uuid, uptr.get()->get_uuid());
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub, uuid));
+	BOOST_CHECK_EQUAL(true, obj.has_subject(sub));
+}
+// Testing the calls through the interned subject handle and the raw id lookup
+BOOST_FIXTURE_TEST_CASE(TEST_INTERNED_SUBJECT_HANDLE, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	BOOST_CHECK_EQUAL(false, obj.find(std::string_view("my_files")).is_valid());
+
+	size_t uuid = obj.add(sub, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>());
+	libs::subjects::subject_handle h = obj.find(std::string_view("my_files"));
+	BOOST_CHECK(h.is_valid());
+	BOOST_CHECK(h == obj.intern(sub));
+	BOOST_CHECK_EQUAL(false, obj.find(std::string_view("my_files_one")).is_valid());
+
+	BOOST_CHECK_EQUAL(false, obj.is_allowed(h, uuid));
+	obj.allow_access(h, uuid, libs::enums::rights::read);
+	BOOST_CHECK_EQUAL(true, obj.is_allowed(h, uuid, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(false, obj.is_allowed(h, uuid, libs::enums::rights::write));
+
+	size_t uuid_one = obj.add(h, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), libs::enums::rights::all);
+	BOOST_CHECK_EQUAL(true, obj.has_resource(sub, uuid_one));
+	obj.remove(h);
+	BOOST_CHECK_EQUAL(false, obj.has_subject(sub));
+	BOOST_CHECK_EQUAL(false, obj.has_resource(h, uuid));
+	BOOST_CHECK(h == obj.find(std::string_view("my_files")));
+}
+// Testing that the concurrent adds get unique uuids and all of them are visible afterwards
+BOOST_AUTO_TEST_CASE(TEST_CONCURRENT_ADD_UNIQUE_UUIDS)
+{
+	libs::acl::concurrent_acl<std::string, int> cacl;
+	const size_t threads_count = 4;
+	const size_t adds_count = 1000;
+	std::vector<std::vector<size_t>> uuids(threads_count);
+	std::vector<std::thread> threads;
+	for(size_t t = 0; t < threads_count; ++t) {
+		threads.emplace_back([&cacl, &uuids, t, adds_count]() {
+			libs::subjects::subject<std::string> own("subject_" + std::to_string(t));
+			libs::subjects::subject<std::string> shared("shared");
+			for(size_t i = 0; i < adds_count; ++i) {
+				uuids[t].push_back(cacl.add(i % 2 ? own : shared, std::make_unique<libs::resources::resource<int>>(int(i))));
+			}
+		});
+	}
+	for(std::thread& th : threads) {
+		th.join();
+	}
+	std::set<size_t> unique;
+	for(size_t t = 0; t < threads_count; ++t) {
+		libs::subjects::subject<std::string> own("subject_" + std::to_string(t));
+		libs::subjects::subject<std::string> shared("shared");
+		for(size_t i = 0; i < adds_count; ++i) {
+			unique.insert(uuids[t][i]);
+			BOOST_CHECK(cacl.has_resource(i % 2 ? own : shared, uuids[t][i]));
+		}
+	}
+	BOOST_CHECK_EQUAL(threads_count * adds_count, unique.size());
+	BOOST_CHECK_EQUAL(threads_count + 1, cacl.size());
+}
+// Testing that the empty subject is a miss and the grants are not bounded by the uuids ever handed out
+BOOST_AUTO_TEST_CASE(TEST_CONCURRENT_EMPTY_SUBJECT_AND_CHURN)
+{
+	libs::acl::concurrent_acl<std::string, int> cacl;
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> empty;
+	const size_t uuid = cacl.add(sub, std::make_unique<libs::resources::resource<int>>(1), libs::enums::rights::read);
+	BOOST_CHECK_EQUAL(false, cacl.has_subject(empty));
+	BOOST_CHECK_EQUAL(false, cacl.has_resource(empty, uuid));
+	BOOST_CHECK_EQUAL(false, cacl.is_allowed(empty, uuid));
+	cacl.allow_access(empty, uuid);
+	cacl.remove(empty, uuid);
+	cacl.remove(empty);
+	BOOST_CHECK(cacl.try_pop(empty, uuid) == nullptr);
+	{
+		const libs::acl::concurrent_acl<std::string, int>::view v = cacl.snapshot();
+		BOOST_CHECK_EQUAL(false, v.has_subject(empty));
+		BOOST_CHECK_EQUAL(false, v.has_resource(empty, uuid));
+		BOOST_CHECK_EQUAL(false, v.is_allowed(empty, uuid));
+		BOOST_CHECK_EQUAL(true, v.is_allowed(sub, uuid));
+	}
+	BOOST_CHECK_EQUAL(true, cacl.is_allowed(sub, uuid));
+	size_t last = uuid;
+	for(size_t i = 0; i < 100000; ++i) {
+		last = cacl.add(sub, std::make_unique<libs::resources::resource<int>>(int(i)), libs::enums::rights::read);
+		BOOST_REQUIRE_EQUAL(true, cacl.is_allowed(sub, last));
+		cacl.remove(sub, last);
+	}
+	BOOST_CHECK_EQUAL(uuid + 100000, last);
+	BOOST_CHECK_EQUAL(false, cacl.has_resource(sub, last));
+	BOOST_CHECK_EQUAL(true, cacl.is_allowed(sub, uuid));
+	BOOST_CHECK_EQUAL(true, cacl.has_resource(sub, cacl.add(sub, std::make_unique<libs::resources::resource<int>>(0))));
+}
+// Testing that the readers observe the completed writes in real-time order
+BOOST_AUTO_TEST_CASE(TEST_CONCURRENT_READERS_ARE_LINEARIZABLE)
+{
+	libs::acl::concurrent_acl<std::string, int> cacl;
+	libs::subjects::subject<std::string> sub("my_files");
+	const size_t rounds = 2000;
+	std::atomic<size_t> allowed{0};
+	std::atomic<size_t> removed{0};
+	std::atomic<bool> done{false};
+	std::atomic<size_t> violations{0};
+	std::thread writer([&]() {
+		for(size_t i = 0; i < rounds; ++i) {
+			size_t uuid = cacl.add(sub, std::make_unique<libs::resources::resource<int>>(int(i)));
+			cacl.allow_access(sub, uuid, libs::enums::rights::read);
+			allowed.store(uuid);
+			cacl.forbid_access(sub, uuid, libs::enums::rights::write);
+			cacl.remove(sub, uuid);
+			removed.store(uuid);
+		}
+		done.store(true);
+	});
+	std::vector<std::thread> readers;
+	for(size_t t = 0; t < 3; ++t) {
+		readers.emplace_back([&]() {
+			libs::subjects::subject<std::string> reader_sub("my_files");
+			while(!done.load()) {
+				const size_t gone = removed.load();
+				if(gone != 0 && cacl.has_resource(reader_sub, gone)) {
+					++violations;
+				}
+				const size_t uuid = allowed.load();
+				if(uuid == 0) {
+					continue;
+				}
+				// Once allowed the grant is either still allowed or removed for good.
+				if(!cacl.is_allowed(reader_sub, uuid, libs::enums::rights::read) && cacl.has_resource(reader_sub, uuid)) {
+					++violations;
+				}
+			}
+		});
+	}
+	writer.join();
+	for(std::thread& th : readers) {
+		th.join();
+	}
+	BOOST_CHECK_EQUAL(0, violations.load());
+	BOOST_CHECK_EQUAL(true, cacl.has_subject(sub));
+}
+// Testing that removing a subject hides all of its grants at once
+BOOST_AUTO_TEST_CASE(TEST_CONCURRENT_REMOVE_SUBJECT)
+{
+	libs::acl::concurrent_acl<std::string, int> cacl;
+	libs::subjects::subject<std::string> sub("my_files");
+	std::vector<size_t> uuids;
+	for(int i = 0; i < 100; ++i) {
+		uuids.push_back(cacl.add(sub, std::make_unique<libs::resources::resource<int>>(i), libs::enums::rights::all));
+	}
+	std::atomic<bool> done{false};
+	std::atomic<size_t> violations{0};
+	std::thread reader([&]() {
+		bool seen_removed = false;
+		while(!done.load()) {
+			for(size_t uuid : uuids) {
+				const bool allowed = cacl.is_allowed(sub, uuid);
+				if(seen_removed && allowed) {
+					++violations;
+				}
+				seen_removed = seen_removed || !allowed;
+			}
+		}
+	});
+	std::this_thread::yield();
+	cacl.remove(sub);
+	done.store(true);
+	reader.join();
+	BOOST_CHECK_EQUAL(0, violations.load());
+	BOOST_CHECK_EQUAL(false, cacl.has_subject(sub));
+	BOOST_CHECK_EQUAL(0, cacl.size());
+	size_t uuid = cacl.add(sub, std::make_unique<libs::resources::resource<int>>(1));
+	BOOST_CHECK_EQUAL(false, cacl.has_resource(sub, uuids.front()));
+	BOOST_CHECK_EQUAL(true, cacl.has_resource(sub, uuid));
+	std::unique_ptr<libs::resources::resource<int>> key = std::make_unique<libs::resources::resource<int>>();
+	key.get()->set_uuid(uuid);
+	std::unique_ptr<libs::resources::resource<int>> uptr = cacl.try_pop(sub, std::move(key));
+	BOOST_CHECK(uptr);
+	BOOST_CHECK_EQUAL(1, *uptr.get()->get_resource());
+	BOOST_CHECK_EQUAL(false, cacl.has_resource(sub, uuid));
+}
+// Testing that a view keeps reading the version it pinned while the writers go on
+BOOST_AUTO_TEST_CASE(TEST_CONCURRENT_SNAPSHOT_VIEWS)
+{
+	libs::acl::concurrent_acl<std::string, int> cacl;
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> other("other_files");
+	const size_t first = cacl.add(sub, std::make_unique<libs::resources::resource<int>>(1), libs::enums::rights::read);
+	const size_t second = cacl.add(other, std::make_unique<libs::resources::resource<int>>(2), libs::enums::rights::all);
+	{
+		libs::acl::concurrent_acl<std::string, int>::view before = cacl.snapshot();
+		cacl.allow_access(sub, first, libs::enums::rights::write);
+		cacl.remove(other);
+		cacl.remove(sub, first);
+		const size_t third = cacl.add(sub, std::make_unique<libs::resources::resource<int>>(3), libs::enums::rights::read);
+		libs::acl::concurrent_acl<std::string, int>::view after = cacl.snapshot();
+		BOOST_CHECK(before.version() < after.version());
+		BOOST_CHECK_EQUAL(true, before.is_allowed(sub, first, libs::enums::rights::read));
+		BOOST_CHECK_EQUAL(false, before.is_allowed(sub, first, libs::enums::rights::write));
+		BOOST_CHECK_EQUAL(true, before.has_subject(other));
+		BOOST_CHECK_EQUAL(true, before.is_allowed(other, second, libs::enums::rights::admin));
+		BOOST_CHECK_EQUAL(false, before.has_resource(sub, third));
+		BOOST_CHECK_EQUAL(false, after.has_resource(sub, first));
+		BOOST_CHECK_EQUAL(false, after.has_subject(other));
+		BOOST_CHECK_EQUAL(true, after.is_allowed(sub, third));
+		BOOST_CHECK_EQUAL(false, cacl.has_resource(sub, first));
+		BOOST_CHECK_EQUAL(false, cacl.has_subject(other));
+	}
+	BOOST_CHECK_EQUAL(false, cacl.has_subject(other));
+	BOOST_CHECK_EQUAL(false, cacl.snapshot().has_resource(sub, first));
+
+	// The checks made through one view agree with each other however the writers interleave.
+	std::vector<size_t> uuids;
+	for(int i = 0; i < 16; ++i) {
+		uuids.push_back(cacl.add(i % 2 ? sub : other, std::make_unique<libs::resources::resource<int>>(i)));
+	}
+	std::atomic<bool> done{false};
+	std::atomic<size_t> violations{0};
+	std::thread writer([&]() {
+		for(int round = 0; round < 2000; ++round) {
+			for(size_t i = 0; i < uuids.size(); ++i) {
+				if(round % 2) {
+					cacl.forbid_access(i % 2 ? sub : other, uuids[i]);
+				} else {
+					cacl.allow_access(i % 2 ? sub : other, uuids[i], libs::enums::rights::read);
+				}
+			}
+		}
+		done.store(true);
+	});
+	std::vector<std::thread> readers;
+	for(int t = 0; t < 2; ++t) {
+		readers.emplace_back([&]() {
+			while(!done.load()) {
+				const libs::acl::concurrent_acl<std::string, int>::view v = cacl.snapshot();
+				std::vector<bool> seen;
+				for(size_t i = 0; i < uuids.size(); ++i) {
+					seen.push_back(v.is_allowed(i % 2 ? sub : other, uuids[i]));
+				}
+				std::this_thread::yield();
+				for(size_t i = 0; i < uuids.size(); ++i) {
+					if(seen[i] != v.is_allowed(i % 2 ? sub : other, uuids[i])) {
+						++violations;
+					}
+				}
+			}
+		});
+	}
+	writer.join();
+	for(std::thread& th : readers) {
+		th.join();
+	}
+	BOOST_CHECK_EQUAL(0, violations.load());
+	BOOST_CHECK_EQUAL(true, cacl.is_allowed(sub, uuids[1]) == cacl.snapshot().is_allowed(sub, uuids[1]));
+}
+// Testing that the subjects come and go one at a time while a view keeps reading the incarnation it pinned
+BOOST_AUTO_TEST_CASE(TEST_CONCURRENT_SUBJECT_CHURN)
+{
+	using subject = libs::subjects::subject<std::string>;
+	libs::acl::concurrent_acl<std::string, int> cacl;
+	const size_t subjects_count = 20000;
+	std::vector<size_t> uuids;
+	for(size_t i = 0; i < subjects_count; ++i) {
+		uuids.push_back(cacl.add(subject("subject_" + std::to_string(i)), std::make_unique<libs::resources::resource<int>>(int(i)),
+				libs::enums::rights::read));
+	}
+	BOOST_CHECK_EQUAL(subjects_count, cacl.size());
+	const subject churned("subject_7");
+	size_t latest = 0;
+	{
+		const libs::acl::concurrent_acl<std::string, int>::view v = cacl.snapshot();
+		cacl.remove(churned);
+		const size_t again = cacl.add(churned, std::make_unique<libs::resources::resource<int>>(1));
+		cacl.remove(churned);
+		latest = cacl.add(churned, std::make_unique<libs::resources::resource<int>>(2), libs::enums::rights::all);
+		BOOST_CHECK_EQUAL(true, v.is_allowed(churned, uuids[7], libs::enums::rights::read));
+		BOOST_CHECK_EQUAL(false, v.has_resource(churned, again));
+		BOOST_CHECK_EQUAL(false, v.has_resource(churned, latest));
+		BOOST_CHECK_EQUAL(false, cacl.has_resource(churned, uuids[7]));
+		BOOST_CHECK_EQUAL(false, cacl.has_resource(churned, again));
+		BOOST_CHECK_EQUAL(true, cacl.is_allowed(churned, latest, libs::enums::rights::all));
+		const libs::acl::concurrent_acl<std::string, int>::view after = cacl.snapshot();
+		BOOST_CHECK_EQUAL(true, after.has_resource(churned, latest));
+		BOOST_CHECK_EQUAL(false, after.has_resource(churned, uuids[7]));
+	}
+	BOOST_CHECK_EQUAL(subjects_count, cacl.size());
+	for(size_t i = 0; i < subjects_count; ++i) {
+		cacl.remove(subject("subject_" + std::to_string(i)));
+	}
+	BOOST_CHECK_EQUAL(0, cacl.size());
+	BOOST_CHECK_EQUAL(false, cacl.has_subject(churned));
+	BOOST_CHECK_EQUAL(false, cacl.snapshot().has_resource(churned, latest));
+	BOOST_CHECK_EQUAL(true, cacl.is_allowed(churned, cacl.add(churned, std::make_unique<libs::resources::resource<int>>(3),
+			libs::enums::rights::read)));
+}
+// Testing that the batched checks match the single checks
+BOOST_FIXTURE_TEST_CASE(TEST_BATCH_CHECKS, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> sub_one("my_files_one");
+	std::vector<size_t> uuids;
+	for(int i = 0; i < 50; ++i) {
+		uuids.push_back(obj.add(i % 3 ? sub : sub_one, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(),
+					i % 2 ? libs::enums::rights::read : libs::enums::rights::none));
+	}
+	obj.remove(sub, uuids[4]);
+	libs::subjects::subject_handle h = obj.find(std::string_view("my_files"));
+	libs::subjects::subject_handle h_one = obj.find(std::string_view("my_files_one"));
+	std::vector<std::pair<libs::subjects::subject_handle, size_t>> checks;
+	std::vector<std::pair<std::string_view, size_t>> id_checks;
+	for(size_t uuid = 0; uuid < 55; ++uuid) {
+		checks.emplace_back(uuid % 5 ? h : h_one, uuid);
+		id_checks.emplace_back(uuid % 5 ? "my_files" : "unknown", uuid);
+	}
+	std::vector<bool> allowed = obj.is_allowed_batch(checks);
+	std::vector<bool> existing = obj.has_resource_batch(checks);
+	std::vector<bool> allowed_by_id = obj.is_allowed_batch(id_checks, libs::enums::rights::read);
+	std::unique_ptr<bool[]> raw(new bool[checks.size()]);
+	obj.is_allowed_batch(checks.data(), checks.size(), raw.get());
+	for(size_t i = 0; i < checks.size(); ++i) {
+		BOOST_CHECK_EQUAL(obj.is_allowed(checks[i].first, checks[i].second), allowed[i]);
+		BOOST_CHECK_EQUAL(obj.has_resource(checks[i].first, checks[i].second), existing[i]);
+		BOOST_CHECK_EQUAL(bool(allowed[i]), raw[i]);
+		BOOST_CHECK_EQUAL(i % 5 ? obj.is_allowed(h, i, libs::enums::rights::read) : false, allowed_by_id[i]);
+	}
+}
+// Testing that the checks by uuid or by resource reference neither allocate nor consume the resource
+BOOST_FIXTURE_TEST_CASE(TEST_NON_CONSUMING_CHECKS_DO_NOT_ALLOCATE, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	size_t uuid = obj.add(sub, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), libs::enums::rights::read);
+	libs::resources::resource<std::unique_ptr<std::fstream>> key;
+	key.set_uuid(uuid);
+
+	size_t allowed = 0;
+	const size_t before = g_allocations.load();
+	for(int i = 0; i < 1000; ++i) {
+		allowed += obj.is_allowed(sub, uuid);
+		allowed += obj.is_allowed(sub, key, libs::enums::rights::read);
+		allowed += obj.has_resource(sub, uuid);
+	}
+	const size_t allocations = g_allocations.load() - before;
+	BOOST_CHECK_EQUAL(0, allocations);
+	BOOST_CHECK_EQUAL(3000, allowed);
+
+	std::unique_ptr<libs::resources::resource<std::unique_ptr<std::fstream>>> uptr = obj.try_pop(sub, key);
+	BOOST_CHECK(uptr);
+	BOOST_CHECK_EQUAL(uuid, key.get_uuid());
+	BOOST_CHECK_EQUAL(false, obj.is_allowed(sub, key));
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub, uuid));
+}
+// Testing the operations by uuid without the subject
+BOOST_FIXTURE_TEST_CASE(TEST_OPERATIONS_BY_UUID_ONLY, acl_fixture)
+{
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> sub_one("my_files_one");
+	size_t uuid = obj.add(sub, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), "allowed");
+	size_t uuid_one = obj.add(sub_one, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>());
+	size_t uuid_sec = obj.add(sub_one, std::make_unique<libs::resources::resource<std::unique_ptr<std::fstream>>>(), "read");
+
+	BOOST_CHECK_EQUAL("my_files", obj.get_id(obj.owner(uuid)));
+	BOOST_CHECK_EQUAL("my_files_one", obj.get_id(obj.owner(uuid_one)));
+	BOOST_CHECK_EQUAL(false, obj.owner(42).is_valid());
+	BOOST_CHECK_EQUAL(true, obj.is_allowed(uuid));
+	BOOST_CHECK_EQUAL(false, obj.is_allowed(uuid_one));
+	BOOST_CHECK_EQUAL(true, obj.is_allowed(uuid_sec, libs::enums::rights::read));
+
+	BOOST_CHECK(obj.try_pop(uuid));
+	BOOST_CHECK(!obj.try_pop(uuid));
+	BOOST_CHECK(obj.owner(uuid) == obj.find(std::string_view("my_files")));
+
+	obj.remove(uuid_one);
+	BOOST_CHECK_EQUAL(false, obj.owner(uuid_one).is_valid());
+	BOOST_CHECK_EQUAL(false, obj.has_resource(sub_one, uuid_one));
+	BOOST_CHECK_EQUAL(true, obj.has_resource(sub_one, uuid_sec));
+
+	obj.remove(sub_one);
+	BOOST_CHECK_EQUAL(false, obj.owner(uuid_sec).is_valid());
+	BOOST_CHECK_EQUAL(false, obj.is_allowed(uuid_sec));
+	obj.remove(sub, uuid);
+	BOOST_CHECK_EQUAL(false, obj.owner(uuid).is_valid());
+}
+// Testing that the internal tables allocate from the given memory resource only
+BOOST_AUTO_TEST_CASE(TEST_ARENA_BACKED_ACL)
+{
+	static char buffer[1 << 20];
+	std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+	std::vector<std::unique_ptr<libs::resources::resource<int>>> resources;
+	for(int i = 0; i < 200; ++i) {
+		resources.push_back(std::make_unique<libs::resources::resource<int>>(i));
+	}
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> sub_one("my_files_one");
+	{
+		libs::acl::acl<std::string, int> arena_acl(&arena);
+		BOOST_CHECK(arena_acl.get_memory_resource() == &arena);
+		const size_t before = g_allocations.load();
+		for(int i = 0; i < 200; ++i) {
+			arena_acl.add(i % 2 ? sub : sub_one, std::move(resources[i]), libs::enums::rights::read);
+		}
+		arena_acl.remove(sub_one, 3);
+		arena_acl.remove(sub);
+		const size_t allocations = g_allocations.load() - before;
+		BOOST_CHECK_EQUAL(0, allocations);
+		BOOST_CHECK_EQUAL(false, arena_acl.has_resource(sub_one, 3));
+		BOOST_CHECK_EQUAL(true, arena_acl.is_allowed(sub_one, 5));
+		BOOST_CHECK_EQUAL(1, arena_acl.size());
+	}
+	arena.release();
+}
+// Testing the snapshot round trip, both queried in place and loaded back
+BOOST_AUTO_TEST_CASE(TEST_SNAPSHOT_SAVE_AND_LOAD)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_snapshot.bin").string();
+	libs::acl::acl<std::string, int> saved;
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> sub_one("my_files_one");
+	libs::subjects::subject<std::string> sub_sec("my_files_sec");
+	size_t uuid = saved.add(sub, std::make_unique<libs::resources::resource<int>>(7), libs::enums::rights::read);
+	size_t uuid_one = saved.add(sub_one, std::make_unique<libs::resources::resource<int>>(8), libs::enums::rights::all);
+	size_t uuid_sec = saved.add(sub_one, std::make_unique<libs::resources::resource<int>>(9));
+	size_t uuid_third = saved.add(sub_sec, std::make_unique<libs::resources::resource<int>>(10));
+	saved.remove(sub_sec, uuid_third);
+	BOOST_CHECK(saved.try_pop(sub_one, uuid_sec));
+	saved.save(path);
+
+	{
+		libs::snapshot::view<std::string> v(path);
+		BOOST_CHECK_EQUAL(3, v.subject_count());
+		BOOST_CHECK_EQUAL(3, v.entry_count());
+		BOOST_CHECK_EQUAL(true, v.is_allowed(std::string("my_files"), uuid, libs::enums::rights::read));
+		BOOST_CHECK_EQUAL(false, v.is_allowed(std::string("my_files"), uuid, libs::enums::rights::write));
+		BOOST_CHECK_EQUAL(false, v.is_allowed(std::string("my_files_one"), uuid));
+		BOOST_CHECK_EQUAL(true, v.has_resource(std::string("my_files_one"), uuid_sec));
+		BOOST_CHECK_EQUAL(true, v.has_subject(std::string("my_files_sec")));
+		BOOST_CHECK_EQUAL(false, v.has_subject(std::string("unknown")));
+		BOOST_CHECK_EQUAL(false, v.has_resource(std::string("my_files_sec"), uuid_third));
+	}
+	{
+		// The snapshot saved over the mapped one replaces it as a whole, the view keeps reading the old file.
+		libs::snapshot::view<std::string> old(path);
+		libs::acl::acl<std::string, int>().save(path);
+		BOOST_CHECK_EQUAL(3, old.subject_count());
+		BOOST_CHECK_EQUAL(true, old.is_allowed(std::string("my_files"), uuid, libs::enums::rights::read));
+		BOOST_CHECK_EQUAL(0, libs::snapshot::view<std::string>(path).subject_count());
+		BOOST_CHECK_EQUAL(false, std::filesystem::exists(path + ".tmp"));
+		saved.save(path);
+	}
+
+	libs::acl::acl<std::string, int> loaded;
+	loaded.load(path);
+	BOOST_CHECK_EQUAL(3, loaded.size());
+	BOOST_CHECK_EQUAL(true, loaded.is_allowed(sub, uuid, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, loaded.is_allowed(sub_one, uuid_one, libs::enums::rights::all));
+	BOOST_CHECK_EQUAL(true, loaded.has_resource(sub_one, uuid_sec));
+	BOOST_CHECK_EQUAL(true, loaded.has_subject(sub_sec));
+	BOOST_CHECK_EQUAL(false, loaded.has_resource(sub_sec, uuid_third));
+	std::unique_ptr<libs::resources::resource<int>> uptr = loaded.try_pop(sub_one, uuid_one);
+	BOOST_CHECK(uptr);
+	BOOST_CHECK_EQUAL(8, *uptr.get()->get_resource());
+	BOOST_CHECK_EQUAL(uuid_one, uptr.get()->get_uuid());
+	BOOST_CHECK(!loaded.try_pop(sub_one, uuid_sec));
+	BOOST_CHECK_EQUAL(uuid_third + 1, loaded.add(sub, std::make_unique<libs::resources::resource<int>>(11)));
+	BOOST_CHECK_THROW(loaded.load(path), libs::exception::custom_exception);
+
+	{
+		std::fstream corrupt(path, std::ios::in | std::ios::out | std::ios::binary);
+		corrupt.seekp(-1, std::ios::end);
+		corrupt.put('\x7f');
+	}
+	libs::acl::acl<std::string, int> rejected;
+	BOOST_CHECK_THROW(rejected.load(path), libs::exception::custom_exception);
+
+	// The counts and the offsets which wrap around once summed are rejected rather than read past the file.
+	libs::snapshot::header h;
+	saved.save(path);
+	{
+		std::fstream crafted(path, std::ios::in | std::ios::out | std::ios::binary);
+		crafted.read(reinterpret_cast<char*>(&h), sizeof(h));
+		h.subject_count += std::uint64_t(1) << 60;
+		crafted.seekp(0);
+		crafted.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	}
+	BOOST_CHECK_THROW(libs::snapshot::view<std::string>(path, false), libs::exception::custom_exception);
+	saved.save(path);
+	{
+		std::fstream crafted(path, std::ios::in | std::ios::out | std::ios::binary);
+		crafted.read(reinterpret_cast<char*>(&h), sizeof(h));
+		libs::snapshot::entry_record e;
+		crafted.seekg(h.entries_offset);
+		crafted.read(reinterpret_cast<char*>(&e), sizeof(e));
+		e.resource_offset = libs::snapshot::no_resource - 2;
+		crafted.seekp(h.entries_offset);
+		crafted.write(reinterpret_cast<const char*>(&e), sizeof(e));
+	}
+	BOOST_CHECK_THROW(libs::snapshot::view<std::string>(path, false), libs::exception::custom_exception);
+	// The uuids of the grants must strictly increase below the next uuid, which itself is bounded.
+	const auto craft_uuid = [&path, &saved, &h](const size_t index, const std::uint64_t uuid, const std::uint64_t next_uuid) {
+		saved.save(path);
+		std::fstream crafted(path, std::ios::in | std::ios::out | std::ios::binary);
+		crafted.read(reinterpret_cast<char*>(&h), sizeof(h));
+		libs::snapshot::entry_record e;
+		crafted.seekg(h.entries_offset + index * sizeof(e));
+		crafted.read(reinterpret_cast<char*>(&e), sizeof(e));
+		e.uuid = uuid;
+		h.next_uuid = next_uuid;
+		crafted.seekp(0);
+		crafted.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		crafted.seekp(h.entries_offset + index * sizeof(e));
+		crafted.write(reinterpret_cast<const char*>(&e), sizeof(e));
+	};
+	craft_uuid(0, uuid, uuid_third + 1);
+	BOOST_CHECK_NO_THROW(libs::snapshot::view<std::string>(path, false));
+	craft_uuid(0, 0, uuid_third + 1);
+	BOOST_CHECK_THROW(libs::snapshot::view<std::string>(path, false), libs::exception::custom_exception);
+	craft_uuid(1, uuid, uuid_third + 1);
+	BOOST_CHECK_THROW(libs::snapshot::view<std::string>(path, false), libs::exception::custom_exception);
+	craft_uuid(1, uuid_third + 1, uuid_third + 1);
+	BOOST_CHECK_THROW(libs::snapshot::view<std::string>(path, false), libs::exception::custom_exception);
+	craft_uuid(0, uuid, libs::snapshot::max_next_uuid + 1);
+	BOOST_CHECK_THROW(libs::snapshot::view<std::string>(path, false), libs::exception::custom_exception);
+	std::filesystem::remove(path);
+}
+// Testing the journal replay on top of an empty acl and of a snapshot taken in between
+BOOST_AUTO_TEST_CASE(TEST_JOURNAL_REPLAY)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_journal.bin").string();
+	const std::string snapshot_path = (std::filesystem::temp_directory_path() / "acl_test_journal_snapshot.bin").string();
+	std::filesystem::remove(path);
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> sub_one("my_files_one");
+	size_t uuid = 0;
+	size_t uuid_one = 0;
+	size_t uuid_sec = 0;
+	{
+		libs::journal::writer journal(path);
+		libs::acl::acl<std::string, int> journaled;
+		journaled.attach_journal(&journal);
+		uuid = journaled.add(sub, std::make_unique<libs::resources::resource<int>>(7), libs::enums::rights::read);
+		uuid_one = journaled.add(sub_one, std::make_unique<libs::resources::resource<int>>(8));
+		journaled.save(snapshot_path);
+		uuid_sec = journaled.add(sub_one, std::make_unique<libs::resources::resource<int>>(9));
+		journaled.allow_access(sub, uuid, libs::enums::rights::write);
+		journaled.forbid_access(sub, uuid, libs::enums::rights::read);
+		journaled.allow_access(sub_one, uuid_sec);
+		BOOST_CHECK(journaled.try_pop(sub_one, uuid_sec));
+		journaled.remove(sub_one, uuid_one);
+		journaled.add(sub, std::make_unique<libs::resources::resource<int>>(10));
+		journaled.remove(sub);
+		BOOST_CHECK_EQUAL(10, journaled.journal_lsn());
+		journal.commit(journaled.journal_lsn());
+		BOOST_CHECK_EQUAL(1, journal.sync_count());
+	}
+	{
+		std::ofstream torn(path, std::ios::binary | std::ios::app);
+		torn.write("\x40\x00\x00\x00\x01", 5);
+	}
+
+	libs::acl::acl<std::string, int> replayed;
+	BOOST_CHECK_EQUAL(10, replayed.replay(path));
+	libs::acl::acl<std::string, int> recovered;
+	recovered.load(snapshot_path);
+	BOOST_CHECK_EQUAL(10, recovered.replay(path));
+	for(libs::acl::acl<std::string, int>* a : {&replayed, &recovered}) {
+		BOOST_CHECK_EQUAL(1, a->size());
+		BOOST_CHECK_EQUAL(false, a->has_subject(sub));
+		BOOST_CHECK_EQUAL(false, a->has_resource(sub_one, uuid_one));
+		BOOST_CHECK_EQUAL(true, a->is_allowed(sub_one, uuid_sec, libs::enums::rights::all));
+		BOOST_CHECK(!a->try_pop(sub_one, uuid_sec));
+		BOOST_CHECK_EQUAL(uuid_sec + 2, a->add(sub, std::make_unique<libs::resources::resource<int>>(11)));
+	}
+	// The writer cuts the torn tail off, so the records committed after the restart are replayed too.
+	size_t uuid_restarted = 0;
+	{
+		libs::journal::writer journal(path);
+		libs::acl::acl<std::string, int> restarted;
+		BOOST_CHECK_EQUAL(10, restarted.replay(path));
+		restarted.attach_journal(&journal);
+		uuid_restarted = restarted.add(sub, std::make_unique<libs::resources::resource<int>>(12), libs::enums::rights::read);
+		journal.commit(restarted.journal_lsn());
+	}
+	{
+		libs::acl::acl<std::string, int> reopened;
+		BOOST_CHECK_EQUAL(11, reopened.replay(path));
+		BOOST_CHECK_EQUAL(true, reopened.is_allowed(sub, uuid_restarted, libs::enums::rights::read));
+		// Once saved into the snapshot the records are dropped from the journal.
+		libs::journal::writer journal(path);
+		reopened.save(snapshot_path);
+		journal.reset();
+		BOOST_CHECK_EQUAL(0, std::filesystem::file_size(path));
+		reopened.attach_journal(&journal);
+		reopened.remove(sub, uuid_restarted);
+		journal.commit(reopened.journal_lsn());
+	}
+	libs::acl::acl<std::string, int> compacted;
+	compacted.load(snapshot_path);
+	BOOST_CHECK_EQUAL(1, compacted.replay(path));
+	BOOST_CHECK_EQUAL(false, compacted.has_resource(sub, uuid_restarted));
+	BOOST_CHECK_EQUAL(true, compacted.is_allowed(sub_one, uuid_sec, libs::enums::rights::all));
+	std::filesystem::remove(path);
+	std::filesystem::remove(snapshot_path);
+}
+// Testing that the concurrent committers share the syncs
+BOOST_AUTO_TEST_CASE(TEST_JOURNAL_GROUP_COMMIT)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_group_commit.bin").string();
+	std::filesystem::remove(path);
+	const int threads = 4;
+	const int records = 200;
+	{
+		libs::journal::writer journal(path);
+		std::vector<std::thread> workers;
+		for(int t = 0; t < threads; ++t) {
+			workers.emplace_back([&journal, t]() {
+				for(int i = 0; i < records; ++i) {
+					std::string data;
+					libs::journal::put(data, static_cast<std::uint64_t>(t * records + i + 1));
+					libs::journal::put(data, std::uint8_t{1});
+					journal.commit(journal.append(libs::journal::op::allow, data));
+				}
+			});
+		}
+		for(std::thread& w : workers) {
+			w.join();
+		}
+		BOOST_CHECK_EQUAL(threads * records, journal.last_lsn());
+		BOOST_CHECK(journal.sync_count() <= static_cast<std::uint64_t>(threads * records));
+	}
+	libs::journal::reader reader(path);
+	libs::journal::op o;
+	std::string_view data;
+	std::set<std::uint64_t> seen;
+	while(reader.next(o, data)) {
+		libs::journal::payload in(data);
+		std::uint64_t uuid = 0;
+		BOOST_CHECK(in.get(uuid));
+		seen.insert(uuid);
+	}
+	BOOST_CHECK_EQUAL(threads * records, seen.size());
+	std::filesystem::remove(path);
+}
+// Testing that a failed write fails the commits of its batch and of all the later records
+BOOST_AUTO_TEST_CASE(TEST_JOURNAL_FAILED_WRITE)
+{
+	// Every write to the full device fails with no space left.
+	if(!std::filesystem::exists("/dev/full")) {
+		return;
+	}
+	libs::journal::writer journal("/dev/full", false);
+	std::string data;
+	libs::journal::put(data, std::uint64_t{1});
+	libs::journal::put(data, std::uint8_t{1});
+	const std::uint64_t first = journal.append(libs::journal::op::allow, data);
+	BOOST_CHECK_THROW(journal.commit(first), libs::exception::custom_exception);
+	const std::uint64_t second = journal.append(libs::journal::op::allow, data);
+	BOOST_CHECK_THROW(journal.commit(second), libs::exception::custom_exception);
+	BOOST_CHECK_THROW(journal.commit(first), libs::exception::custom_exception);
+	BOOST_CHECK_EQUAL(0, journal.sync_count());
+}
+// Testing the operation counters, the latency histograms and the table sizes
+BOOST_AUTO_TEST_CASE(TEST_METRICS)
+{
+	static_assert(std::is_empty<libs::metrics::registry<false>>::value, "The disabled metrics must be empty");
+	static_assert(std::is_empty<libs::metrics::scoped_timer<false>>::value, "The disabled timer must be empty");
+	libs::acl::acl<std::string, int> counted;
+	libs::subjects::subject<std::string> sub("my_files");
+	libs::subjects::subject<std::string> unknown("unknown");
+	size_t uuid = counted.add(sub, std::make_unique<libs::resources::resource<int>>(1), libs::enums::rights::read);
+	size_t uuid_one = counted.add(sub, std::make_unique<libs::resources::resource<int>>(2));
+	BOOST_CHECK_EQUAL(true, counted.is_allowed(sub, uuid));
+	BOOST_CHECK_EQUAL(false, counted.is_allowed(sub, uuid_one));
+	BOOST_CHECK_EQUAL(false, counted.is_allowed(unknown, uuid));
+	BOOST_CHECK_EQUAL(true, counted.has_subject(sub));
+	BOOST_CHECK_EQUAL(false, counted.has_subject(unknown));
+	BOOST_CHECK_EQUAL(true, counted.has_resource(sub, uuid_one));
+	BOOST_CHECK(counted.try_pop(sub, uuid_one));
+	BOOST_CHECK(!counted.try_pop(sub, uuid_one));
+	counted.remove(sub, uuid);
+
+	libs::metrics::snapshot m = counted.get_metrics();
+	BOOST_CHECK_EQUAL(true, m.enabled);
+	BOOST_CHECK_EQUAL(2, m.get(libs::metrics::counter::add));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::is_allowed_hit));
+	BOOST_CHECK_EQUAL(2, m.get(libs::metrics::counter::is_allowed_miss));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::has_subject_hit));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::has_subject_miss));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::has_resource_hit));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::pop_hit));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::pop_miss));
+	BOOST_CHECK_EQUAL(1, m.get(libs::metrics::counter::remove_grant));
+	BOOST_CHECK(m.get(libs::metrics::counter::subject_rehash) >= 1);
+	BOOST_CHECK(m.get(libs::metrics::counter::store_growth) >= 1);
+	BOOST_CHECK_EQUAL(3, m.latency(libs::metrics::op::is_allowed).count());
+	BOOST_CHECK_EQUAL(2, m.latency(libs::metrics::op::try_pop).count());
+	BOOST_CHECK(m.latency(libs::metrics::op::is_allowed).percentile(0.5) > 0);
+	BOOST_CHECK_EQUAL(1, m.tables.subjects);
+	BOOST_CHECK_EQUAL(1, m.tables.interned_subjects);
+	BOOST_CHECK_EQUAL(1, m.tables.grants);
+	BOOST_CHECK_EQUAL(16, m.tables.index_size);
+	BOOST_CHECK(m.tables.subject_load_factor > 0);
+}
+// Testing that the uuid index follows the live grants rather than the uuids ever handed out
+BOOST_AUTO_TEST_CASE(TEST_STORE_INDEX_FOLLOWS_GRANTS)
+{
+	libs::acl::acl<std::string, int> acl;
+	libs::subjects::subject<std::string> sub("my_files");
+	const size_t kept = acl.add(sub, std::make_unique<libs::resources::resource<int>>(0), libs::enums::rights::read);
+	for(int i = 0; i < 100000; ++i) {
+		const size_t uuid = acl.add(sub, std::make_unique<libs::resources::resource<int>>(i));
+		BOOST_REQUIRE_EQUAL(true, acl.has_resource(sub, uuid));
+		acl.remove(sub, uuid);
+	}
+	BOOST_CHECK_EQUAL(16, acl.get_metrics().tables.index_size);
+	std::vector<size_t> uuids;
+	for(int i = 0; i < 10000; ++i) {
+		uuids.push_back(acl.add(sub, std::make_unique<libs::resources::resource<int>>(i)));
+	}
+	BOOST_CHECK(acl.get_metrics().tables.index_size >= 2 * 10001);
+	for(size_t i = 0; i < uuids.size(); i += 2) {
+		acl.remove(sub, uuids[i]);
+	}
+	for(size_t i = 0; i < uuids.size(); ++i) {
+		BOOST_REQUIRE_EQUAL(i % 2 == 1, acl.has_resource(sub, uuids[i]));
+	}
+	for(size_t i = 1; i < uuids.size(); i += 2) {
+		acl.remove(sub, uuids[i]);
+	}
+	acl.add(sub, std::make_unique<libs::resources::resource<int>>(1));
+	BOOST_CHECK_EQUAL(16, acl.get_metrics().tables.index_size);
+	BOOST_CHECK_EQUAL(true, acl.is_allowed(sub, kept, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(2, acl.get_metrics().tables.grants);
+}
+// Testing the grants shared through the nested roles
+BOOST_AUTO_TEST_CASE(TEST_ROLE_GRANTS)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_roles.bin").string();
+	libs::acl::acl<std::string, int> roles;
+	libs::subjects::subject<std::string> alice("alice");
+	libs::subjects::subject<std::string> bob("bob");
+	libs::subjects::subject<std::string> editors("editors");
+	libs::subjects::subject<std::string> staff("staff");
+	size_t uuid = roles.add(editors, std::make_unique<libs::resources::resource<int>>(1), libs::enums::rights::write);
+	size_t uuid_one = roles.add(staff, std::make_unique<libs::resources::resource<int>>(2), libs::enums::rights::read);
+	size_t uuid_sec = roles.add(bob, std::make_unique<libs::resources::resource<int>>(3), libs::enums::rights::all);
+	BOOST_CHECK_EQUAL(true, roles.add_member(editors, alice));
+	BOOST_CHECK_EQUAL(false, roles.add_member(editors, alice));
+	BOOST_CHECK_EQUAL(true, roles.add_member(staff, editors));
+	BOOST_CHECK_THROW(roles.add_member(alice, staff), libs::exception::custom_exception);
+	BOOST_CHECK_EQUAL(true, roles.is_member(alice, staff));
+	BOOST_CHECK_EQUAL(false, roles.is_member(staff, alice));
+	BOOST_CHECK_EQUAL(4, roles.size());
+	BOOST_CHECK_EQUAL(true, roles.is_allowed(alice, uuid, libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(false, roles.is_allowed(alice, uuid, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, roles.is_allowed(alice, uuid_one, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, roles.is_allowed(editors, uuid_one));
+	BOOST_CHECK_EQUAL(false, roles.is_allowed(alice, uuid_sec));
+	BOOST_CHECK_EQUAL(false, roles.is_allowed(bob, uuid));
+	BOOST_CHECK_EQUAL(false, roles.has_resource(alice, uuid));
+	std::vector<bool> results = roles.is_allowed_batch({{roles.find("alice"), uuid_one}, {roles.find("bob"), uuid_one}});
+	BOOST_CHECK_EQUAL(true, results[0]);
+	BOOST_CHECK_EQUAL(false, results[1]);
+
+	roles.save(path);
+	libs::snapshot::view<std::string> v(path);
+	BOOST_CHECK_EQUAL(2, v.membership_count());
+	BOOST_CHECK_EQUAL(true, v.is_allowed(std::string("alice"), uuid_one, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(false, v.is_allowed(std::string("bob"), uuid_one));
+	libs::acl::acl<std::string, int> loaded;
+	loaded.load(path);
+	BOOST_CHECK_EQUAL(true, loaded.is_allowed(alice, uuid_one, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, loaded.is_member(alice, staff));
+	std::filesystem::remove(path);
+
+	BOOST_CHECK_EQUAL(true, roles.remove_member(staff, editors));
+	BOOST_CHECK_EQUAL(false, roles.is_allowed(alice, uuid_one));
+	BOOST_CHECK_EQUAL(true, roles.is_allowed(alice, uuid));
+	roles.add_member(staff, editors);
+	roles.remove(staff);
+	BOOST_CHECK_EQUAL(false, roles.is_allowed(alice, uuid_one));
+	BOOST_CHECK_EQUAL(false, roles.is_member(alice, staff));
+	BOOST_CHECK_EQUAL(true, roles.is_allowed(alice, uuid));
+	roles.remove(editors);
+	BOOST_CHECK_EQUAL(false, roles.is_allowed(alice, uuid));
+}
+// Testing that the snapshot finds the subjects serialized in place
+BOOST_AUTO_TEST_CASE(TEST_SNAPSHOT_NUMERIC_SUBJECTS)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_numeric.bin").string();
+	libs::acl::acl<int, int> numbers;
+	std::vector<size_t> uuids;
+	for(int i = -3; i <= 3; ++i) {
+		uuids.push_back(numbers.add(libs::subjects::subject<int>(i), std::make_unique<libs::resources::resource<int>>(i),
+				libs::enums::rights::read));
+	}
+	numbers.save(path);
+	libs::snapshot::view<int> v(path);
+	BOOST_CHECK_EQUAL(true, v.has_subject(-3));
+	BOOST_CHECK_EQUAL(true, v.has_subject(3));
+	BOOST_CHECK_EQUAL(false, v.has_subject(4));
+	BOOST_CHECK_EQUAL(true, v.has_resource(0, uuids[3]));
+	BOOST_CHECK_EQUAL(false, v.has_resource(1, uuids[3]));
+	BOOST_CHECK_EQUAL(true, v.is_allowed(-1, uuids[2], libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, libs::serialization::has_bytes<std::string>::value);
+	std::filesystem::remove(path);
+}
+// Testing that the snapshot walks the roles nested deeper than its inline walk
+BOOST_AUTO_TEST_CASE(TEST_SNAPSHOT_DEEP_ROLES)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_deep_roles.bin").string();
+	libs::acl::acl<std::string, int> roles;
+	const size_t depth = 100;
+	for(size_t i = 0; i < depth; ++i) {
+		roles.add_member(libs::subjects::subject<std::string>("role_" + std::to_string(i + 1)),
+				libs::subjects::subject<std::string>("role_" + std::to_string(i)));
+	}
+	const size_t top = roles.add(libs::subjects::subject<std::string>("role_" + std::to_string(depth)),
+			std::make_unique<libs::resources::resource<int>>(1), libs::enums::rights::read);
+	const size_t near = roles.add(libs::subjects::subject<std::string>("role_3"),
+			std::make_unique<libs::resources::resource<int>>(2), libs::enums::rights::read);
+	roles.save(path);
+	libs::snapshot::view<std::string> v(path);
+	BOOST_CHECK_EQUAL(depth, v.membership_count());
+	BOOST_CHECK_EQUAL(true, v.is_allowed(std::string("role_0"), top, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, v.is_allowed(std::string("role_0"), near, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(false, v.is_allowed(std::string("role_4"), near));
+	BOOST_CHECK_EQUAL(false, v.is_allowed(std::string("missing"), top));
+	std::filesystem::remove(path);
+}
+// Testing the longest prefix and the deny overrides resolution of the path grants
+BOOST_AUTO_TEST_CASE(TEST_PATH_GRANTS)
+{
+	libs::acl::acl<std::string, int> tree;
+	libs::subjects::subject<std::string> alice("alice");
+	libs::subjects::subject<std::string> bob("bob");
+	libs::subjects::subject<std::string> tenants("tenants");
+	tree.allow_path(alice, "/data/tenant42", libs::enums::rights::read | libs::enums::rights::write);
+	tree.deny_path(alice, "/data/tenant42/secrets", libs::enums::rights::write);
+	tree.allow_path(alice, "/data/tenant42/secrets", libs::enums::rights::read);
+	tree.allow_path(tenants, "/data", libs::enums::rights::read);
+	tree.deny_path(tenants, "/data/tenant42/archive/2020");
+	tree.add_member(tenants, bob);
+	BOOST_CHECK_EQUAL(true, tree.is_allowed_path(alice, "/data/tenant42/a/b/c.txt", libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(true, tree.is_allowed_path(alice, "data//tenant42/", libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(alice, "/data/tenant4", libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(alice, "/data/tenant42/secrets/key", libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(true, tree.is_allowed_path(alice, "/data/tenant42/secrets/key", libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(alice, "/other"));
+	BOOST_CHECK_EQUAL(true, tree.is_allowed_path(bob, "/data/tenant42/archive/2019"));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(bob, "/data/tenant42/archive/2020/jan"));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(bob, "/data/tenant42", libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(true, tree.remove_path(alice, "data/tenant42/secrets"));
+	BOOST_CHECK_EQUAL(true, tree.is_allowed_path(alice, "/data/tenant42/secrets/key", libs::enums::rights::write));
+	tree.remove(tenants);
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(bob, "/data/tenant42/archive/2019"));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(libs::subjects::subject<std::string>("unknown"), "/data"));
+
+	// The only rule under the prefix is removed along with its entry.
+	libs::paths::path_trie trie;
+	trie.add("/logs", 3, libs::enums::rights::read, false);
+	trie.add("/logs/audit", 3, libs::enums::rights::read, true);
+	BOOST_CHECK_EQUAL(true, trie.remove("/logs/audit", 3));
+	BOOST_CHECK_EQUAL(1, trie.size());
+	BOOST_CHECK_EQUAL(true, trie.dirty());
+	BOOST_CHECK_EQUAL(false, trie.remove("/logs/audit", 3));
+	trie.compile();
+	libs::enums::rights effective = libs::enums::rights::none;
+	BOOST_CHECK_EQUAL(true, trie.resolve("/logs/audit/2024", [](std::uint32_t subject) {
+		return subject == 3;
+	}, effective));
+	BOOST_CHECK(libs::enums::rights::read == effective);
+	tree.allow_path(bob, "/single", libs::enums::rights::read);
+	BOOST_CHECK_EQUAL(true, tree.remove_path(bob, "/single"));
+	BOOST_CHECK_EQUAL(false, tree.is_allowed_path(bob, "/single"));
+	BOOST_CHECK_EQUAL(false, tree.remove_path(bob, "/single"));
+	BOOST_CHECK_THROW(tree.allow_path(libs::acl::acl<std::string, int>::handle_type{}, "/data"), libs::exception::custom_exception);
+	BOOST_CHECK_THROW(tree.deny_path(libs::acl::acl<std::string, int>::handle_type{1000}, "/data"), libs::exception::custom_exception);
+}
+// Testing that the expired grants are forbidden at once and reclaimed by the timer wheel
+BOOST_AUTO_TEST_CASE(TEST_EXPIRING_GRANTS)
+{
+	using clock = libs::acl::acl<std::string, int>::clock;
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_expiries.bin").string();
+	libs::acl::acl<std::string, int> timed;
+	libs::subjects::subject<std::string> alice("alice");
+	const clock::time_point now = clock::now();
+	size_t uuid = timed.add(alice, std::make_unique<libs::resources::resource<int>>(1), libs::enums::rights::read, now - std::chrono::seconds(1));
+	size_t uuid_one = timed.add(alice, std::make_unique<libs::resources::resource<int>>(2), libs::enums::rights::read, now + std::chrono::hours(1));
+	size_t uuid_sec = timed.add(alice, std::make_unique<libs::resources::resource<int>>(3), libs::enums::rights::read);
+	timed.allow_access(alice, uuid_sec, libs::enums::rights::write, now + std::chrono::minutes(1));
+	BOOST_CHECK_EQUAL(false, timed.is_allowed(alice, uuid));
+	BOOST_CHECK_EQUAL(true, timed.has_resource(alice, uuid));
+	BOOST_CHECK_EQUAL(true, timed.is_allowed(alice, uuid_one, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, timed.is_allowed(alice, uuid_sec, libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(3, timed.pending_expiries());
+
+	timed.save(path);
+	libs::snapshot::view<std::string> v(path);
+	BOOST_CHECK_EQUAL(3, v.expiry_count());
+	BOOST_CHECK_EQUAL(false, v.is_allowed(std::string("alice"), uuid));
+	BOOST_CHECK_EQUAL(true, v.is_allowed(std::string("alice"), uuid_sec, libs::enums::rights::write));
+	libs::acl::acl<std::string, int> loaded;
+	loaded.load(path);
+	BOOST_CHECK_EQUAL(false, loaded.is_allowed(alice, uuid));
+	BOOST_CHECK_EQUAL(3, loaded.pending_expiries());
+	std::filesystem::remove(path);
+
+	BOOST_CHECK_EQUAL(1, timed.reclaim_expired());
+	BOOST_CHECK_EQUAL(false, timed.has_resource(alice, uuid));
+	BOOST_CHECK_EQUAL(1, timed.reclaim_expired(now + std::chrono::minutes(2)));
+	BOOST_CHECK_EQUAL(false, timed.is_allowed(alice, uuid_sec, libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(true, timed.is_allowed(alice, uuid_sec, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(1, timed.reclaim_expired(now + std::chrono::hours(2)));
+	BOOST_CHECK_EQUAL(0, timed.pending_expiries());
+	BOOST_CHECK_EQUAL(true, timed.has_resource(alice, uuid_sec));
+	BOOST_CHECK_EQUAL(false, timed.has_resource(alice, uuid_one));
+
+	// The superseded timers are skipped, the reclaiming is bounded by the budget.
+	libs::timers::timer_wheel wheel(1, 0);
+	for(std::uint64_t i = 0; i < 1000; ++i) {
+		wheel.schedule(libs::timers::timer{static_cast<std::int64_t>(i * 977 % 100000), i, 0});
+	}
+	wheel.schedule(libs::timers::timer{std::int64_t(1) << 40, 1000, 0});
+	size_t expired = 0;
+	BOOST_CHECK_EQUAL(false, wheel.advance(100000, 100, [&expired](const libs::timers::timer&) { ++expired; }));
+	BOOST_CHECK(expired <= 100);
+	while(!wheel.advance(100000, 100, [&expired](const libs::timers::timer& t) { BOOST_CHECK(t.deadline <= 100000); ++expired; })) {}
+	BOOST_CHECK_EQUAL(1000, expired);
+	BOOST_CHECK_EQUAL(1, wheel.size());
+}
+// Testing that the bulk add builds the same acl as the one by one adds, on one and on several threads
+BOOST_AUTO_TEST_CASE(TEST_BULK_ADD)
+{
+	for(const unsigned threads : {1u, 4u}) {
+		libs::acl::acl<std::string, int> bulk;
+		libs::subjects::subject<std::string> alice("alice");
+		size_t uuid = bulk.add(alice, std::make_unique<libs::resources::resource<int>>(0), libs::enums::rights::read);
+		std::vector<std::tuple<std::string, std::unique_ptr<libs::resources::resource<int>>, libs::enums::rights>> grants;
+		for(int i = 0; i < 1000; ++i) {
+			grants.emplace_back(i % 3 == 0 ? std::string("alice") : "subject_" + std::to_string(i % 17),
+					std::make_unique<libs::resources::resource<int>>(i), i % 2 ? libs::enums::rights::write : libs::enums::rights::none);
+		}
+		const std::pair<size_t, size_t> range = bulk.add_all(grants, threads);
+		BOOST_CHECK_EQUAL(uuid + 1, range.first);
+		BOOST_CHECK_EQUAL(uuid + 1001, range.second);
+		BOOST_CHECK_EQUAL(18, bulk.size());
+		for(int i = 0; i < 1000; ++i) {
+			libs::subjects::subject<std::string> sub(std::get<0>(grants[i]));
+			BOOST_CHECK_EQUAL(true, bulk.has_resource(sub, range.first + i));
+			BOOST_CHECK_EQUAL(i % 2 == 1, bulk.is_allowed(sub, range.first + i, libs::enums::rights::write));
+		}
+		BOOST_CHECK_EQUAL(range.second, bulk.add(alice, std::make_unique<libs::resources::resource<int>>(0)));
+		std::unique_ptr<libs::resources::resource<int>> res = bulk.try_pop(alice, range.first + 3);
+		BOOST_REQUIRE(res != nullptr);
+		BOOST_CHECK_EQUAL(3, *res->get_resource());
+		bulk.remove(alice);
+		BOOST_CHECK_EQUAL(false, bulk.has_resource(alice, uuid));
+		BOOST_CHECK_EQUAL(false, bulk.has_resource(alice, range.first));
+		BOOST_CHECK_EQUAL(true, bulk.has_resource(libs::subjects::subject<std::string>("subject_1"), range.first + 1));
+		BOOST_CHECK_EQUAL(17, bulk.size());
+	}
+	// A bad access level fails the whole batch before any grant is added.
+	libs::acl::acl<std::string, int> bulk;
+	libs::subjects::subject<std::string> alice("alice");
+	const size_t uuid = bulk.add(alice, std::make_unique<libs::resources::resource<int>>(0), libs::enums::rights::read);
+	std::vector<std::tuple<std::string, std::unique_ptr<libs::resources::resource<int>>, std::string>> grants;
+	for(int i = 0; i < 100; ++i) {
+		grants.emplace_back(i % 2 ? std::string("alice") : "subject_" + std::to_string(i), std::make_unique<libs::resources::resource<int>>(i),
+				i == 57 ? "read|bogus" : "read|write");
+	}
+	BOOST_CHECK_THROW(bulk.add_all(grants, 4), libs::exception::custom_exception);
+	BOOST_CHECK_EQUAL(1, bulk.size());
+	for(const auto& grant : grants) {
+		BOOST_CHECK(std::get<1>(grant) != nullptr);
+	}
+	BOOST_CHECK_EQUAL(uuid + 1, bulk.add(alice, std::make_unique<libs::resources::resource<int>>(1)));
+	std::get<2>(grants[57]) = "read";
+	const std::pair<size_t, size_t> range = bulk.add_all(grants, 4);
+	BOOST_CHECK_EQUAL(uuid + 2, range.first);
+	bulk.remove(uuid + 1);
+	BOOST_CHECK_EQUAL(51, bulk.resources_of(alice).size());
+	BOOST_CHECK_EQUAL(true, bulk.is_allowed(alice, range.first + 57, libs::enums::rights::read));
+}
+// Testing that the frozen acl answers like the acl it has been frozen from
+BOOST_AUTO_TEST_CASE(TEST_FROZEN_ACL)
+{
+	libs::acl::acl<std::string, int> live;
+	std::vector<size_t> uuids;
+	for(int i = 0; i < 5000; ++i) {
+		libs::subjects::subject<std::string> sub("subject_" + std::to_string(i % 1000));
+		uuids.push_back(live.add(sub, std::make_unique<libs::resources::resource<int>>(i),
+				i % 3 ? libs::enums::rights::read : libs::enums::rights::read | libs::enums::rights::write));
+	}
+	libs::subjects::subject<std::string> alice("alice");
+	libs::subjects::subject<std::string> staff("staff");
+	libs::subjects::subject<std::string> editors("editors");
+	size_t shared = live.add(staff, std::make_unique<libs::resources::resource<int>>(0), libs::enums::rights::read);
+	size_t expired = live.add(alice, std::make_unique<libs::resources::resource<int>>(0), libs::enums::rights::read,
+			std::chrono::system_clock::now() - std::chrono::seconds(1));
+	live.add_member(staff, editors);
+	live.add_member(editors, alice);
+	live.remove(libs::subjects::subject<std::string>("subject_7"));
+	const libs::frozen::frozen_acl<std::string> frozen = live.freeze();
+	BOOST_CHECK_EQUAL(live.size(), frozen.size());
+	for(int i = 0; i < 5000; ++i) {
+		libs::subjects::subject<std::string> sub("subject_" + std::to_string(i % 1000));
+		BOOST_CHECK_EQUAL(live.has_resource(sub, uuids[i]), frozen.has_resource(sub, uuids[i]));
+		BOOST_CHECK_EQUAL(live.is_allowed(sub, uuids[i], libs::enums::rights::write), frozen.is_allowed(sub, uuids[i], libs::enums::rights::write));
+		BOOST_CHECK_EQUAL(live.has_subject(sub), frozen.has_subject(sub));
+	}
+	BOOST_CHECK_EQUAL(false, frozen.has_subject(libs::subjects::subject<std::string>("subject_7")));
+	BOOST_CHECK_EQUAL(false, frozen.has_subject(libs::subjects::subject<std::string>("unknown")));
+	BOOST_CHECK_EQUAL(true, frozen.is_allowed(alice, shared, libs::enums::rights::read));
+	BOOST_CHECK_EQUAL(true, frozen.is_member(alice, staff));
+	BOOST_CHECK_EQUAL(false, frozen.is_member(staff, alice));
+	BOOST_CHECK_EQUAL(false, frozen.is_allowed(alice, expired));
+	BOOST_CHECK_EQUAL(true, frozen.has_resource(alice, expired));
+	BOOST_CHECK_EQUAL(false, frozen.is_allowed(std::string_view("unknown"), shared));
+
+	// Readers share the frozen acl without any synchronization.
+	std::atomic<size_t> hits{0};
+	std::vector<std::thread> readers;
+	for(int t = 0; t < 4; ++t) {
+		readers.emplace_back([&frozen, &hits, &uuids] {
+			for(int i = 0; i < 5000; ++i) {
+				hits += frozen.is_allowed(std::string_view("subject_1"), uuids[1]);
+			}
+		});
+	}
+	for(std::thread& r : readers) {
+		r.join();
+	}
+	BOOST_CHECK_EQUAL(20000, hits.load());
+	BOOST_CHECK(frozen.memory_usage() < 5000 * 64);
+}
+
+BOOST_AUTO_TEST_CASE(TEST_STATUS_CODES)
+{
+	libs::acl::acl<std::string, int> acl;
+	libs::subjects::subject<std::string> sub("subject");
+	libs::subjects::subject<std::string> unknown("unknown");
+	libs::subjects::subject<std::string> empty;
+	libs::status::result<size_t> added = acl.try_add(sub, std::make_unique<libs::resources::resource<int>>(1), "read|write");
+	BOOST_CHECK(added.has_value());
+	BOOST_CHECK(libs::status::code::invalid_access_level == acl.try_add(sub, std::make_unique<libs::resources::resource<int>>(1), "read|root").error());
+	BOOST_CHECK(libs::status::code::invalid_subject == acl.try_add(empty, std::make_unique<libs::resources::resource<int>>(1)).error());
+	BOOST_CHECK(libs::status::code::invalid_resource == acl.try_add(sub, nullptr).error());
+	BOOST_CHECK(libs::status::code::unknown_subject == acl.try_allow_access(unknown, added.value()));
+	BOOST_CHECK(libs::status::code::unknown_resource == acl.try_forbid_access(sub, added.value() + 100));
+	BOOST_CHECK(libs::status::code::ok == acl.try_forbid_access(sub, added.value(), libs::enums::rights::write));
+	BOOST_CHECK_EQUAL(false, acl.is_allowed(sub, added.value(), libs::enums::rights::write));
+	BOOST_CHECK(libs::status::code::ok == acl.try_remove(sub, added.value()));
+	BOOST_CHECK(libs::status::code::unknown_resource == acl.try_remove(sub, added.value()));
+	BOOST_CHECK(libs::status::code::unknown_subject == acl.try_remove(unknown));
+	BOOST_CHECK_THROW(acl.add(empty, std::make_unique<libs::resources::resource<int>>(1)), libs::exception::custom_exception);
+	BOOST_CHECK_EQUAL(false, libs::enums::access_level::parse("read|").has_value());
+	// The null resource is rejected ahead of interning its subject.
+	libs::subjects::subject<std::string> ghost("ghost");
+	BOOST_CHECK(libs::status::code::invalid_resource == acl.try_add(ghost, nullptr).error());
+	BOOST_CHECK_EQUAL(false, acl.find("ghost").is_valid());
+
+	// The failed allocations are reported as the codes rather than terminating.
+	struct failing_resource: std::pmr::memory_resource {
+		bool fail{false};
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			if(fail) {
+				throw std::bad_alloc();
+			}
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	} mr;
+	{
+		libs::acl::acl<std::string, int> limited(&mr);
+		libs::subjects::subject<std::string> role("role");
+		mr.fail = true;
+		BOOST_CHECK(libs::status::code::out_of_memory ==
+				limited.try_add(libs::subjects::subject<std::string>("a subject whose id does not fit inline"), std::make_unique<libs::resources::resource<int>>(1)).error());
+		BOOST_CHECK(libs::status::code::out_of_memory == limited.try_add_member(role, sub).error());
+		mr.fail = false;
+		BOOST_CHECK(limited.try_add(sub, std::make_unique<libs::resources::resource<int>>(1)).has_value());
+	}
+}
+// Testing that the integral subjects are kept in place and interned through the direct array or the fallback map
+BOOST_AUTO_TEST_CASE(TEST_INTEGRAL_SUBJECTS)
+{
+	using libs::enums::rights;
+	using resource = libs::resources::resource<int>;
+	using subject = libs::subjects::subject<std::int64_t>;
+	static_assert(sizeof(subject) <= 2 * sizeof(std::int64_t), "The integral subject must keep its id in place");
+	subject moved(7);
+	subject target(std::move(moved));
+	BOOST_CHECK_EQUAL(false, moved.is_valid());
+	BOOST_CHECK_EQUAL(7, target.get_id());
+	BOOST_CHECK_THROW(moved.get_id(), std::exception);
+	libs::acl::acl<std::int64_t, int> acl;
+	const std::int64_t large = std::int64_t(1) << 40;
+	subject small(3);
+	subject big(large);
+	subject negative(-5);
+	const size_t first = acl.add(small, std::make_unique<resource>(1), rights::read);
+	const size_t second = acl.add(big, std::make_unique<resource>(2), rights::write);
+	const size_t third = acl.add(negative, std::make_unique<resource>(3), rights::all);
+	BOOST_CHECK_EQUAL(true, acl.is_allowed(small, first, rights::read));
+	BOOST_CHECK_EQUAL(false, acl.is_allowed(small, second));
+	BOOST_CHECK_EQUAL(true, acl.is_allowed(big, second, rights::write));
+	BOOST_CHECK_EQUAL(true, acl.is_allowed(negative, third, rights::all));
+	BOOST_CHECK_EQUAL(false, acl.has_subject(subject(4)));
+	BOOST_CHECK_EQUAL(false, acl.has_subject(subject(large + 1)));
+	BOOST_CHECK_EQUAL(0, acl.find(3).value);
+	BOOST_CHECK_EQUAL(1, acl.find(large).value);
+	BOOST_CHECK_EQUAL(2, acl.find(-5).value);
+	BOOST_CHECK_EQUAL(large, acl.get_id(acl.find(large)));
+	BOOST_CHECK_EQUAL(false, acl.find(4).is_valid());
+
+	// The handles stay dense and stable while the array grows.
+	libs::subjects::subject_table<std::uint16_t> table;
+	for(std::uint32_t id = 1000; id-- > 0;) {
+		BOOST_CHECK_EQUAL(999 - id, table.intern(static_cast<std::uint16_t>(id)).value);
+	}
+	for(std::uint32_t id = 0; id < 1000; ++id) {
+		BOOST_CHECK_EQUAL(999 - id, table.find(static_cast<std::uint16_t>(id)).value);
+	}
+	BOOST_CHECK_EQUAL(1000, table.size());
+	BOOST_CHECK_EQUAL(false, table.find(1000).is_valid());
+}
+// Testing that the small resources are kept in place by the grants and still handed over by the pops
+BOOST_AUTO_TEST_CASE(TEST_INLINE_RESOURCES)
+{
+	using libs::enums::rights;
+	struct handle {
+		std::uint32_t table;
+		std::uint64_t row;
+	};
+	using resource = libs::resources::resource<handle>;
+	static_assert(libs::resources::is_inline<handle>::value, "The small handle must be kept in place");
+	static_assert(!libs::resources::is_inline<std::string>::value, "The string must be kept on the heap");
+	static_assert(std::is_same<decltype(std::declval<resource&>().get_resource()), std::unique_ptr<handle>&>::value,
+			"The inline data is handed out by the same owning pointer");
+	static_assert(std::is_same<decltype(std::declval<libs::resources::resource<std::string>&>().get_resource()),
+			std::unique_ptr<std::string>&>::value, "The heap data keeps its owning pointer");
+	resource moved(handle{1, 2});
+	resource target(std::move(moved));
+	BOOST_CHECK(moved.get() == nullptr);
+	BOOST_CHECK_EQUAL(2, target.get_resource()->row);
+	// The data handed out by the owning pointer is still the one of the resource.
+	target.get_resource()->row = 3;
+	BOOST_CHECK_EQUAL(3, target.get()->row);
+	resource boxed(std::move(target));
+	BOOST_CHECK(target.get() == nullptr);
+	BOOST_CHECK_EQUAL(3, boxed.get()->row);
+
+	libs::acl::acl<std::string, handle> acl;
+	libs::subjects::subject<std::string> alice("alice");
+	const size_t first = acl.add(alice, std::make_unique<resource>(handle{7, 70}), rights::read);
+	const size_t second = acl.add(alice, std::make_unique<resource>(handle{8, 80}), rights::all);
+	BOOST_CHECK_EQUAL(true, acl.is_allowed(alice, first, rights::read));
+	std::unique_ptr<resource> popped = acl.try_pop(alice, first);
+	BOOST_REQUIRE(popped);
+	BOOST_CHECK_EQUAL(first, popped->get_uuid());
+	BOOST_CHECK_EQUAL(7, popped->get()->table);
+	BOOST_CHECK_EQUAL(70, popped->get()->row);
+	BOOST_CHECK(acl.try_pop(alice, first) == nullptr);
+	BOOST_CHECK_EQUAL(true, acl.has_resource(alice, first));
+	// The resource passed as the key releases the grant along with its data.
+	resource key;
+	key.set_uuid(second);
+	std::unique_ptr<resource> removed = acl.try_pop(alice, key);
+	BOOST_REQUIRE(removed);
+	BOOST_CHECK_EQUAL(second, removed->get_uuid());
+	BOOST_CHECK_EQUAL(80, removed->get()->row);
+	BOOST_CHECK_EQUAL(false, acl.has_resource(alice, second));
+	// The data moved to the heap by the owning pointer is put back in place by the add.
+	std::unique_ptr<resource> heaped = std::make_unique<resource>(handle{9, 90});
+	heaped->get_resource()->row = 91;
+	const size_t third = acl.add(alice, std::move(heaped), rights::read);
+	std::unique_ptr<resource> third_popped = acl.try_pop(alice, third);
+	BOOST_REQUIRE(third_popped);
+	BOOST_CHECK_EQUAL(91, third_popped->get()->row);
+}
+// Testing the enumeration of the grants and the scans of the whole table split across the threads
+BOOST_AUTO_TEST_CASE(TEST_ENUMERATION)
+{
+	using libs::enums::rights;
+	using resource = libs::resources::resource<int>;
+	using acl_type = libs::acl::acl<std::string, int>;
+	acl_type acl;
+	libs::subjects::subject<std::string> alice("alice");
+	libs::subjects::subject<std::string> bob("bob");
+	libs::subjects::subject<std::string> editors("editors");
+	const size_t first = acl.add(alice, std::make_unique<resource>(1), rights::read);
+	const size_t second = acl.add(alice, std::make_unique<resource>(2), rights::none);
+	const size_t shared = acl.add(editors, std::make_unique<resource>(3), rights::write);
+	const size_t third = acl.add(alice, std::make_unique<resource>(4), rights::all);
+	acl.add(bob, std::make_unique<resource>(5), rights::read);
+	acl.add_member(editors, bob);
+	// The write lapsed already, so the scans see the read only.
+	acl.allow_access(alice, first, rights::write, acl_type::clock::now() - std::chrono::seconds(1));
+	BOOST_CHECK(acl.try_pop(alice, second) != nullptr);
+
+	BOOST_CHECK((std::vector<size_t>{third, second, first}) == acl.resources_of(alice));
+	BOOST_CHECK(acl.resources_of(libs::subjects::subject<std::string>("carol")).empty());
+	std::vector<acl_type::grant_view> owned;
+	acl.for_each_resource(alice, [&owned](const acl_type::grant_view& g) {
+		owned.push_back(g);
+	});
+	BOOST_REQUIRE_EQUAL(3, owned.size());
+	BOOST_CHECK(rights::read == owned[2].rights);
+	BOOST_CHECK(owned[2].expires != 0);
+	BOOST_CHECK(owned[1].resource == nullptr);
+	BOOST_REQUIRE(owned[0].resource != nullptr);
+	BOOST_CHECK_EQUAL(4, *owned[0].resource);
+
+	const std::vector<acl_type::handle_type> holders = acl.subjects_allowed(shared, rights::write);
+	BOOST_REQUIRE_EQUAL(2, holders.size());
+	BOOST_CHECK(acl.find("editors") == holders[0]);
+	BOOST_CHECK(acl.find("bob") == holders[1]);
+	BOOST_CHECK(acl.subjects_allowed(shared, rights::read).empty());
+	BOOST_CHECK(acl.subjects_allowed(second).empty());
+	BOOST_CHECK_EQUAL(4, acl.count_allowed());
+	BOOST_CHECK_EQUAL(3, acl.count_allowed(rights::read));
+	BOOST_CHECK_EQUAL(2, acl.count_allowed(rights::write));
+	BOOST_CHECK_EQUAL(2, acl.grants(rights::write).size());
+
+	// The large table is split across the threads, the results do not depend on their number.
+	libs::acl::acl<std::uint32_t, int> large;
+	for(std::uint32_t i = 0; i < 50000; ++i) {
+		large.add(libs::subjects::subject<std::uint32_t>(i % 1000), std::make_unique<resource>(static_cast<int>(i)),
+				i % 3 ? rights::read : rights::none);
+	}
+	std::atomic<size_t> visited{0};
+	std::atomic<size_t> sum{0};
+	large.for_each_grant([&visited, &sum](const libs::acl::acl<std::uint32_t, int>::grant_view& g) {
+		visited.fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(static_cast<size_t>(*g.resource), std::memory_order_relaxed);
+	}, 4);
+	BOOST_CHECK_EQUAL(50000, visited.load());
+	BOOST_CHECK_EQUAL(size_t(50000) * 49999 / 2, sum.load());
+	BOOST_CHECK_EQUAL(33333, large.count_allowed(rights::read, 4));
+	BOOST_CHECK_EQUAL(large.count_allowed(rights::read, 1), large.count_allowed(rights::read, 4));
+	const auto serial = large.grants(rights::read, 1);
+	const auto parallel = large.grants(rights::read, 4);
+	BOOST_REQUIRE_EQUAL(serial.size(), parallel.size());
+	bool same = true;
+	for(size_t i = 0; i < serial.size(); ++i) {
+		same = same && serial[i].uuid == parallel[i].uuid;
+	}
+	BOOST_CHECK_EQUAL(true, same);
+}
+// Testing that the decisions are audited from many threads and the records the drainer falls behind with are counted
+BOOST_AUTO_TEST_CASE(TEST_AUDIT_LOG)
+{
+	using libs::enums::rights;
+	using libs::audit::op;
+	const std::string path = (std::filesystem::temp_directory_path() / "acl_test_audit.bin").string();
+	std::filesystem::remove(path);
+	libs::acl::acl<std::string, int> acl;
+	libs::subjects::subject<std::string> alice("alice");
+	libs::subjects::subject<std::string> bob("bob");
+	const size_t uuid = acl.add(alice, std::make_unique<libs::resources::resource<int>>(1), rights::read);
+	const std::int64_t started = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	{
+		libs::audit::writer log(path);
+		acl.attach_audit(&log);
+		BOOST_CHECK_EQUAL(true, acl.is_allowed(alice, uuid));
+		BOOST_CHECK_EQUAL(false, acl.is_allowed(bob, uuid));
+		acl.allow_access(alice, uuid, rights::write);
+		acl.forbid_access(bob, uuid);
+		BOOST_CHECK(libs::status::code::unknown_subject == acl.try_remove(bob));
+		acl.remove(alice, uuid);
+		acl.attach_audit(nullptr);
+		BOOST_CHECK_EQUAL(false, acl.is_allowed(alice, uuid));
+		std::vector<std::thread> threads;
+		for(std::uint32_t t = 0; t < 4; ++t) {
+			threads.emplace_back([&log, t] {
+				for(std::uint64_t i = 0; i < 1000; ++i) {
+					log.record_op(op::is_allowed, t, i, i % 2);
+				}
+			});
+		}
+		for(std::thread& t : threads) {
+			t.join();
+		}
+		log.flush();
+		BOOST_CHECK_EQUAL(4006, log.written());
+		BOOST_CHECK_EQUAL(0, log.dropped());
+	}
+	const std::int64_t stopped = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	libs::audit::reader reader(path);
+	std::vector<libs::audit::record> records;
+	libs::audit::record r;
+	while(reader.next(r)) {
+		records.push_back(r);
+	}
+	BOOST_REQUIRE_EQUAL(4006, records.size());
+	const op ops[] = {op::is_allowed, op::is_allowed, op::allow, op::forbid, op::remove_subject, op::remove_grant};
+	const bool decisions[] = {true, false, true, false, false, true};
+	for(size_t i = 0; i < 6; ++i) {
+		BOOST_CHECK(ops[i] == records[i].operation);
+		BOOST_CHECK_EQUAL(decisions[i], records[i].decision != 0);
+		BOOST_CHECK_EQUAL(i == 4 ? 0 : uuid, records[i].uuid);
+		// The time is taken from the coarse clock, so it is allowed its resolution of skew.
+		BOOST_CHECK(records[i].time > started - 1000000 && records[i].time < stopped + 1000000);
+		BOOST_CHECK(i == 0 || records[i].time >= records[i - 1].time);
+	}
+	BOOST_CHECK_EQUAL(acl.find("alice").value, records[0].subject);
+	BOOST_CHECK_EQUAL(libs::subjects::subject_handle::invalid, records[1].subject);
+	size_t per_thread[4]{};
+	for(size_t i = 6; i < records.size(); ++i) {
+		BOOST_REQUIRE(records[i].subject < 4);
+		BOOST_CHECK_EQUAL(records[i].uuid % 2, records[i].decision);
+		++per_thread[records[i].subject];
+	}
+	for(const size_t n : per_thread) {
+		BOOST_CHECK_EQUAL(1000, n);
+	}
+
+	// The drainer sleeps for long, so the ring overflows. The records read the system clock themselves.
+	std::filesystem::remove(path);
+	{
+		libs::audit::writer log(path, 8, std::chrono::hours(1), std::chrono::microseconds(0));
+		for(std::uint64_t i = 0; i < 100; ++i) {
+			log.record_op(op::is_allowed, 0, i, true);
+		}
+		BOOST_CHECK_EQUAL(92, log.dropped());
+		log.flush();
+		BOOST_CHECK_EQUAL(8, log.written());
+		BOOST_CHECK_EQUAL(true, log.record_op(op::is_allowed, 0, 100, true));
+	}
+	BOOST_CHECK_EQUAL(9 * sizeof(libs::audit::record), std::filesystem::file_size(path));
+	std::filesystem::remove(path);
+}
+#ifdef ACL_SHARED_MEMORY
+// Testing that the other processes query the acl through the shared memory and never see an update half applied
+BOOST_AUTO_TEST_CASE(TEST_SHARED_ACL)
+{
+	using libs::enums::rights;
+	using resource = libs::resources::resource<int>;
+	using subject = libs::subjects::subject<std::string>;
+	const std::string name = "/access_list_tests_" + std::to_string(::getpid());
+	libs::acl::acl<std::string, int> acl;
+	subject alice("alice");
+	subject bob("bob");
+	const size_t kept = acl.add(alice, std::make_unique<resource>(1), rights::read);
+	// The tables start tiny, so the writer grows the segment and the reader maps it again.
+	libs::shared::writer w(name, 4, 4, 16);
+	acl.attach_shared(&w);
+	libs::shared::reader<std::string> r(name);
+	BOOST_CHECK_EQUAL(true, r.is_allowed(alice, kept, rights::read));
+	BOOST_CHECK_EQUAL(false, r.is_allowed(alice, kept, rights::write));
+	BOOST_CHECK_EQUAL(false, r.is_allowed(bob, kept));
+	const size_t mapped = w.segment_size();
+	std::vector<size_t> uuids;
+	for(int i = 0; i < 1000; ++i) {
+		uuids.push_back(acl.add(subject("subject_" + std::to_string(i % 100)), std::make_unique<resource>(i), i % 2 ? rights::read : rights::none));
+	}
+	BOOST_CHECK(w.segment_size() > mapped);
+	BOOST_CHECK_EQUAL(101, r.subject_count());
+	BOOST_CHECK_EQUAL(1001, r.grant_count());
+	for(int i = 0; i < 1000; ++i) {
+		BOOST_CHECK_EQUAL(i % 2 == 1, r.is_allowed(subject("subject_" + std::to_string(i % 100)), uuids[i]));
+	}
+	acl.allow_access(alice, kept, rights::write);
+	BOOST_CHECK_EQUAL(true, r.is_allowed(alice, kept, rights::write));
+	acl.remove(subject("subject_0"));
+	BOOST_CHECK_EQUAL(false, r.has_subject(subject("subject_0")));
+	BOOST_CHECK_EQUAL(false, r.has_resource(subject("subject_0"), uuids[0]));
+	BOOST_CHECK_EQUAL(990, r.grant_count() - 1);
+	const size_t expired = acl.add(bob, std::make_unique<resource>(2), rights::read, std::chrono::system_clock::now() - std::chrono::seconds(1));
+	BOOST_CHECK_EQUAL(true, r.has_resource(bob, expired));
+	BOOST_CHECK_EQUAL(false, r.is_allowed(bob, expired));
+
+	const pid_t child = ::fork();
+	if(child == 0) {
+		libs::shared::reader<std::string> other(name);
+		const bool ok = other.is_allowed(subject("subject_1"), uuids[1]) && !other.has_subject(subject("subject_0")) &&
+			other.is_allowed(alice, kept, rights::write) && other.grant_count() == 992;
+		::_exit(ok ? 0 : 1);
+	}
+	int status = 0;
+	BOOST_REQUIRE_EQUAL(child, ::waitpid(child, &status, 0));
+	BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	// The grants churn and the tables are rebuilt meanwhile, the checks of the stable grants never change.
+	std::atomic<bool> done{false};
+	std::atomic<size_t> wrong{0};
+	std::thread checker([&] {
+		libs::shared::reader<std::string> own(name);
+		while(!done.load()) {
+			if(!own.is_allowed(alice, kept, rights::write) || own.is_allowed(subject("subject_2"), uuids[2]) ||
+					!own.has_resource(subject("subject_3"), uuids[3])) {
+				++wrong;
+			}
+		}
+	});
+	for(int i = 0; i < 20000; ++i) {
+		const size_t uuid = acl.add(subject("churn_" + std::to_string(i)), std::make_unique<resource>(i), rights::read);
+		acl.remove(uuid);
+		if(i % 100 == 0) {
+			acl.remove(subject("churn_" + std::to_string(i)));
+		}
+	}
+	done = true;
+	checker.join();
+	BOOST_CHECK_EQUAL(0, wrong.load());
+	BOOST_CHECK(w.version() > 40000);
+	acl.attach_shared(nullptr);
+}
+#endif
+#ifdef ACL_TEST_DAEMON
+// Testing that the daemon serves the acl to its clients and answers the pipelined checks by batches
+BOOST_AUTO_TEST_CASE(TEST_DAEMON)
+{
+	libs::acl::acl<std::string, std::string> served;
+	const std::string path = "/tmp/access_list_tests_" + std::to_string(::getpid()) + ".sock";
+	libs::daemon::server<std::string, std::string> server(served, path);
+	std::thread serving([&server] {
+		server.run();
+	});
+	{
+		libs::daemon::client<std::string, std::string> c(path);
+		libs::subjects::subject<std::string> alice("alice");
+		libs::subjects::subject<std::string> bob("bob");
+		libs::status::result<size_t> added = c.add(alice, std::make_unique<libs::resources::resource<std::string>>(std::string("report")),
+				libs::enums::rights::read);
+		BOOST_REQUIRE(added.has_value());
+		const size_t uuid = added.value();
+		BOOST_CHECK_EQUAL(true, c.is_allowed(alice, uuid, libs::enums::rights::read));
+		BOOST_CHECK_EQUAL(false, c.is_allowed(alice, uuid, libs::enums::rights::write));
+		BOOST_CHECK_EQUAL(true, c.has_subject(alice));
+		BOOST_CHECK_EQUAL(false, c.has_subject(bob));
+		BOOST_CHECK(libs::status::code::ok == c.allow_access(alice, uuid, libs::enums::rights::write));
+		BOOST_CHECK_EQUAL(true, c.is_allowed(alice, uuid, libs::enums::rights::write));
+		BOOST_CHECK(libs::status::code::unknown_subject == c.allow_access(bob, uuid));
+		BOOST_CHECK(libs::status::code::unknown_resource == c.forbid_access(alice, uuid + 100));
+
+		// The adds are pipelined, then the checks are sent in one go.
+		const std::string resource = "page";
+		for(int i = 0; i < 1000; ++i) {
+			c.send(libs::daemon::op::add, "subject_" + std::to_string(i % 10), 0, i % 2 ? libs::enums::rights::read : libs::enums::rights::none, &resource);
+		}
+		c.flush();
+		std::vector<std::pair<std::string, size_t>> checks;
+		for(int i = 0; i < 1000; ++i) {
+			const libs::daemon::response resp = c.receive();
+			BOOST_CHECK(libs::status::code::ok == resp.code);
+			checks.emplace_back("subject_" + std::to_string(i % 10), static_cast<size_t>(resp.uuid));
+		}
+		checks.emplace_back("unknown", uuid);
+		const std::vector<bool> results = c.is_allowed_batch(checks);
+		for(int i = 0; i < 1000; ++i) {
+			BOOST_CHECK_EQUAL(i % 2 == 1, results[i]);
+		}
+		BOOST_CHECK_EQUAL(false, results.back());
+
+		std::unique_ptr<libs::resources::resource<std::string>> popped = c.try_pop(alice, uuid);
+		BOOST_REQUIRE(popped);
+		BOOST_CHECK_EQUAL("report", *popped->get_resource());
+		BOOST_CHECK_EQUAL(uuid, popped->get_uuid());
+		BOOST_CHECK(!c.try_pop(alice, uuid));
+		BOOST_CHECK(libs::status::code::ok == c.remove(alice, uuid));
+		BOOST_CHECK_EQUAL(false, c.has_resource(alice, uuid));
+		BOOST_CHECK(libs::status::code::ok == c.remove(alice));
+		BOOST_CHECK(libs::status::code::unknown_subject == c.remove(alice));
+		BOOST_CHECK_EQUAL(false, c.has_subject(alice));
+	}
+	server.stop();
+	serving.join();
+	BOOST_CHECK(server.batches() < server.requests());
+	BOOST_CHECK_EQUAL(10, served.size());
+}
+#endif